@@ -101,11 +101,13 @@ use constant TYPE_GET_BINDING_MODES => 8;
 use constant TYPE_GET_CONFIG => 9;
 use constant TYPE_SEND_TICK => 10;
 use constant TYPE_SYNC => 11;
+use constant TYPE_GET_STATS => 12;
 
 our %EXPORT_TAGS = ( 'all' => [
     qw(i3 TYPE_RUN_COMMAND TYPE_COMMAND TYPE_GET_WORKSPACES TYPE_SUBSCRIBE TYPE_GET_OUTPUTS
        TYPE_GET_TREE TYPE_GET_MARKS TYPE_GET_BAR_CONFIG TYPE_GET_VERSION
-       TYPE_GET_BINDING_MODES TYPE_GET_CONFIG TYPE_SEND_TICK TYPE_SYNC)
+       TYPE_GET_BINDING_MODES TYPE_GET_CONFIG TYPE_SEND_TICK TYPE_SYNC
+       TYPE_GET_STATS)
 ] );
 
 our @EXPORT_OK = ( @{ $EXPORT_TAGS{all} } );
@@ -548,6 +550,20 @@ sub sync {
     $self->message(TYPE_SYNC, $payload);
 }
 
+=head2 get_stats($reset)
+
+Gets the latency histograms and counters of i3's main loop. If $reset is true,
+they are reset after the reply. Requires i3 >= 4.17
+
+=cut
+sub get_stats {
+    my ($self, $reset) = @_;
+
+    $self->_ensure_connection;
+
+    $self->message(TYPE_GET_STATS, $reset ? 'reset' : '');
+}
+
 =head2 command($content)
 
 Makes i3 execute the given command
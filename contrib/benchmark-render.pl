@@ -0,0 +1,77 @@
+#!/usr/bin/env perl
+# vim:ts=4:sw=4:expandtab
+# © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+#
+# Measures how long i3 takes to render trees with a growing number of leaves.
+#
+# For every requested size, empty containers (see the 'open' command) are
+# created on workspaces of 100 leaves each, then the focus is moved back and
+# forth on the first of these workspaces. Every such command results in one
+# tree_render(), but the reported time is the whole IPC round trip, including
+# parsing the command. Invisible workspaces which did not change are skipped
+# when rendering, so the other workspaces mostly add frames which i3 has to
+# look up while pushing changes.
+#
+# The script only reports numbers for the i3 it is connected to. To compare
+# two versions of i3, run it against each of them with the same arguments.
+#
+# Only run this in a throwaway i3 session (e.g. in Xephyr), it creates and
+# removes thousands of containers:
+#
+#     ./benchmark-render.pl --renders=200 100 1000 5000
+
+use strict;
+use warnings;
+use AnyEvent::I3;
+use Getopt::Long;
+use List::Util qw(min);
+use Time::HiRes qw(time);
+use v5.10;
+
+my $renders = 100;
+my $per_workspace = 100;
+GetOptions(
+    'renders=i' => \$renders,
+    'per-workspace=i' => \$per_workspace,
+) or die "Usage: $0 [--renders=N] [--per-workspace=N] [leaves ...]\n";
+
+my @sizes = @ARGV ? @ARGV : (100, 1000, 5000);
+
+my $i3 = i3();
+die "Could not connect to i3: $!" unless $i3->connect->recv();
+
+sub cmd {
+    my ($command) = @_;
+    my $results = $i3->command($command)->recv;
+    for my $result (@$results) {
+        die "Command '$command' failed: " . ($result->{error} // 'unknown error')
+            unless $result->{success};
+    }
+    return $results;
+}
+
+for my $leaves (@sizes) {
+    my @ids;
+    my $workspaces = 0;
+    for (my $left = $leaves; $left > 0; $left -= $per_workspace) {
+        $workspaces++;
+        my $count = min($left, $per_workspace);
+        my $results = cmd("workspace bench-$leaves-$workspaces; " . join('; ', ('open') x $count));
+        push @ids, map { $_->{id} } grep { exists($_->{id}) } @$results;
+    }
+
+    cmd("workspace bench-$leaves-1");
+
+    my $start = time();
+    for my $i (1 .. $renders) {
+        cmd($i % 2 ? 'focus left' : 'focus right');
+    }
+    my $elapsed = time() - $start;
+
+    printf("%6d leaves on %3d workspaces: %8.3f ms per render (%d renders)\n",
+        $leaves, $workspaces, ($elapsed / $renders) * 1000, $renders);
+
+    while (my @batch = splice(@ids, 0, 100)) {
+        cmd(join('; ', map { "[con_id=$_] kill" } @batch));
+    }
+}
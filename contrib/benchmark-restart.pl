@@ -0,0 +1,111 @@
+#!/usr/bin/env perl
+# vim:ts=4:sw=4:expandtab
+# © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+#
+# Measures how long an inplace restart of i3 takes for trees with a growing
+# number of containers.
+#
+# For every requested size, empty containers (see the 'open' command) are
+# created on workspaces of 100 leaves each. Then i3 is restarted several times
+# and the time from sending the 'restart' command until the new i3 process
+# answers IPC requests is reported. This includes storing and loading the
+# layout, but also everything else i3 does on startup (e.g. reading the
+# config), so compare the numbers to the ones for an empty tree.
+#
+# Only run this in a throwaway i3 session (e.g. in Xephyr), it creates and
+# removes thousands of containers and restarts i3:
+#
+#     ./benchmark-restart.pl --restarts=5 0 1000 5000
+
+use strict;
+use warnings;
+use AnyEvent;
+use AnyEvent::I3;
+use Getopt::Long;
+use List::Util qw(min sum);
+use Time::HiRes qw(time sleep);
+use v5.10;
+
+my $restarts = 5;
+my $per_workspace = 100;
+GetOptions(
+    'restarts=i' => \$restarts,
+    'per-workspace=i' => \$per_workspace,
+) or die "Usage: $0 [--restarts=N] [--per-workspace=N] [leaves ...]\n";
+
+my @sizes = @ARGV ? @ARGV : (0, 1000, 5000);
+
+sub connect_i3 {
+    my $i3 = i3();
+    return $i3->connect->recv ? $i3 : undef;
+}
+
+my $i3 = connect_i3() or die "Could not connect to i3: $!";
+
+sub cmd {
+    my ($command) = @_;
+    my $results = $i3->command($command)->recv;
+    for my $result (@$results) {
+        die "Command '$command' failed: " . ($result->{error} // 'unknown error')
+            unless $result->{success};
+    }
+    return $results;
+}
+
+sub count_containers {
+    my ($con) = @_;
+    return 1 + sum(0, map { count_containers($_) } (@{$con->{nodes}}, @{$con->{floating_nodes}}));
+}
+
+# Returns the IDs of all leaves on the benchmark workspaces.
+sub benchmark_leaves {
+    my ($con, $on_benchmark_ws) = @_;
+    $on_benchmark_ws ||= ($con->{type} eq 'workspace' && $con->{name} =~ /^bench-restart-/);
+    my @children = (@{$con->{nodes}}, @{$con->{floating_nodes}});
+    return ($on_benchmark_ws && $con->{type} eq 'con' ? ($con->{id}) : ())
+        unless @children;
+    return map { benchmark_leaves($_, $on_benchmark_ws) } @children;
+}
+
+# Restarts i3 and returns the number of seconds until it answers again.
+sub restart {
+    my $shutdown = AnyEvent->condvar;
+    $i3->subscribe({ shutdown => sub { $shutdown->send } })->recv
+        or die "Could not subscribe to the shutdown event";
+
+    my $start = time();
+    $i3->command('restart');
+    $shutdown->recv;
+
+    # The IPC socket is re-created by the new process, connecting fails until
+    # then.
+    my $new;
+    until (defined($new = connect_i3())) {
+        sleep(0.0005);
+    }
+    $new->get_version->recv;
+    my $elapsed = time() - $start;
+
+    $i3 = $new;
+    return $elapsed;
+}
+
+for my $leaves (@sizes) {
+    my $workspaces = 0;
+    for (my $left = $leaves; $left > 0; $left -= $per_workspace) {
+        $workspaces++;
+        my $count = min($left, $per_workspace);
+        cmd("workspace bench-restart-$leaves-$workspaces; " . join('; ', ('open') x $count));
+    }
+
+    my $containers = count_containers($i3->get_tree->recv);
+    my @times = map { restart() } 1 .. $restarts;
+
+    printf("%6d leaves (%6d containers): %8.3f ms per restart (min %8.3f ms, %d restarts)\n",
+        $leaves, $containers, (sum(@times) / @times) * 1000, min(@times) * 1000, $restarts);
+
+    my @ids = benchmark_leaves($i3->get_tree->recv);
+    while (my @batch = splice(@ids, 0, 100)) {
+        cmd(join('; ', map { "[con_id=$_] kill" } @batch));
+    }
+}
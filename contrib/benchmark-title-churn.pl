@@ -0,0 +1,112 @@
+#!/usr/bin/env perl
+# vim:ts=4:sw=4:expandtab
+# © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+#
+# Measures how long i3 takes to handle title changes of a window when many
+# for_window rules are configured: every title change checks the rules which
+# depend on the title.
+#
+# First, append a generated rule set to the config of a throwaway i3 session
+# (e.g. in Xephyr) and start i3 with it:
+#
+#     ./benchmark-title-churn.pl --rules=1000 --print-config >> ~/.config/i3/config
+#
+# Then replay the title churn of a browser-like window. The time i3 spent
+# handling the resulting X11 events is taken from GET_STATS, so it does not
+# include the round trips of this script:
+#
+#     ./benchmark-title-churn.pl --renames=10000
+
+use strict;
+use warnings;
+use AnyEvent::I3;
+use Getopt::Long;
+use Time::HiRes qw(sleep);
+use X11::XCB qw(:all);
+use X11::XCB::Connection;
+use v5.10;
+
+my $rules = 1000;
+my $renames = 10000;
+my $print_config = 0;
+GetOptions(
+    'rules=i' => \$rules,
+    'renames=i' => \$renames,
+    'print-config' => \$print_config,
+) or die "Usage: $0 [--rules=N --print-config] [--renames=N]\n";
+
+# A mix of the patterns found in real configs: exact classes, title prefixes
+# and substrings, regular expressions with and without a literal part, and
+# rules combining several criteria.
+sub rule {
+    my ($i) = @_;
+    my @criteria = (
+        qq|class="^Application$i\$"|,
+        qq|title="^Project $i - "|,
+        qq|title="Document $i\\.pdf"|,
+        qq|title="(?i)report-$i"|,
+        qq|instance="^term$i\$" window_role="^dialog"|,
+        qq|title="^Mail \\($i unread\\)\$"|,
+        qq|class="Browser" title="Settings $i\$"|,
+    );
+    return 'for_window [' . $criteria[$i % @criteria] . '] border pixel 1';
+}
+
+if ($print_config) {
+    say "# Generated by $0";
+    say rule($_) for 0 .. $rules - 1;
+    exit 0;
+}
+
+my @titles = (
+    'vim src/file%d.c - Terminal',
+    'Page %d - Mozilla Firefox',
+    '(%d) Inbox - Mail',
+    'Build #%d running',
+    'Document %d.pdf',
+);
+
+my $i3 = i3();
+die "Could not connect to i3: $!" unless $i3->connect->recv();
+
+my $x = X11::XCB::Connection->new;
+my $window = $x->root->create_child(
+    class => WINDOW_CLASS_INPUT_OUTPUT,
+    rect => [ 0, 0, 30, 30 ],
+    background_color => '#c0c0c0',
+    name => 'title churn',
+);
+$window->map;
+$x->flush;
+sleep(0.5);
+
+# Returns the number of PropertyNotify events i3 handled since the reset.
+sub property_notifies {
+    my ($stats) = @_;
+    return $stats->{x_events}->{PropertyNotify} // 0;
+}
+
+$i3->get_stats(1)->recv;
+
+for my $i (1 .. $renames) {
+    $window->name(sprintf($titles[$i % @titles], $i));
+    $x->flush;
+}
+
+# Wait until i3 handled all title changes.
+my $stats;
+my $seen = -1;
+while (1) {
+    sleep(0.1);
+    $stats = $i3->get_stats->recv;
+    last if property_notifies($stats) >= $renames && property_notifies($stats) == $seen;
+    $seen = property_notifies($stats);
+}
+
+my $x_event = $stats->{phases}->{x_event};
+printf("%d title changes, %d X11 events: %.3f ms in total, %.1f us mean, %.1f us p99\n",
+    $renames, $x_event->{count}, $x_event->{total_ns} / 1e6,
+    $x_event->{mean_ns} / 1e3, $x_event->{p99_ns} / 1e3);
+
+$window->unmap;
+$x->flush;
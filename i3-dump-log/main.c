@@ -26,19 +26,23 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <time.h>
+#include <sched.h>
+#include <inttypes.h>
 
 #include "libi3.h"
 #include "shmlog.h"
 #include <i3/ipc.h>
 
-#if !defined(__OpenBSD__)
-static uint32_t offset_next_write;
-#endif
-static uint32_t wrap_count;
-
 static i3_shmlog_header *header;
 static char *logbuffer,
     *walk;
+/* Sequence number of the record at walk. */
+static uint64_t walk_seq;
+/* Number of records which were overwritten before they could be printed. */
+static uint64_t dropped;
+/* The format string table of the shmlog. */
+static char *formats;
 static int ipcfd = -1;
 
 static volatile bool interrupted = false;
@@ -63,26 +67,313 @@ static void disable_shmlog(void) {
     free(reply);
 }
 
-static int check_for_wrap(void) {
-    if (wrap_count == header->wrap_count)
-        return 0;
+static bool unpack_int(const uint8_t **args, const uint8_t *end, int64_t *value) {
+    if (*args + sizeof(int64_t) > end)
+        return false;
+    memcpy(value, *args, sizeof(int64_t));
+    *args += sizeof(int64_t);
+    return true;
+}
+
+/*
+ * Unpacks a string argument into a NUL-terminated buffer. The returned string
+ * needs to be free()d.
+ *
+ */
+static char *unpack_string(const uint8_t **args, const uint8_t *end) {
+    uint32_t len;
+    if (*args + sizeof(uint32_t) > end)
+        return NULL;
+    memcpy(&len, *args, sizeof(uint32_t));
+    if (len > (size_t)(end - *args) - sizeof(uint32_t))
+        return NULL;
+    char *str = sstrndup((const char *)*args + sizeof(uint32_t), len);
+    *args += sizeof(uint32_t) + len;
+    return str;
+}
+
+/*
+ * Formats the packed arguments of a record according to its format string
+ * (see i3_shmlog_record) and appends the result to out. Returns the number of
+ * bytes written.
+ *
+ */
+static size_t format_record(char *out, size_t size, const char *fmt, const uint8_t *args, const uint8_t *end) {
+    size_t len = 0;
+    const char *walk = fmt;
+    while (*walk != '\0' && len < size - 1) {
+        if (*walk != '%') {
+            out[len++] = *(walk++);
+            continue;
+        }
+
+        printf_spec_t spec;
+        if (!parse_printf_spec(walk, &spec))
+            break;
+
+        /* Copy the specification, replacing the field width and precision
+         * which were passed as arguments. */
+        char buf[64];
+        size_t buf_len = 0;
+        for (size_t i = 0; i < spec.len && buf_len < sizeof(buf) - 32; i++) {
+            if (walk[i] != '*') {
+                buf[buf_len++] = walk[i];
+                continue;
+            }
+            int64_t value;
+            if (!unpack_int(&args, end, &value))
+                return len;
+            if (i > 0 && walk[i - 1] == '.') {
+                /* A negative precision is taken as if it was omitted. */
+                if (value < 0) {
+                    buf_len--;
+                    continue;
+                }
+            }
+            buf_len += snprintf(buf + buf_len, sizeof(buf) - buf_len, "%d", (int)value);
+        }
+        buf[buf_len] = '\0';
+        walk += spec.len;
+
+        int64_t value = 0;
+        double dvalue = 0;
+        char *str = NULL;
+        bool ok;
+        switch (spec.type) {
+            case PRINTF_ARG_NONE:
+                ok = true;
+                break;
+            case PRINTF_ARG_DOUBLE:
+            case PRINTF_ARG_LDOUBLE:
+                ok = (args + sizeof(double) <= end);
+                if (ok) {
+                    memcpy(&dvalue, args, sizeof(double));
+                    args += sizeof(double);
+                }
+                break;
+            case PRINTF_ARG_STRING:
+                ok = ((str = unpack_string(&args, end)) != NULL);
+                break;
+            default:
+                ok = unpack_int(&args, end, &value);
+                break;
+        }
+        if (!ok)
+            break;
+
+        int n = 0;
+        switch (spec.type) {
+            case PRINTF_ARG_NONE:
+                n = snprintf(out + len, size - len, "%%");
+                break;
+            case PRINTF_ARG_INT:
+                n = snprintf(out + len, size - len, buf, (int)value);
+                break;
+            case PRINTF_ARG_LONG:
+                n = snprintf(out + len, size - len, buf, (long)value);
+                break;
+            case PRINTF_ARG_LLONG:
+                n = snprintf(out + len, size - len, buf, (long long)value);
+                break;
+            case PRINTF_ARG_INTMAX:
+                n = snprintf(out + len, size - len, buf, (intmax_t)value);
+                break;
+            case PRINTF_ARG_SIZE:
+                n = snprintf(out + len, size - len, buf, (size_t)value);
+                break;
+            case PRINTF_ARG_PTRDIFF:
+                n = snprintf(out + len, size - len, buf, (ptrdiff_t)value);
+                break;
+            case PRINTF_ARG_DOUBLE:
+                n = snprintf(out + len, size - len, buf, dvalue);
+                break;
+            case PRINTF_ARG_LDOUBLE:
+                n = snprintf(out + len, size - len, buf, (long double)dvalue);
+                break;
+            case PRINTF_ARG_POINTER:
+                n = snprintf(out + len, size - len, buf, (void *)(uintptr_t)value);
+                break;
+            case PRINTF_ARG_STRING:
+                n = snprintf(out + len, size - len, buf, str);
+                free(str);
+                break;
+        }
+        if (n > 0)
+            len += n;
+        if (len > size - 1)
+            len = size - 1;
+    }
+    return len;
+}
+
+/*
+ * Prints a single record, prefixed with the wall-clock time at which it was
+ * logged.
+ *
+ */
+static void print_record(const i3_shmlog_record *record) {
+    static char line[8192];
+
+    const int64_t ns = (int64_t)record->timestamp + header->realtime_offset;
+    const time_t t = ns / 1000000000;
+    struct tm result;
+    size_t len = strftime(line, sizeof(line), "%x %X - ", localtime_r(&t, &result));
+
+    const uint8_t *args = (const uint8_t *)record + sizeof(i3_shmlog_record);
+    const uint8_t *end = (const uint8_t *)record + record->size;
+    if (record->format_id == SHMLOG_FORMAT_TEXT) {
+        char *text = unpack_string(&args, end);
+        if (text == NULL)
+            return;
+        len += snprintf(line + len, sizeof(line) - len, "%s", text);
+        free(text);
+        if (len > sizeof(line) - 1)
+            len = sizeof(line) - 1;
+    } else if (record->format_id < header->formats_used) {
+        len += format_record(line + len, sizeof(line) - len, formats + record->format_id, args, end);
+    } else {
+        return;
+    }
+    swrite(STDOUT_FILENO, line, len);
+}
+
+/* A consistent copy of the fields of the header which are needed to read
+ * records. */
+struct header_snapshot {
+    uint64_t next_seq;
+    uint64_t oldest_seq;
+    uint32_t offset_oldest;
+};
+
+/*
+ * Copies the header fields while i3 is not writing (see write_record() in
+ * i3/src/log.c).
+ *
+ */
+static void read_header(struct header_snapshot *snapshot) {
+    while (true) {
+        const uint32_t lock = __atomic_load_n(&(header->lock), __ATOMIC_ACQUIRE);
+        if ((lock & 1) == 0) {
+            snapshot->next_seq = __atomic_load_n(&(header->next_seq), __ATOMIC_RELAXED);
+            snapshot->oldest_seq = __atomic_load_n(&(header->oldest_seq), __ATOMIC_RELAXED);
+            snapshot->offset_oldest = __atomic_load_n(&(header->offset_oldest), __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&(header->lock), __ATOMIC_RELAXED) == lock)
+                return;
+        }
+        sched_yield();
+    }
+}
 
-    /* The log wrapped. Print the remaining content and reset walk to the top
-     * of the log. */
-    wrap_count = header->wrap_count;
-    const int len = (logbuffer + header->offset_last_wrap) - walk;
-    swrite(STDOUT_FILENO, walk, len);
-    walk = logbuffer + sizeof(i3_shmlog_header);
-    return 1;
+/*
+ * Moves walk to the oldest record if the next record to print was already
+ * overwritten. Returns true if that was the case.
+ *
+ */
+static bool check_for_overrun(const struct header_snapshot *snapshot) {
+    if (walk_seq >= snapshot->oldest_seq)
+        return false;
+
+    const uint64_t lost = snapshot->oldest_seq - walk_seq;
+    dropped += lost;
+    fprintf(stderr, "i3-dump-log: %" PRIu64 " records were overwritten before they could be printed\n", lost);
+    walk = logbuffer + snapshot->offset_oldest;
+    walk_seq = snapshot->oldest_seq;
+    return true;
 }
 
+/*
+ * Prints all records from walk_seq up to the most recent one. Records are
+ * copied out of the ringbuffer and only printed if i3 did not start to
+ * overwrite them in the meantime.
+ *
+ */
 static void print_till_end(void) {
-    check_for_wrap();
-    const int len = (logbuffer + header->offset_next_write) - walk;
-    swrite(STDOUT_FILENO, walk, len);
-    walk += len;
+    static char copy[SHMLOG_MAX_RECORD_SIZE];
+    char *start = logbuffer + sizeof(i3_shmlog_header);
+    char *end = logbuffer + header->offset_formats;
+
+    struct header_snapshot snapshot;
+    read_header(&snapshot);
+    while (walk_seq < snapshot.next_seq) {
+        if (check_for_overrun(&snapshot))
+            continue;
+
+        /* i3 wraps when a record does not fit at the end of the ringbuffer,
+         * in which case the record at walk is an old one. */
+        const i3_shmlog_record *record = (const i3_shmlog_record *)walk;
+        if (walk + sizeof(i3_shmlog_record) > end || record->seq != walk_seq) {
+            walk = start;
+            record = (const i3_shmlog_record *)walk;
+        }
+
+        size_t size = record->size;
+        if (size < sizeof(i3_shmlog_record) || size > sizeof(copy) || size > (size_t)(end - walk))
+            size = sizeof(i3_shmlog_record);
+        memcpy(copy, walk, size);
+
+        /* Order the copy before reading the header again, this pairs with
+         * the release fence before i3 overwrites old records. */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        /* The copy is only valid if i3 did not advance oldest_seq past it
+         * (which it does before overwriting). */
+        read_header(&snapshot);
+        if (check_for_overrun(&snapshot))
+            continue;
+
+        record = (const i3_shmlog_record *)copy;
+        if (record->seq != walk_seq || record->size != size) {
+            fprintf(stderr, "i3-dump-log: invalid record %" PRIu64 " in the log, stopping\n", walk_seq);
+            exit(EXIT_FAILURE);
+        }
+        print_record(record);
+        walk += size;
+        walk_seq++;
+    }
+}
+
+/*
+ * Moves walk to the record with the given sequence number (or the oldest
+ * record, if it was already overwritten).
+ *
+ */
+static void seek_to_seq(uint64_t seq) {
+    struct header_snapshot snapshot;
+    read_header(&snapshot);
+    walk = logbuffer + snapshot.offset_oldest;
+    walk_seq = snapshot.oldest_seq;
+    if (seq < walk_seq) {
+        check_for_overrun(&snapshot);
+        return;
+    }
+    if (seq > snapshot.next_seq)
+        seq = snapshot.next_seq;
+
+    char *start = logbuffer + sizeof(i3_shmlog_header);
+    char *end = logbuffer + header->offset_formats;
+    while (walk_seq < seq) {
+        const i3_shmlog_record *record = (const i3_shmlog_record *)walk;
+        if (walk + sizeof(i3_shmlog_record) > end || record->seq != walk_seq) {
+            walk = start;
+            record = (const i3_shmlog_record *)walk;
+        }
+        if (record->seq != walk_seq || record->size < sizeof(i3_shmlog_record)) {
+            /* The record was overwritten while seeking, start over. */
+            seek_to_seq(seq);
+            return;
+        }
+        walk += record->size;
+        walk_seq++;
+    }
 }
 
+#if !defined(__OpenBSD__)
+static void unregister_follower(void) {
+    __atomic_sub_fetch(&(header->followers), 1, __ATOMIC_SEQ_CST);
+}
+#endif
+
 void errorlog(char *fmt, ...) {
     va_list args;
 
@@ -94,6 +385,7 @@ void errorlog(char *fmt, ...) {
 int main(int argc, char *argv[]) {
     int o, option_index = 0;
     bool verbose = false;
+    uint64_t since_seq = 0;
 #if !defined(__OpenBSD__)
     bool follow = false;
 #endif
@@ -105,6 +397,7 @@ int main(int argc, char *argv[]) {
         {"follow", no_argument, 0, 'f'},
 #endif
         {"help", no_argument, 0, 'h'},
+        {"since-seq", required_argument, 0, 0},
         {0, 0, 0, 0}
     };
 
@@ -127,11 +420,16 @@ int main(int argc, char *argv[]) {
         } else if (o == 'h') {
             printf("i3-dump-log " I3_VERSION "\n");
 #if !defined(__OpenBSD__)
-            printf("i3-dump-log [-fhVv]\n");
+            printf("i3-dump-log [-fhVv] [--since-seq <seq>]\n");
 #else
-            printf("i3-dump-log [-hVv]\n");
+            printf("i3-dump-log [-hVv] [--since-seq <seq>]\n");
 #endif
             return 0;
+        } else if (o == 0 && strcmp(long_options[option_index].name, "since-seq") == 0) {
+            char *end;
+            since_seq = strtoull(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0')
+                errx(EXIT_FAILURE, "Invalid sequence number \"%s\"", optarg);
         }
     }
 
@@ -207,34 +505,22 @@ int main(int argc, char *argv[]) {
     header = (i3_shmlog_header *)logbuffer;
 
     if (verbose)
-        printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, shmname = %s\n",
-               header->offset_next_write, header->offset_last_wrap, header->size, shmname);
+        printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, next_seq = %" PRIu64 ", oldest_seq = %" PRIu64 ", shmname = %s\n",
+               header->offset_next_write, header->offset_last_wrap, header->size,
+               header->next_seq, header->oldest_seq, shmname);
+    fflush(stdout);
     free(shmname);
-    walk = logbuffer + header->offset_next_write;
-
-    /* We first need to print old content in case there was at least one
-     * wrapping already. */
-
-    if (*walk != '\0') {
-        /* In case there was a write to the buffer already, skip the first
-         * old line, it very likely is mangled. Not a problem, though, the log
-         * is chatty enough to have plenty lines left. */
-        while (*walk != '\n')
-            walk++;
-        walk++;
-    }
-
-    /* In case there was no wrapping, this is a no-op, otherwise it prints the
-     * old lines. */
-    wrap_count = 0;
-    check_for_wrap();
+    formats = logbuffer + header->offset_formats;
 
-    /* Then start from the beginning and print the newer lines */
-    walk = logbuffer + sizeof(i3_shmlog_header);
+    /* Print all records, starting with the oldest one (or the requested
+     * one). */
+    seek_to_seq(since_seq);
     print_till_end();
 
 #if !defined(__OpenBSD__)
     if (!follow) {
+        if (verbose)
+            printf("next_seq = %" PRIu64 ", dropped = %" PRIu64 "\n", walk_seq, dropped);
         return 0;
     }
 
@@ -245,6 +531,10 @@ int main(int argc, char *argv[]) {
     action.sa_flags = 0;
     sigaction(SIGINT, &action, NULL);
 
+    /* i3 only signals the condvar while there are followers. */
+    __atomic_add_fetch(&(header->followers), 1, __ATOMIC_SEQ_CST);
+    atexit(unregister_follower);
+
     /* Since pthread_cond_wait() expects a mutex, we need to provide one.
          * To not lock i3 (that’s bad, mhkay?) we just define one outside of
          * the shared memory. */
@@ -252,11 +542,8 @@ int main(int argc, char *argv[]) {
     pthread_mutex_lock(&dummy_mutex);
     while (!interrupted) {
         pthread_cond_wait(&(header->condvar), &dummy_mutex);
-        /* If this was not a spurious wakeup, print the new lines. */
-        if (header->offset_next_write != offset_next_write) {
-            offset_next_write = header->offset_next_write;
-            print_till_end();
-        }
+        /* If this was not a spurious wakeup, print the new records. */
+        print_till_end();
     }
 
 #endif
@@ -74,6 +74,11 @@ struct status_block {
     struct status_block_render_desc full_render;
     struct status_block_render_desc short_render;
 
+    /* Whether the block differs from the one at the same position in the
+     * previous statusline, i.e. whether draw_statusline_changes() has to
+     * redraw it. */
+    bool changed;
+
     /* Optional */
     char *name;
     char *instance;
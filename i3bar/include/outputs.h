@@ -67,6 +67,10 @@ struct i3_output {
     int statusline_width;
     /* Whether statusline block short texts where used on last statusline render. */
     bool statusline_short_text;
+    /* Where the visible part of the statusline starts in buffer and how wide
+     * it is, as of the last statusline render. */
+    int statusline_x;
+    int statusline_visible_width;
     /* The actual window on which we draw. */
     surface_t bar;
 
@@ -132,6 +132,14 @@ void reconfig_windows(bool redraw_bars);
  */
 void draw_bars(bool force_unhide);
 
+/*
+ * Redraws only the status blocks which changed since the last statusline
+ * update. Falls back to draw_bars() if any block changed its width, as the
+ * other blocks move then.
+ *
+ */
+void draw_statusline_changes(void);
+
 /*
  * Redraw the bars, i.e. simply copy the buffer to the barwindow
  *
@@ -64,6 +64,9 @@ struct statusline_head statusline_buffer = TAILQ_HEAD_INITIALIZER(statusline_buf
 
 int child_stdin;
 
+/* Whether a block of the last statusline update was urgent. */
+static bool had_urgent = false;
+
 /*
  * Remove all blocks from the given statusline.
  * If free_resources is set, the fields of each status block will be free'd.
@@ -97,6 +100,49 @@ static void copy_statusline(struct statusline_head *from, struct statusline_head
     }
 }
 
+/*
+ * Returns true if the two (possibly NULL) strings differ.
+ *
+ */
+static bool strings_differ(const char *a, const char *b) {
+    if (a == NULL || b == NULL)
+        return (a != b);
+    return (strcmp(a, b) != 0);
+}
+
+/*
+ * Returns true if the two (possibly NULL) texts differ in content or markup.
+ *
+ */
+static bool texts_differ(i3String *a, i3String *b) {
+    if (a == NULL || b == NULL)
+        return (a != b);
+    return (i3string_is_markup(a) != i3string_is_markup(b) ||
+            strcmp(i3string_as_utf8(a), i3string_as_utf8(b)) != 0);
+}
+
+/*
+ * Returns true if the given blocks look different on the bar. The name and
+ * instance are not drawn and thus not compared.
+ *
+ */
+static bool blocks_differ(struct status_block *a, struct status_block *b) {
+    return (texts_differ(a->full_text, b->full_text) ||
+            texts_differ(a->short_text, b->short_text) ||
+            strings_differ(a->color, b->color) ||
+            strings_differ(a->background, b->background) ||
+            strings_differ(a->border, b->border) ||
+            a->min_width != b->min_width ||
+            a->align != b->align ||
+            a->urgent != b->urgent ||
+            a->no_separator != b->no_separator ||
+            a->border_top != b->border_top ||
+            a->border_right != b->border_right ||
+            a->border_bottom != b->border_bottom ||
+            a->border_left != b->border_left ||
+            a->sep_block_width != b->sep_block_width);
+}
+
 /*
  * Replaces the statusline in memory with an error message. Pass a format
  * string and format parameters as you would in `printf'. The next time
@@ -324,12 +370,22 @@ static int stdin_end_map(void *context) {
  * Copy it from the buffer to the actual statusline.
  */
 static int stdin_end_array(void *context) {
+    /* Compare each block to the one at the same position in the previous
+     * statusline, so that draw_statusline_changes() only redraws the blocks
+     * which actually changed. */
+    struct status_block *current;
+    struct status_block *previous = TAILQ_FIRST(&statusline_head);
+    TAILQ_FOREACH(current, &statusline_buffer, blocks) {
+        current->changed = (previous == NULL || blocks_differ(previous, current));
+        if (previous != NULL)
+            previous = TAILQ_NEXT(previous, blocks);
+    }
+
     DLOG("copying statusline_buffer to statusline_head\n");
     clear_statusline(&statusline_head, true);
     copy_statusline(&statusline_buffer, &statusline_head);
 
     DLOG("dumping statusline:\n");
-    struct status_block *current;
     TAILQ_FOREACH(current, &statusline_head, blocks) {
         DLOG("full_text = %s\n", i3string_as_utf8(current->full_text));
         DLOG("short_text = %s\n", (current->short_text == NULL ? NULL : i3string_as_utf8(current->short_text)));
@@ -386,8 +442,6 @@ static unsigned char *get_buffer(ev_io *watcher, int *ret_buffer_len) {
 
 static void read_flat_input(char *buffer, int length) {
     struct status_block *first = TAILQ_FIRST(&statusline_head);
-    /* Clear the old buffer if any. */
-    I3STRING_FREE(first->full_text);
     /* Remove the trailing newline and terminate the string at the same
      * time. */
     if (buffer[length - 1] == '\n' || buffer[length - 1] == '\r') {
@@ -396,6 +450,13 @@ static void read_flat_input(char *buffer, int length) {
         buffer[length] = '\0';
     }
 
+    first->changed = (first->full_text == NULL ||
+                      strcmp(i3string_as_utf8(first->full_text), buffer) != 0);
+    if (!first->changed)
+        return;
+
+    /* Clear the old buffer if any. */
+    I3STRING_FREE(first->full_text);
     first->full_text = i3string_from_utf8(buffer);
 }
 
@@ -438,7 +499,13 @@ static void stdin_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
         read_flat_input((char *)buffer, rec);
     }
     free(buffer);
-    draw_bars(has_urgent);
+    /* The bar might have been shown because of an urgent block, so it has to
+     * be hidden again (see draw_bars()) when the urgency is gone. */
+    if (has_urgent || had_urgent)
+        draw_bars(has_urgent);
+    else
+        draw_statusline_changes();
+    had_urgent = has_urgent;
 }
 
 /*
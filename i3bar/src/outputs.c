@@ -150,6 +150,8 @@ static int outputs_start_map_cb(void *params_) {
         new_output->ws = 0,
         new_output->statusline_width = 0;
         new_output->statusline_short_text = false;
+        new_output->statusline_x = 0;
+        new_output->statusline_visible_width = 0;
         memset(&new_output->rect, 0, sizeof(rect));
         memset(&new_output->bar, 0, sizeof(surface_t));
         memset(&new_output->buffer, 0, sizeof(surface_t));
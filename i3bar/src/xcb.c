@@ -140,6 +140,16 @@ static const int tray_loff_px = 2;
 /* Vertical offset between the bar and a separator */
 static const int sep_voff_px = 4;
 
+/* The width of every status block, using its full and its short text, as of
+ * the last time the statusline was drawn. Used to find out whether the blocks
+ * can be redrawn in place by draw_statusline_changes(). */
+struct drawn_block_width {
+    uint32_t full;
+    uint32_t short_text;
+};
+static struct drawn_block_width *drawn_block_widths = NULL;
+static int num_drawn_blocks = 0;
+
 int _xcb_request_failed(xcb_void_cookie_t cookie, char *err_msg, int line) {
     xcb_generic_error_t *err;
     if ((err = xcb_request_check(xcb_connection, cookie)) != NULL) {
@@ -245,6 +255,97 @@ static uint32_t predict_statusline_length(bool use_short_text) {
     return width;
 }
 
+/*
+ * Returns the horizontal space the given block takes up in the statusline,
+ * including its separator.
+ *
+ */
+static uint32_t get_block_width(struct status_block *block, bool use_short_text) {
+    i3String *text = block->full_text;
+    struct status_block_render_desc *render = &block->full_render;
+    if (use_short_text && block->short_text != NULL) {
+        text = block->short_text;
+        render = &block->short_render;
+    }
+
+    if (i3string_get_num_bytes(text) == 0)
+        return 0;
+
+    uint32_t width = render->width + render->x_offset + render->x_append;
+    if (TAILQ_NEXT(block, blocks) != NULL)
+        width += block->sep_block_width;
+    return width;
+}
+
+/*
+ * Draws the given block (and its separator) at x to the output's
+ * statusline_buffer.
+ *
+ */
+static void draw_status_block(i3_output *output, struct status_block *block, uint32_t x, bool use_focus_colors, bool use_short_text) {
+    i3String *text = block->full_text;
+    struct status_block_render_desc *render = &block->full_render;
+    if (use_short_text && block->short_text != NULL) {
+        text = block->short_text;
+        render = &block->short_render;
+    }
+
+    if (i3string_get_num_bytes(text) == 0)
+        return;
+
+    color_t bar_color = (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg);
+    color_t fg_color;
+    if (block->urgent) {
+        fg_color = colors.urgent_ws_fg;
+    } else if (block->color) {
+        fg_color = draw_util_hex_to_color(block->color);
+    } else if (use_focus_colors) {
+        fg_color = colors.focus_bar_fg;
+    } else {
+        fg_color = colors.bar_fg;
+    }
+
+    color_t bg_color = bar_color;
+
+    int full_render_width = render->width + render->x_offset + render->x_append;
+    bool is_border = !!block->border;
+    if (block->border || block->background || block->urgent) {
+        /* Let's determine the colors first. */
+        color_t border_color = bar_color;
+        if (block->urgent) {
+            border_color = colors.urgent_ws_border;
+            bg_color = colors.urgent_ws_bg;
+        } else {
+            if (block->border)
+                border_color = draw_util_hex_to_color(block->border);
+            if (block->background)
+                bg_color = draw_util_hex_to_color(block->background);
+        }
+
+        /* Draw the border. */
+        draw_util_rectangle(&output->statusline_buffer, border_color,
+                            x, logical_px(1),
+                            full_render_width,
+                            bar_height - logical_px(2));
+
+        /* Draw the background. */
+        draw_util_rectangle(&output->statusline_buffer, bg_color,
+                            x + is_border * logical_px(block->border_left),
+                            logical_px(1) + is_border * logical_px(block->border_top),
+                            full_render_width - is_border * logical_px(block->border_right + block->border_left),
+                            bar_height - is_border * logical_px(block->border_bottom + block->border_top) - logical_px(2));
+    }
+
+    draw_util_text(text, &output->statusline_buffer, fg_color, colors.bar_bg,
+                   x + render->x_offset + is_border * logical_px(block->border_left),
+                   bar_height / 2 - font.height / 2,
+                   render->width - is_border * logical_px(block->border_left + block->border_right));
+
+    /* If this is not the last block, draw a separator. */
+    if (TAILQ_NEXT(block, blocks) != NULL)
+        draw_separator(output, x + get_block_width(block, use_short_text), block, use_focus_colors);
+}
+
 /*
  * Redraws the statusline to the output's statusline_buffer
  */
@@ -264,69 +365,8 @@ static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focu
 
     /* Draw the text of each block */
     TAILQ_FOREACH(block, &statusline_head, blocks) {
-        i3String *text = block->full_text;
-        struct status_block_render_desc *render = &block->full_render;
-        if (use_short_text && block->short_text != NULL) {
-            text = block->short_text;
-            render = &block->short_render;
-        }
-
-        if (i3string_get_num_bytes(text) == 0)
-            continue;
-
-        color_t fg_color;
-        if (block->urgent) {
-            fg_color = colors.urgent_ws_fg;
-        } else if (block->color) {
-            fg_color = draw_util_hex_to_color(block->color);
-        } else if (use_focus_colors) {
-            fg_color = colors.focus_bar_fg;
-        } else {
-            fg_color = colors.bar_fg;
-        }
-
-        color_t bg_color = bar_color;
-
-        int full_render_width = render->width + render->x_offset + render->x_append;
-        bool is_border = !!block->border;
-        if (block->border || block->background || block->urgent) {
-            /* Let's determine the colors first. */
-            color_t border_color = bar_color;
-            if (block->urgent) {
-                border_color = colors.urgent_ws_border;
-                bg_color = colors.urgent_ws_bg;
-            } else {
-                if (block->border)
-                    border_color = draw_util_hex_to_color(block->border);
-                if (block->background)
-                    bg_color = draw_util_hex_to_color(block->background);
-            }
-
-            /* Draw the border. */
-            draw_util_rectangle(&output->statusline_buffer, border_color,
-                                x, logical_px(1),
-                                full_render_width,
-                                bar_height - logical_px(2));
-
-            /* Draw the background. */
-            draw_util_rectangle(&output->statusline_buffer, bg_color,
-                                x + is_border * logical_px(block->border_left),
-                                logical_px(1) + is_border * logical_px(block->border_top),
-                                full_render_width - is_border * logical_px(block->border_right + block->border_left),
-                                bar_height - is_border * logical_px(block->border_bottom + block->border_top) - logical_px(2));
-        }
-
-        draw_util_text(text, &output->statusline_buffer, fg_color, colors.bar_bg,
-                       x + render->x_offset + is_border * logical_px(block->border_left),
-                       bar_height / 2 - font.height / 2,
-                       render->width - is_border * logical_px(block->border_left + block->border_right));
-        x += full_render_width;
-
-        /* If this is not the last block, draw a separator. */
-        if (TAILQ_NEXT(block, blocks) != NULL) {
-            x += block->sep_block_width;
-            draw_separator(output, x, block, use_focus_colors);
-        }
+        draw_status_block(output, block, x, use_focus_colors, use_short_text);
+        x += get_block_width(block, use_short_text);
     }
 }
 
@@ -1921,6 +1961,48 @@ void reconfig_windows(bool redraw_bars) {
     }
 }
 
+/*
+ * Remembers the current width of every status block (see
+ * predict_statusline_length()) and marks all blocks as drawn.
+ *
+ */
+static void statusline_drawn(void) {
+    int num_blocks = 0;
+    struct status_block *block;
+    TAILQ_FOREACH(block, &statusline_head, blocks) {
+        num_blocks++;
+    }
+
+    drawn_block_widths = srealloc(drawn_block_widths, num_blocks * sizeof(struct drawn_block_width));
+    num_drawn_blocks = num_blocks;
+
+    int i = 0;
+    TAILQ_FOREACH(block, &statusline_head, blocks) {
+        drawn_block_widths[i].full = get_block_width(block, false);
+        drawn_block_widths[i].short_text = get_block_width(block, true);
+        block->changed = false;
+        i++;
+    }
+}
+
+/*
+ * Returns true if blocks were added, removed or changed their width since the
+ * last call of statusline_drawn().
+ *
+ */
+static bool block_widths_changed(void) {
+    int i = 0;
+    struct status_block *block;
+    TAILQ_FOREACH(block, &statusline_head, blocks) {
+        if (i == num_drawn_blocks ||
+            drawn_block_widths[i].full != get_block_width(block, false) ||
+            drawn_block_widths[i].short_text != get_block_width(block, true))
+            return true;
+        i++;
+    }
+    return (i != num_drawn_blocks);
+}
+
 /*
  * Render the bars, with buttons and statusline
  *
@@ -2055,8 +2137,11 @@ void draw_bars(bool unhide) {
 
             outputs_walk->statusline_width = statusline_width;
             outputs_walk->statusline_short_text = use_short_text;
+            outputs_walk->statusline_x = x_dest;
+            outputs_walk->statusline_visible_width = visible_statusline_width;
         }
     }
+    statusline_drawn();
 
     /* Assure the bar is hidden/unhidden according to the specified hidden_state and mode */
     if (mod_pressed ||
@@ -2070,6 +2155,65 @@ void draw_bars(bool unhide) {
     redraw_bars();
 }
 
+/*
+ * Redraws only the status blocks which changed since the last statusline
+ * update. Falls back to draw_bars() if any block changed its width, as the
+ * other blocks move then.
+ *
+ */
+void draw_statusline_changes(void) {
+    predict_statusline_length(false);
+    predict_statusline_length(true);
+
+    bool needs_full_redraw = block_widths_changed();
+    i3_output *outputs_walk;
+    SLIST_FOREACH(outputs_walk, outputs, slist) {
+        if (outputs_walk->active && outputs_walk->bar.id == XCB_NONE)
+            needs_full_redraw = true;
+    }
+    if (needs_full_redraw) {
+        draw_bars(false);
+        return;
+    }
+
+    DLOG("Drawing changed status blocks...\n");
+
+    SLIST_FOREACH(outputs_walk, outputs, slist) {
+        if (!outputs_walk->active)
+            continue;
+
+        bool use_focus_colors = output_has_focus(outputs_walk);
+        bool use_short_text = outputs_walk->statusline_short_text;
+        color_t bar_color = (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg);
+        int visible_width = outputs_walk->statusline_visible_width;
+
+        /* Same position as in draw_statusline(): everything left of
+         * statusline_buffer is clipped off. */
+        int x = visible_width - outputs_walk->statusline_width;
+        struct status_block *block;
+        TAILQ_FOREACH(block, &statusline_head, blocks) {
+            int width = get_block_width(block, use_short_text);
+            int left = MAX(x, 0);
+            int right = MIN(x + width, visible_width);
+            if (block->changed && left < right) {
+                draw_util_rectangle(&outputs_walk->statusline_buffer, bar_color,
+                                    left, 0, right - left, bar_height);
+                draw_status_block(outputs_walk, block, x, use_focus_colors, use_short_text);
+
+                int x_dest = outputs_walk->statusline_x + left;
+                draw_util_copy_surface(&outputs_walk->statusline_buffer, &outputs_walk->buffer, left, 0,
+                                       x_dest, 0, right - left, bar_height);
+                draw_util_copy_surface(&outputs_walk->buffer, &outputs_walk->bar, x_dest, 0,
+                                       x_dest, 0, right - left, bar_height);
+            }
+            x += width;
+        }
+    }
+    statusline_drawn();
+
+    xcb_flush(xcb_connection);
+}
+
 /*
  * Redraw the bars, i.e. simply copy the buffer to the barwindow
  *
@@ -82,5 +82,7 @@
 #include "fake_outputs.h"
 #include "display_version.h"
 #include "restore_layout.h"
+#include "restart_snapshot.h"
 #include "sync.h"
+#include "stats.h"
 #include "main.h"
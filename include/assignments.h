@@ -11,12 +11,35 @@
 
 #include <config.h>
 
+/**
+ * The window properties which for_window criteria can depend on. Passed to
+ * run_assignments() so that only the assignments which can be affected by the
+ * changed property are checked.
+ *
+ */
+typedef enum {
+    AF_CLASS = 0, /* WM_CLASS, i.e. class and instance */
+    AF_TITLE,
+    AF_ROLE,
+    AF_WINDOW_TYPE,
+    /* All properties, e.g. for a newly managed window. */
+    AF_ALL
+} assignment_field_t;
+
+/**
+ * Rebuilds the index of the for_window assignments which run_assignments()
+ * uses. Needs to be called whenever the list of assignments changed.
+ *
+ */
+void assignments_reindex(void);
+
 /**
  * Checks the list of assignments for the given window and runs all matching
- * ones (unless they have already been run for this specific window).
+ * ones (unless they have already been run for this specific window). Only the
+ * assignments which depend on the given (changed) property are checked.
  *
  */
-void run_assignments(i3Window *window);
+void run_assignments(i3Window *window, assignment_field_t changed);
 
 /**
  * Returns the first matching assignment for the given window.
@@ -37,12 +37,36 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
 void grab_all_keys(xcb_connection_t *conn);
 
 /**
- * Release the button grabs on all managed windows and regrab them,
- * reevaluating which buttons need to be grabbed.
+ * Schedules grabbing the keys again, after translating the keysyms if
+ * translate is true (the keymap changed, not just the XKB group). Repeated
+ * changes are handled once by bindings_update_keys().
+ *
+ */
+void bindings_schedule_key_update(bool translate);
+
+/**
+ * Translates the keysyms and grabs the keys, if scheduled by
+ * bindings_schedule_key_update(). Called before the event loop sleeps and
+ * before looking up a binding.
+ *
+ */
+void bindings_update_keys(void);
+
+/**
+ * Reevaluates which buttons need to be grabbed on the managed windows. The
+ * grabs are only changed when the windows are mapped, see
+ * bindings_update_button_grabs().
  *
  */
 void regrab_all_buttons(xcb_connection_t *conn);
 
+/**
+ * Grabs the buttons on the given window, unless they are grabbed already.
+ * Releases the outdated grabs first, if the buttons to grab changed since.
+ *
+ */
+void bindings_update_button_grabs(i3Window *window);
+
 /**
  * Returns a pointer to the Binding that matches the given xcb event or NULL if
  * no such binding exists.
@@ -326,6 +326,24 @@ void cmd_shmlog(I3_CMD, const char *argument);
  */
 void cmd_debuglog(I3_CMD, const char *argument);
 
+/**
+ * Implementation of 'debuglog modules <module>[,<module>...]'
+ *
+ */
+void cmd_debuglog_modules(I3_CMD, const char *modules);
+
+/**
+ * Implementation of 'debug render-stats'
+ *
+ */
+void cmd_debug_render_stats(I3_CMD);
+
+/**
+ * Implementation of 'debug ipc-stats'
+ *
+ */
+void cmd_debug_ipc_stats(I3_CMD);
+
 /**
  * Implementation of 'gaps inner|outer|top|right|bottom|left|horizontal|vertical current|all set|plus|minus|toggle <px>'
  *
@@ -67,3 +67,28 @@ CommandResult *parse_command(const char *input, yajl_gen gen);
  * Frees a CommandResult
  */
 void command_result_free(CommandResult *result);
+
+typedef struct CommandProgram CommandProgram;
+
+/**
+ * Creates a command program for the given command. It is parsed when it runs
+ * for the first time.
+ *
+ */
+CommandProgram *command_program_new(const char *command);
+
+/**
+ * Executes the given command program, like parse_command() would execute its
+ * command. If ctype is not NULL, the first command is run on the windows
+ * matching ctype=cvalue (e.g. "id" and a window ID), as if the command
+ * started with [ctype="cvalue"].
+ *
+ * Free the returned CommandResult with command_result_free().
+ */
+CommandResult *command_program_run(CommandProgram *program, const char *ctype, const char *cvalue, yajl_gen gen);
+
+/**
+ * Frees the given command program (once it is no longer running).
+ *
+ */
+void command_program_free(CommandProgram *program);
@@ -194,6 +194,22 @@ bool con_exists(Con *con);
  */
 Con *con_by_frame_id(xcb_window_t frame);
 
+/**
+ * Updates the container index so that the given container can be found by
+ * con_by_window_id() and con_by_frame_id() under its current client window and
+ * frame IDs. Needs to be called whenever con->window or con->frame changes.
+ *
+ */
+void con_index_update(Con *con);
+
+/**
+ * Verifies that the container index matches the all_cons list and aborts if
+ * it does not. This walks all containers, so it is only called in debug
+ * builds.
+ *
+ */
+void con_index_check(void);
+
 /**
  * Returns the container with the given mark or NULL if no such container
  * exists.
@@ -522,6 +538,13 @@ gaps_t calculate_effective_gaps(Con *con);
  */
 void con_force_split_parents_redraw(Con *con);
 
+/**
+ * Marks the given container and all of its parents as dirty, so that the next
+ * tree_render() will not skip the workspace containing it.
+ *
+ */
+void con_mark_dirty(Con *con);
+
 /**
  * Returns the window title considering the current title format.
  *
@@ -431,13 +431,6 @@ typedef enum {
  */
 bool load_configuration(const char *override_configfile, config_load_t load_type);
 
-/**
- * Ungrabs all keys, to be called before re-grabbing the keys because of a
- * mapping_notify event or a configuration file reload
- *
- */
-void ungrab_all_keys(xcb_connection_t *conn);
-
 /**
  * Sends the current bar configuration as an event to all barconfig_update listeners.
  *
@@ -204,7 +204,8 @@ struct width_height {
 /**
  * Stores the parameters for rendering a window decoration. This structure is
  * cached in every Con and no re-rendering will be done if the parameters have
- * not changed (only the pixmaps will be copied).
+ * not changed. All zeroes (color == NULL) means that nothing is cached, see
+ * x_invalidate_decoration().
  *
  */
 struct deco_render_params {
@@ -218,6 +219,13 @@ struct deco_render_params {
     bool con_is_leaf;
 };
 
+/**
+ * The number of damaged areas of a container's frame_buffer which are tracked
+ * separately before they are merged into their bounding box.
+ *
+ */
+#define DECO_DAMAGE_RECTS 4
+
 /**
  * Stores which workspace (by name or number) goes to which output and its gaps config.
  *
@@ -232,7 +240,9 @@ struct Workspace_Assignment {
 };
 
 struct Ignore_Event {
+    /* The range of ignored sequence numbers (inclusive). */
     int sequence;
+    int last_sequence;
     int response_type;
     time_t added;
 
@@ -273,6 +283,29 @@ struct regex {
     char *pattern;
     pcre *regex;
     pcre_extra *extra;
+
+    /** Literal text which every matching input has to contain (RL_CONTAINS),
+     * start with (RL_PREFIX) or be equal to (RL_EXACT), so that
+     * regex_matches() can reject most inputs without running PCRE. If
+     * literal_complete is set, the literal test alone decides the match. */
+    enum {
+        RL_NONE = 0,
+        RL_CONTAINS,
+        RL_PREFIX,
+        RL_EXACT
+    } literal_type;
+    char *literal;
+    size_t literal_len;
+    bool literal_complete;
+
+    /** Whether the pattern is the special value __focused__, see
+     * match_matches_window(). */
+    bool focused;
+
+    /** The regex_set this regex belongs to (or NULL) and its index in there.
+     * regex_matches() then evaluates the whole set at once. */
+    struct regex_set *set;
+    int set_index;
 };
 
 /**
@@ -308,13 +341,11 @@ struct Binding {
     enum {
         /* This binding will only be executed upon KeyPress events */
         B_UPON_KEYPRESS = 0,
-        /* This binding will be executed either upon a KeyRelease event, or… */
+        /* This binding will be executed upon a KeyRelease event. Once the
+         * corresponding KeyPress (!) happened, the modifiers no longer need
+         * to match (see get_binding()), so that users can release the
+         * modifier keys before releasing the actual key. */
         B_UPON_KEYRELEASE = 1,
-        /* …upon a KeyRelease event, even if the modifiers don’t match. This
-         * state is triggered from get_binding() when the corresponding
-         * KeyPress (!) happens, so that users can release the modifier keys
-         * before releasing the actual key. */
-        B_UPON_KEYRELEASE_IGNORE_MODS = 2,
     } release;
 
     /** If this is true for a mouse binding, the binding should be executed
@@ -352,6 +383,9 @@ struct Binding {
     /** Command, like in command mode */
     char *command;
 
+    /** The command, parsed once (see command_program_run()) */
+    struct CommandProgram *command_program;
+
     TAILQ_ENTRY(Binding)
     bindings;
 };
@@ -429,6 +463,10 @@ struct xoutput {
 struct Window {
     xcb_window_t id;
 
+    /** Which buttons are grabbed on the window, see
+     * bindings_update_button_grabs(). 0 if none are grabbed yet. */
+    uint32_t button_grabs_generation;
+
     /** Holds the xcb_window_t (just an ID) for the leader window (logical
      * parent for toolwindows and similar floating windows) */
     xcb_window_t leader;
@@ -609,6 +647,9 @@ struct Assignment {
         char *output;
     } dest;
 
+    /** A_COMMAND only: the command, parsed once (see command_program_run()) */
+    struct CommandProgram *command_program;
+
     TAILQ_ENTRY(Assignment)
     assignments;
 };
@@ -636,6 +677,16 @@ struct Con {
      * inside this container (if any) sets the urgency hint, for example. */
     bool urgent;
 
+    /* Set when this container or one of its descendants changed since the
+     * last tree_render() (see con_mark_dirty()). Workspaces which are neither
+     * dirty nor visible are skipped when rendering. */
+    bool dirty;
+
+    /* Only for workspaces: whether this workspace was visible during the last
+     * tree_render(). A workspace which just became invisible needs to be
+     * pushed once more so that its windows get unmapped. */
+    bool rendered_visible;
+
     /** This counter contains the number of UnmapNotify events for this
      * container (or, more precisely, for its ->frame) which should be ignored.
      * UnmapNotify events need to be ignored when they are caused by i3 itself,
@@ -648,6 +699,11 @@ struct Con {
     surface_t frame_buffer;
     bool pixmap_recreated;
 
+    /* The areas of frame_buffer which the decorations of the children were
+     * drawn to since frame_buffer was last copied to the frame. */
+    Rect deco_damage[DECO_DAMAGE_RECTS];
+    int deco_damage_count;
+
     enum {
         CT_ROOT = 0,
         CT_OUTPUT = 1,
@@ -706,7 +762,7 @@ struct Con {
     struct ev_timer *urgency_timer;
 
     /** Cache for the decoration rendering */
-    struct deco_render_params *deco_render_params;
+    struct deco_render_params deco_render_params;
 
     /* Only workspace-containers can have floating clients */
     TAILQ_HEAD(floating_head, Con)
@@ -769,6 +825,22 @@ struct Con {
     TAILQ_ENTRY(Con)
     floating_windows;
 
+    /* Hash chains of the container index (see con_index_update() in
+     * src/con.c), keyed by the Con itself, its client window and its frame. */
+    LIST_ENTRY(Con)
+    index_by_con;
+
+    LIST_ENTRY(Con)
+    index_by_window;
+
+    LIST_ENTRY(Con)
+    index_by_frame;
+
+    /* The client window and frame IDs under which this container is currently
+     * indexed (XCB_NONE means it is not in the respective index). */
+    xcb_window_t indexed_window;
+    xcb_window_t indexed_frame;
+
     /** callbacks */
     void (*on_remove_child)(Con *);
 
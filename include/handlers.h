@@ -28,6 +28,13 @@ extern int shape_base;
  */
 void add_ignore_event(const int sequence, const int response_type);
 
+/**
+ * Like add_ignore_event(), but ignores all sequence numbers from
+ * first_sequence up to and including last_sequence.
+ *
+ */
+void add_ignore_event_range(const int first_sequence, const int last_sequence, const int response_type);
+
 /**
  * Checks if the given sequence is ignored and returns true if so.
  *
@@ -24,12 +24,20 @@
 
 extern char *current_socketpath;
 
+/* The bit of an event type (like I3_IPC_EVENT_WINDOW) in the subscription
+ * bitmask of an ipc_client. */
+#define IPC_EVENT_BIT(message_type) (UINT32_C(1) << ((message_type) & ~I3_IPC_EVENT_MASK))
+
+/* A reference counted message in the output queue of ipc clients, defined in
+ * src/ipc.c. */
+struct ipc_chunk;
+
 typedef struct ipc_client {
     int fd;
 
-    /* The events which this client wants to receive */
-    int num_events;
-    char **events;
+    /* Bitmask of the events which this client wants to receive, see
+     * IPC_EVENT_BIT(). */
+    uint32_t events;
 
     /* For clients which subscribe to the tick event: whether the first tick
      * event has been sent by i3. */
@@ -38,8 +46,33 @@ typedef struct ipc_client {
     struct ev_io *read_callback;
     struct ev_io *write_callback;
     struct ev_timer *timeout;
-    uint8_t *buffer;
-    size_t buffer_size;
+
+    /* The message which is currently being received: read_offset counts the
+     * bytes (header and payload) which arrived so far, read_payload is
+     * allocated once the header is complete. */
+    i3_ipc_header_t read_header;
+    uint8_t *read_payload;
+    size_t read_offset;
+
+    /* Ring of messages waiting to be written to the socket. The first
+     * queue_offset bytes of the oldest message have already been written. */
+    struct ipc_chunk **queue;
+    size_t queue_capacity;
+    size_t queue_start;
+    size_t queue_length;
+    size_t queue_offset;
+    /* Number of bytes currently waiting in the queue. */
+    size_t queued_bytes;
+
+    /* Total number of bytes queued for and dropped from this client (events
+     * are dropped once queued_bytes exceeds ipc_client_queue_limit). */
+    uint64_t bytes_queued;
+    uint64_t bytes_dropped;
+
+    /* The reply to a RUN_COMMAND message which is held back until the
+     * scheduled tree_render() happened (see ipc_send_deferred_replies()). */
+    uint8_t *deferred_reply;
+    size_t deferred_reply_size;
 
     TAILQ_ENTRY(ipc_client)
     clients;
@@ -79,12 +112,26 @@ void ipc_new_client(EV_P_ struct ev_io *w, int revents);
  */
 int ipc_create_socket(const char *filename);
 
+/**
+ * Returns true if any IPC client is subscribed to the given event type (like
+ * I3_IPC_EVENT_WINDOW). Used to avoid serializing events nobody listens to.
+ *
+ */
+bool ipc_has_event_listeners(uint32_t message_type);
+
 /**
  * Sends the specified event to all IPC clients which are currently connected
  * and subscribed to this kind of event.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload);
+void ipc_send_event(uint32_t message_type, const char *payload);
+
+/**
+ * Sends the replies to RUN_COMMAND messages which were waiting for the tree to
+ * be rendered. Called by tree_render().
+ *
+ */
+void ipc_send_deferred_replies(void);
 
 /**
  * Calls to ipc_shutdown() should provide a reason for the shutdown.
@@ -136,3 +183,17 @@ void ipc_send_binding_event(const char *event_type, Binding *bind);
   * socket.
   */
 void ipc_set_kill_timeout(ev_tstamp new);
+
+/**
+ * Set the maximum number of bytes which may wait in the output queue of a
+ * client before events for it are dropped (0 disables the limit).
+ *
+ */
+void ipc_set_client_queue_limit(size_t limit);
+
+/**
+ * Generates a JSON array with the output queue counters of all connected
+ * clients (used by the debug ipc-stats command).
+ *
+ */
+void ipc_dump_client_stats(yajl_gen gen);
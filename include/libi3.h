@@ -447,6 +447,13 @@ bool font_is_pango(void);
 void draw_text(i3String *text, xcb_drawable_t drawable, xcb_gcontext_t gc,
                xcb_visualtype_t *visual, int x, int y, int max_width);
 
+/**
+ * Draws text like draw_text() does, but using the given cairo context. Only
+ * valid for Pango fonts, which avoids creating a cairo surface for every call.
+ *
+ */
+void draw_text_cairo(i3String *text, cairo_t *cr, int x, int y, int max_width);
+
 /**
  * ASCII version of draw_text to print static strings.
  *
@@ -461,6 +468,20 @@ void draw_text_ascii(const char *text, xcb_drawable_t drawable,
  */
 int predict_text_width(i3String *text);
 
+/**
+ * Returns the number of predict_text_width() calls which were answered from
+ * the text width cache (hits) and which had to measure the text (misses).
+ *
+ */
+void text_width_cache_stats(uint64_t *hits, uint64_t *misses);
+
+/**
+ * Returns the number of draw_text() calls with a Pango font which used a
+ * cached layout (hits) and which had to lay out the text (misses).
+ *
+ */
+void text_layout_cache_stats(uint64_t *hits, uint64_t *misses);
+
 /**
  * Returns the visual type associated with the given screen.
  *
@@ -550,6 +571,45 @@ typedef struct placeholder_t {
  */
 char *format_placeholders(char *format, placeholder_t *placeholders, int num);
 
+/** The type of the argument consumed by a printf() conversion. */
+typedef enum {
+    PRINTF_ARG_NONE = 0, /* %% */
+    PRINTF_ARG_INT,      /* also used for %c and the h/hh length modifiers */
+    PRINTF_ARG_LONG,
+    PRINTF_ARG_LLONG,
+    PRINTF_ARG_INTMAX,
+    PRINTF_ARG_SIZE,
+    PRINTF_ARG_PTRDIFF,
+    PRINTF_ARG_DOUBLE,
+    PRINTF_ARG_LDOUBLE,
+    PRINTF_ARG_STRING,
+    PRINTF_ARG_POINTER
+} printf_arg_t;
+
+/** A conversion specification of a printf() format string, see
+ * parse_printf_spec(). */
+typedef struct printf_spec_t {
+    /* Length of the specification in the format string, including the '%'. */
+    size_t len;
+    /* The field width (*) and the precision (.*) are passed as int arguments
+     * preceding the converted argument. */
+    bool width_from_arg;
+    bool precision_from_arg;
+    /* Whether a precision was given and its value (if not passed as an
+     * argument). */
+    bool has_precision;
+    int precision;
+    printf_arg_t type;
+} printf_spec_t;
+
+/**
+ * Parses the printf() conversion specification at the beginning of fmt (which
+ * has to point to a '%'). Returns false for conversions whose argument cannot
+ * be stored in binary form, like %n, %ls or unknown conversions.
+ *
+ */
+bool parse_printf_spec(const char *fmt, printf_spec_t *spec);
+
 /* We need to flush cairo surfaces twice to avoid an assertion bug. See #1989
  * and https://bugs.freedesktop.org/show_bug.cgi?id=92455. */
 #define CAIRO_SURFACE_FLUSH(surface)  \
@@ -13,6 +13,7 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* We will include libi3.h which define its own version of LOG, ELOG.
  * We want *our* version, so we undef the libi3 one. */
@@ -25,11 +26,55 @@
 #if defined(DLOG)
 #undef DLOG
 #endif
+
+/* The modules for which debug logging can be enabled separately (see
+ * set_debug_log_modules()). A file selects its module by defining
+ * I3_LOG_MODULE before including any header; files which do not define it
+ * belong to LOG_MODULE_OTHER. These are preprocessor constants so that DLOG can be
+ * compiled out of the hot modules, see I3_NO_HOT_PATH_DEBUGLOG. */
+#define LOG_MODULE_OTHER 0
+#define LOG_MODULE_RENDER 1
+#define LOG_MODULE_X 2
+#define LOG_MODULE_IPC 3
+#define LOG_MODULE_HANDLERS 4
+#define LOG_MODULE_CON 5
+#define LOG_MODULE_BINDINGS 6
+#define LOG_MODULE_TREE 7
+#define LOG_MODULE_WORKSPACE 8
+#define LOG_MODULE_FLOATING 9
+#define LOG_MODULE_MANAGE 10
+#define LOG_MODULE_CONFIG 11
+#define NUM_LOG_MODULES 12
+
+#if !defined(I3_LOG_MODULE)
+#define I3_LOG_MODULE LOG_MODULE_OTHER
+#endif
+
+/* Bitmask of the modules whose DLOG messages are logged, see
+ * set_debug_log_modules(). */
+extern uint32_t debug_log_modules;
+
+#define DLOG_ENABLED(module) (debug_log_modules & (UINT32_C(1) << (module)))
+
 /** ##__VA_ARGS__ means: leave out __VA_ARGS__ completely if it is empty, that
    is, delete the preceding comma */
 #define LOG(fmt, ...) verboselog(fmt, ##__VA_ARGS__)
 #define ELOG(fmt, ...) errorlog("ERROR: " fmt, ##__VA_ARGS__)
-#define DLOG(fmt, ...) debuglog("%s:%s:%d - " fmt, STRIPPED__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+#if defined(I3_NO_HOT_PATH_DEBUGLOG) && (I3_LOG_MODULE == LOG_MODULE_RENDER || I3_LOG_MODULE == LOG_MODULE_X)
+/* Debug logging of the render path is compiled out (./configure
+ * --disable-hot-path-debuglog). The arguments are still type-checked. */
+#define DLOG(fmt, ...)                                                                            \
+    do {                                                                                          \
+        if (0)                                                                                    \
+            debuglog("%s:%s:%d - " fmt, STRIPPED__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+    } while (0)
+#else
+#define DLOG(fmt, ...)                                                                            \
+    do {                                                                                          \
+        if (DLOG_ENABLED(I3_LOG_MODULE))                                                          \
+            debuglog("%s:%s:%d - " fmt, STRIPPED__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+    } while (0)
+#endif
 
 extern char *errorfilename;
 extern char *shmlogname;
@@ -66,6 +111,22 @@ bool get_debug_logging(void);
  */
 void set_debug_logging(const bool _debug_logging);
 
+/**
+ * Returns the name of the given log module (e.g. "render").
+ *
+ */
+const char *log_module_name(int module);
+
+/**
+ * Changes the modules for which debug messages are logged. spec is a
+ * comma-separated list of module names (or "all"), each optionally prefixed
+ * with + or - to enable or disable it. Without a prefix on the first entry,
+ * only the listed modules are enabled. Returns false (and leaves the modules
+ * unchanged) if spec contains an unknown module.
+ *
+ */
+bool set_debug_log_modules(const char *spec);
+
 /**
  * Set verbosity of i3. If verbose is set to true, informative messages will
  * be printed to stdout. If verbose is set to false, only errors will be
@@ -36,6 +36,14 @@ bool match_is_empty(Match *match);
  */
 void match_copy(Match *dest, Match *src);
 
+/**
+ * Marks the regex sets of the assignment and swallow criteria as outdated.
+ * Needs to be called after adding assignments or swallow criteria (removing
+ * them is fine, see regex_free()).
+ *
+ */
+void match_invalidate_sets(void);
+
 /**
  * Check if a match data structure matches the given window.
  *
@@ -29,10 +29,34 @@ struct regex *regex_new(const char *pattern);
  */
 void regex_free(struct regex *regex);
 
+/**
+ * Creates a new, empty regex set. See regex_set_add().
+ *
+ */
+struct regex_set *regex_set_new(void);
+
+/**
+ * Adds the given regex to the set, unless it already belongs to a set. From
+ * then on, regex_matches() on it evaluates all members of the set at once and
+ * caches the result for the input.
+ *
+ */
+void regex_set_add(struct regex_set *set, struct regex *regex);
+
+/**
+ * Frees the given regex set. Its members are not freed, but removed from the
+ * set.
+ *
+ */
+void regex_set_free(struct regex_set *set);
+
 /**
  * Checks if the given regular expression matches the given input and returns
  * true if it does. In either case, it logs the outcome using LOG(), so it will
  * be visible without debug logging.
  *
+ * If the regex belongs to a regex_set, all members of the set are matched at
+ * once, so that checking the others against the same input is a lookup.
+ *
  */
 bool regex_matches(struct regex *regex, const char *input);
@@ -0,0 +1,53 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * restart_snapshot.c: Compact binary snapshot of the tree, used instead of the
+ *                     JSON layout for inplace restarts.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Serializes the whole tree (like dump_node() with inplace_restart = true
+ * does) into a newly allocated buffer. The length of the snapshot is stored
+ * in *length.
+ *
+ */
+char *restart_snapshot_generate(size_t *length);
+
+/**
+ * Stores the given snapshot in an anonymous in-memory file which is inherited
+ * by the restarted i3. Returns the path to pass in I3_RESTART_SNAPSHOT or NULL
+ * if no such file could be created (e.g. memfd_create() is not available), in
+ * which case only the JSON layout is restored.
+ *
+ */
+char *restart_snapshot_store(const char *snapshot, size_t length);
+
+/**
+ * Returns the file descriptor of a path returned by restart_snapshot_store(),
+ * or -1 if path refers to a regular file.
+ *
+ */
+int restart_snapshot_inherited_fd(const char *path);
+
+/**
+ * Returns true if buf starts with the header of a snapshot, in which case it
+ * should be loaded with restart_snapshot_load() instead of as JSON.
+ *
+ */
+bool restart_snapshot_detect(const char *buf, size_t len);
+
+/**
+ * Restores the tree from the given snapshot and attaches it to parent,
+ * mirroring what tree_append_json() does for the JSON layout. Returns false
+ * if the snapshot is invalid or was written by an incompatible version of i3,
+ * in which case nothing was attached.
+ *
+ */
+bool restart_snapshot_load(Con *parent, const char *buf, size_t len);
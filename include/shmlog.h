@@ -25,6 +25,19 @@ extern const int default_shmlog_size;
  *
  */
 typedef struct i3_shmlog_header {
+    /* Sequence lock: incremented before and after i3 modifies the
+     * ringbuffer, i.e. odd while a record is written. Readers retry reading
+     * the header until they got a copy during which it was even and did not
+     * change. */
+    uint32_t lock;
+
+    /* Sequence number of the next record. */
+    uint64_t next_seq;
+
+    /* Sequence number of the oldest complete record. Records with a lower
+     * sequence number were (or are being) overwritten. */
+    uint64_t oldest_seq;
+
     /* Byte offset where the next line will be written to. */
     uint32_t offset_next_write;
 
@@ -41,10 +54,69 @@ typedef struct i3_shmlog_header {
      * and don’t matter — clients use an equality check (==). */
     uint32_t wrap_count;
 
+    /* Byte offset of the record with the sequence number oldest_seq. */
+    uint32_t offset_oldest;
+
+    /* Byte offset and size of the format string table, which follows the
+     * ringbuffer. It holds the NUL-terminated format strings of all logged
+     * messages, the format_id of a record is the offset of its format string
+     * within the table. */
+    uint32_t offset_formats;
+    uint32_t formats_size;
+    uint32_t formats_used;
+
+    /* Difference between CLOCK_REALTIME and CLOCK_MONOTONIC (in nanoseconds)
+     * when the log was opened. Used to convert timestamps of records to the
+     * wall-clock time. */
+    int64_t realtime_offset;
+
+    /* Number of processes (i3-dump-log -f) waiting for the condvar. i3 only
+     * broadcasts the condvar if this is non-zero. Modified atomically. */
+    uint32_t followers;
+
 #if !defined(__OpenBSD__)
     /* pthread condvar which will be broadcasted whenever there is a new
-     * message in the log. i3-dump-log uses this to implement -f (follow, like
+     * message in the log (if there are followers). i3-dump-log uses this to implement -f (follow, like
      * tail -f) in an efficient way. */
     pthread_cond_t condvar;
 #endif
 } i3_shmlog_header;
+
+/* format_id of records which contain text formatted by i3 instead of packed
+ * arguments (for format strings which cannot be packed or when the format
+ * table is full). */
+#define SHMLOG_FORMAT_TEXT UINT32_MAX
+
+/* Maximum size of a record, including the packed arguments. */
+#define SHMLOG_MAX_RECORD_SIZE 4096
+
+/**
+ * A message in the ringbuffer of the shmlog. To keep logging cheap, i3 does
+ * not format messages. The record is followed by the arguments in binary
+ * form, which i3-dump-log formats using the format string:
+ *
+ * - integers, doubles and pointers (and field widths/precisions passed as an
+ *   argument) take 8 bytes (int64_t, double or uint64_t)
+ * - strings are stored as an uint32_t length followed by the bytes, without
+ *   NUL-termination
+ *
+ * Records of the type SHMLOG_FORMAT_TEXT contain a single string.
+ * Records are aligned to 8 bytes. A record which does not fit at the end of
+ * the ringbuffer is written to its beginning instead; readers notice this
+ * because the record at their position does not have the expected sequence
+ * number.
+ *
+ */
+typedef struct i3_shmlog_record {
+    /* Size of the record in bytes, including this header and padding. */
+    uint32_t size;
+
+    /* Offset of the format string in the format table or SHMLOG_FORMAT_TEXT. */
+    uint32_t format_id;
+
+    /* Sequence number of the record, incremented by one for every record. */
+    uint64_t seq;
+
+    /* CLOCK_MONOTONIC time at which the message was logged, in nanoseconds. */
+    uint64_t timestamp;
+} i3_shmlog_record;
@@ -0,0 +1,103 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.h: Latency histograms and counters of the main loop, reported via the
+ *          GET_STATS IPC message.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <yajl/yajl_gen.h>
+
+/**
+ * The phases of the main loop whose latency is measured. Phases nest: an IPC
+ * message may execute a command which renders the tree, so the time spent in
+ * tree_render() is also part of the command and the IPC phase.
+ *
+ */
+typedef enum {
+    /* One xcb_prepare_cb() call: handling all pending X11 events and the
+     * deferred render. */
+    STATS_PHASE_PREPARE = 0,
+    /* One handle_event() call from the main loop. */
+    STATS_PHASE_X_EVENT,
+    STATS_PHASE_RENDER,
+    STATS_PHASE_X_PUSH_CHANGES,
+    /* Handling one IPC message (including its reply). */
+    STATS_PHASE_IPC,
+    /* One parse_command() call, i.e. a list of commands. */
+    STATS_PHASE_COMMAND,
+    STATS_NUM_PHASES
+} stats_phase_t;
+
+/**
+ * Counters of the main loop. Everything is counted since startup or the last
+ * stats_reset().
+ *
+ */
+struct loop_stats {
+    /* X11 events handled by the main loop, per response type (with the
+     * "generated" bit stripped). */
+    uint64_t x_events[128];
+
+    uint64_t ipc_bytes_in;
+    uint64_t ipc_bytes_out;
+
+    /* Commands executed (a list like "focus left; kill" counts as two). */
+    uint64_t commands;
+};
+extern struct loop_stats loop_stats;
+
+/**
+ * Returns the current time of the monotonic clock in nanoseconds, to be
+ * passed to stats_record() at the end of the phase.
+ *
+ */
+uint64_t stats_now(void);
+
+/**
+ * Records that the given phase, started at start (see stats_now()), ended now.
+ *
+ */
+void stats_record(stats_phase_t phase, uint64_t start);
+
+/**
+ * Adds the X11 requests sent since the last call to the request counter.
+ * sequence is the sequence number of a request which was just sent.
+ *
+ */
+void stats_count_x_requests(unsigned int sequence);
+
+/**
+ * Makes tree_render() count its X11 requests from now on. Called when
+ * statistics are requested for the first time, so that i3 does not send the
+ * additional requests this needs unless someone is interested.
+ *
+ */
+void stats_enable_x_request_counting(void);
+
+/**
+ * Returns whether tree_render() should count its X11 requests.
+ *
+ */
+bool stats_counting_x_requests(void);
+
+/**
+ * Generates the GET_STATS reply: a map with the counters and one histogram
+ * summary per phase.
+ *
+ */
+void stats_dump(yajl_gen gen);
+
+/**
+ * Resets all histograms and counters. Needs the X11 connection.
+ *
+ */
+void stats_reset(void);
@@ -18,6 +18,37 @@ extern Con *focused;
 TAILQ_HEAD(all_cons_head, Con);
 extern struct all_cons_head all_cons;
 
+/**
+ * Counters describing the work done by tree_render(), reported by the
+ * 'debug render-stats' command. The last_* counters are reset at the beginning
+ * of every tree_render(), the total_* counters accumulate since startup.
+ *
+ */
+struct render_stats {
+    uint64_t renders;
+
+    /* Number of render_con() and x_push_node() calls. */
+    uint32_t last_nodes_rendered;
+    uint32_t last_nodes_pushed;
+    uint64_t total_nodes_rendered;
+    uint64_t total_nodes_pushed;
+
+    /* Workspaces which were neither visible nor dirty and therefore not
+     * visited at all. */
+    uint32_t last_workspaces_skipped;
+    uint64_t total_workspaces_skipped;
+
+    /* Number of X11 requests sent while rendering. */
+    uint32_t last_x_requests;
+    uint64_t total_x_requests;
+
+    /* Number of frames restacked by the last (and by all) x_push_changes()
+     * calls, including those not caused by tree_render(). */
+    uint32_t last_restacks;
+    uint64_t total_restacks;
+};
+extern struct render_stats render_stats;
+
 /**
  * Initializes the tree by creating the root node, adding all RandR outputs
  * to the tree (that means randr_init() has to be called before) and
@@ -55,9 +86,28 @@ bool level_down(void);
  * Renders the tree, that is rendering all outputs using render_con() and
  * pushing the changes to X11 using x_push_changes().
  *
+ * Invisible workspaces are only visited if they changed since the last call
+ * (see workspace_needs_render()).
+ *
  */
 void tree_render(void);
 
+/**
+ * Schedules a tree_render(). The tree will be rendered exactly once right
+ * before the event loop blocks again (see xcb_prepare_cb() in src/main.c), no
+ * matter how many events or IPC commands requested it in the meantime.
+ *
+ */
+void tree_render_later(void);
+
+/**
+ * Renders the tree now if tree_render_later() was called since the last
+ * tree_render(). Used before acting on state which depends on the rendered
+ * tree, like input events or sync requests. Returns whether it rendered.
+ *
+ */
+bool tree_render_if_needed(void);
+
 /**
  * Changes focus in the given way (next/previous) and given orientation
  * (horizontal/vertical).
@@ -65,6 +65,13 @@ bool rect_contains(Rect rect, uint32_t x, uint32_t y);
 Rect rect_add(Rect a, Rect b);
 Rect rect_sub(Rect a, Rect b);
 
+/**
+ * Returns the bucket for the given key (a pointer or an X11 ID) in a hash
+ * table with the given number of buckets, which must be a power of two.
+ *
+ */
+__attribute__((const)) size_t hash_bucket(uint64_t key, size_t size);
+
 /**
  * Returns true if the name consists of only digits.
  *
@@ -88,6 +88,15 @@ Con *create_workspace_on_output(Output *output, Con *content);
  */
 bool workspace_is_visible(Con *ws);
 
+/**
+ * Returns true if the given workspace has to be visited by the next
+ * tree_render(): visible workspaces are always rendered, invisible ones only if
+ * they changed (see con_mark_dirty()) or if they were visible during the
+ * previous tree_render() and therefore still need to be unmapped.
+ *
+ */
+bool workspace_needs_render(Con *ws);
+
 /**
  * Switches to the given workspace
  *
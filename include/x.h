@@ -67,6 +67,13 @@ bool window_supports_protocol(xcb_window_t window, xcb_atom_t atom);
  */
 void x_window_kill(xcb_window_t window, kill_window_t kill_window);
 
+/**
+ * Forces the decoration of the given container to be redrawn on the next
+ * render.
+ *
+ */
+void x_invalidate_decoration(Con *con);
+
 /**
  * Draws the decoration of the given container onto its parent.
  *
@@ -130,6 +130,14 @@ static void draw_util_set_source_color(surface_t *surface, color_t color) {
 void draw_util_text(i3String *text, surface_t *surface, color_t fg_color, color_t bg_color, int x, int y, int max_width) {
     RETURN_UNLESS_SURFACE_INITIALIZED(surface);
 
+    if (font_is_pango()) {
+        /* Pango draws using cairo, so there is no need to flush or to use
+         * another cairo surface for the same drawable. */
+        set_font_colors(surface->gc, fg_color, bg_color);
+        draw_text_cairo(text, surface->cr, x, y, max_width);
+        return;
+    }
+
     /* Flush any changes before we draw the text as this might use XCB directly. */
     CAIRO_SURFACE_FLUSH(surface->surface);
 
@@ -17,14 +17,156 @@
 #include <cairo/cairo-xcb.h>
 #include <pango/pangocairo.h>
 
+#include "queue.h"
+
 static const i3Font *savedFont = NULL;
 
+/* predict_text_width() and draw_text() are called for every title and status
+ * block on every redraw, mostly with unchanged strings, but measuring and
+ * laying out text is expensive: Pango shapes the text every time and core
+ * fonts without a glyph table need a round trip to the X server. Therefore,
+ * the widths and Pango layouts of recently used strings are kept in a hash
+ * table with LRU eviction. */
+#define TEXT_CACHE_SIZE 512
+#define TEXT_CACHE_BUCKETS 1024
+
+struct text_cache_entry {
+    /* The key: font, markup flag, maximum width and the UTF-8 text. */
+    const i3Font *font;
+    bool markup;
+    /* The width passed to draw_text() for a cached layout or -1 for a width
+     * cached by predict_text_width(). */
+    int max_width;
+    uint32_t hash;
+    char *text;
+    size_t text_len;
+
+    int width;
+    /* The laid out text, only for Pango fonts. */
+    PangoLayout *layout;
+
+    /* The next entry in the same bucket. */
+    struct text_cache_entry *next;
+
+    TAILQ_ENTRY(text_cache_entry)
+    lru;
+};
+
+static struct text_cache_entry *text_cache_buckets[TEXT_CACHE_BUCKETS];
+static TAILQ_HEAD(text_cache_lru_head, text_cache_entry) text_cache_lru =
+    TAILQ_HEAD_INITIALIZER(text_cache_lru);
+static int text_cache_entries;
+static uint64_t text_width_hits;
+static uint64_t text_width_misses;
+static uint64_t text_layout_hits;
+static uint64_t text_layout_misses;
+
 static xcb_visualtype_t *root_visual_type;
 static double pango_font_red;
 static double pango_font_green;
 static double pango_font_blue;
 static double pango_font_alpha;
 
+/*
+ * Returns the FNV-1a hash of the given key.
+ *
+ */
+static uint32_t text_cache_hash(const char *text, size_t text_len, bool markup, int max_width) {
+    uint32_t hash = 2166136261u ^ markup;
+    hash = (hash ^ (uint32_t)max_width) * 16777619u;
+    for (size_t i = 0; i < text_len; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Returns the cache entry for the given text (with the current font) and
+ * marks it as the most recently used one, or NULL if it is not cached.
+ *
+ */
+static struct text_cache_entry *text_cache_lookup(uint32_t hash, const char *text, size_t text_len,
+                                                  bool markup, int max_width) {
+    for (struct text_cache_entry *entry = text_cache_buckets[hash % TEXT_CACHE_BUCKETS];
+         entry != NULL;
+         entry = entry->next) {
+        if (entry->hash == hash &&
+            entry->font == savedFont &&
+            entry->markup == markup &&
+            entry->max_width == max_width &&
+            entry->text_len == text_len &&
+            memcmp(entry->text, text, text_len) == 0) {
+            TAILQ_REMOVE(&text_cache_lru, entry, lru);
+            TAILQ_INSERT_HEAD(&text_cache_lru, entry, lru);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void text_cache_free_value(struct text_cache_entry *entry) {
+    free(entry->text);
+    if (entry->layout != NULL)
+        g_object_unref(entry->layout);
+}
+
+/*
+ * Adds an entry for the given text (with the current font), evicting the
+ * least recently used entry if the cache is full. The caller fills in the
+ * cached values.
+ *
+ */
+static struct text_cache_entry *text_cache_insert(uint32_t hash, const char *text, size_t text_len,
+                                                  bool markup, int max_width) {
+    struct text_cache_entry *entry;
+    if (text_cache_entries < TEXT_CACHE_SIZE) {
+        entry = smalloc(sizeof(struct text_cache_entry));
+        text_cache_entries++;
+    } else {
+        /* Evict the least recently used entry and reuse it. */
+        entry = TAILQ_LAST(&text_cache_lru, text_cache_lru_head);
+        TAILQ_REMOVE(&text_cache_lru, entry, lru);
+        struct text_cache_entry **link = &(text_cache_buckets[entry->hash % TEXT_CACHE_BUCKETS]);
+        while (*link != entry)
+            link = &((*link)->next);
+        *link = entry->next;
+        text_cache_free_value(entry);
+    }
+
+    entry->font = savedFont;
+    entry->markup = markup;
+    entry->max_width = max_width;
+    entry->hash = hash;
+    entry->text = smalloc(text_len + 1);
+    memcpy(entry->text, text, text_len);
+    entry->text[text_len] = '\0';
+    entry->text_len = text_len;
+    entry->width = 0;
+    entry->layout = NULL;
+
+    struct text_cache_entry **bucket = &(text_cache_buckets[hash % TEXT_CACHE_BUCKETS]);
+    entry->next = *bucket;
+    *bucket = entry;
+    TAILQ_INSERT_HEAD(&text_cache_lru, entry, lru);
+    return entry;
+}
+
+/*
+ * Removes all entries from the text cache.
+ *
+ */
+static void text_cache_clear(void) {
+    while (!TAILQ_EMPTY(&text_cache_lru)) {
+        struct text_cache_entry *entry = TAILQ_FIRST(&text_cache_lru);
+        TAILQ_REMOVE(&text_cache_lru, entry, lru);
+        text_cache_free_value(entry);
+        free(entry);
+    }
+    memset(text_cache_buckets, 0, sizeof(text_cache_buckets));
+    text_cache_entries = 0;
+}
+
 static PangoLayout *create_layout_with_dpi(cairo_t *cr) {
     PangoLayout *layout;
     PangoContext *context;
@@ -80,6 +222,57 @@ static bool load_pango_font(i3Font *font, const char *desc) {
     return true;
 }
 
+/*
+ * Draws text using Pango rendering onto the given cairo context. The layout
+ * of the text is cached, so redrawing an unchanged text only draws the
+ * already shaped glyphs.
+ *
+ */
+static void draw_text_pango_cairo(const char *text, size_t text_len, cairo_t *cr,
+                                  int x, int y, int max_width, bool pango_markup) {
+    const uint32_t hash = text_cache_hash(text, text_len, pango_markup, max_width);
+    struct text_cache_entry *entry = text_cache_lookup(hash, text, text_len, pango_markup, max_width);
+    if (entry != NULL && entry->layout != NULL) {
+        text_layout_hits++;
+        /* Only invalidates the layout if cr uses different font options or
+         * another transformation than the context it was created with. */
+        pango_cairo_update_layout(cr, entry->layout);
+    } else {
+        text_layout_misses++;
+        if (entry == NULL)
+            entry = text_cache_insert(hash, text, text_len, pango_markup, max_width);
+
+        PangoLayout *layout = create_layout_with_dpi(cr);
+        pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
+        pango_layout_set_width(layout, max_width * PANGO_SCALE);
+        pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
+        pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+
+        if (pango_markup)
+            pango_layout_set_markup(layout, text, text_len);
+        else
+            pango_layout_set_text(layout, text, text_len);
+
+        pango_cairo_update_layout(cr, layout);
+        entry->layout = layout;
+    }
+    gint height;
+    pango_layout_get_pixel_size(entry->layout, NULL, &height);
+
+    /* Do the drawing */
+    cairo_save(cr);
+    /* Clip like the surface which draw_text_pango() creates. */
+    cairo_rectangle(cr, 0, 0, x + max_width, y + savedFont->height);
+    cairo_clip(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_rgba(cr, pango_font_red, pango_font_green, pango_font_blue, pango_font_alpha);
+    /* Center the piece of text vertically. */
+    int yoffset = (height - savedFont->height) / 2;
+    cairo_move_to(cr, x, y - yoffset);
+    pango_cairo_show_layout(cr, entry->layout);
+    cairo_restore(cr);
+}
+
 /*
  * Draws text using Pango rendering.
  *
@@ -87,36 +280,14 @@ static bool load_pango_font(i3Font *font, const char *desc) {
 static void draw_text_pango(const char *text, size_t text_len,
                             xcb_drawable_t drawable, xcb_visualtype_t *visual, int x, int y,
                             int max_width, bool pango_markup) {
-    /* Create the Pango layout */
     /* root_visual_type is cached in load_pango_font */
     cairo_surface_t *surface = cairo_xcb_surface_create(conn, drawable,
                                                         visual, x + max_width, y + savedFont->height);
     cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
-    gint height;
-
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
-    pango_layout_set_width(layout, max_width * PANGO_SCALE);
-    pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
-    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
-
-    if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
-    else
-        pango_layout_set_text(layout, text, text_len);
 
-    /* Do the drawing */
-    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    cairo_set_source_rgba(cr, pango_font_red, pango_font_green, pango_font_blue, pango_font_alpha);
-    pango_cairo_update_layout(cr, layout);
-    pango_layout_get_pixel_size(layout, NULL, &height);
-    /* Center the piece of text vertically. */
-    int yoffset = (height - savedFont->height) / 2;
-    cairo_move_to(cr, x, y - yoffset);
-    pango_cairo_show_layout(cr, layout);
+    draw_text_pango_cairo(text, text_len, cr, x, y, max_width, pango_markup);
 
     /* Free resources */
-    g_object_unref(layout);
     cairo_destroy(cr);
     cairo_surface_destroy(surface);
 }
@@ -253,6 +424,10 @@ i3Font load_font(const char *pattern, const bool fallback) {
  *
  */
 void set_font(i3Font *font) {
+    /* The font is part of the key of the text cache, so switching
+     * between fonts (like i3-config-wizard does) keeps the cached widths.
+     * A font which is replaced by load_font() is freed first, which clears
+     * the cache. */
     savedFont = font;
 }
 
@@ -284,6 +459,7 @@ void free_font(void) {
     }
 
     savedFont = NULL;
+    text_cache_clear();
 }
 
 /*
@@ -384,6 +560,18 @@ void draw_text(i3String *text, xcb_drawable_t drawable, xcb_gcontext_t gc,
     }
 }
 
+/*
+ * Draws text like draw_text() does, but using the given cairo context. Only
+ * valid for Pango fonts, which avoids creating a cairo surface for every call.
+ *
+ */
+void draw_text_cairo(i3String *text, cairo_t *cr, int x, int y, int max_width) {
+    assert(savedFont != NULL && savedFont->type == FONT_TYPE_PANGO);
+
+    draw_text_pango_cairo(i3string_as_utf8(text), i3string_get_num_bytes(text),
+                          cr, x, y, max_width, i3string_is_markup(text));
+}
+
 /*
  * ASCII version of draw_text to print static strings.
  *
@@ -499,16 +687,54 @@ static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
 int predict_text_width(i3String *text) {
     assert(savedFont != NULL);
 
+    if (savedFont->type == FONT_TYPE_NONE)
+        return 0;
+
+    const char *utf8 = i3string_as_utf8(text);
+    const size_t utf8_len = i3string_get_num_bytes(text);
+    const bool markup = i3string_is_markup(text);
+    const uint32_t hash = text_cache_hash(utf8, utf8_len, markup, -1);
+    struct text_cache_entry *entry = text_cache_lookup(hash, utf8, utf8_len, markup, -1);
+    if (entry != NULL) {
+        text_width_hits++;
+        return entry->width;
+    }
+    text_width_misses++;
+
+    int width = 0;
     switch (savedFont->type) {
-        case FONT_TYPE_NONE:
-            /* Nothing to do */
-            return 0;
         case FONT_TYPE_XCB:
-            return predict_text_width_xcb(i3string_as_ucs2(text), i3string_get_num_glyphs(text));
+            width = predict_text_width_xcb(i3string_as_ucs2(text), i3string_get_num_glyphs(text));
+            break;
         case FONT_TYPE_PANGO:
             /* Calculate extents using Pango */
-            return predict_text_width_pango(i3string_as_utf8(text), i3string_get_num_bytes(text),
-                                            i3string_is_markup(text));
+            width = predict_text_width_pango(utf8, utf8_len, markup);
+            break;
+        default:
+            assert(false);
     }
-    assert(false);
+
+    entry = text_cache_insert(hash, utf8, utf8_len, markup, -1);
+    entry->width = width;
+    return width;
+}
+
+/*
+ * Returns the number of predict_text_width() calls which were answered from
+ * the text width cache (hits) and which had to measure the text (misses).
+ *
+ */
+void text_width_cache_stats(uint64_t *hits, uint64_t *misses) {
+    *hits = text_width_hits;
+    *misses = text_width_misses;
+}
+
+/*
+ * Returns the number of draw_text() calls with a Pango font which used a
+ * cached layout (hits) and which had to lay out the text (misses).
+ *
+ */
+void text_layout_cache_stats(uint64_t *hits, uint64_t *misses) {
+    *hits = text_layout_hits;
+    *misses = text_layout_misses;
 }
@@ -0,0 +1,132 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ */
+#include "libi3.h"
+
+#include <ctype.h>
+#include <string.h>
+
+/*
+ * Parses the printf() conversion specification at the beginning of fmt (which
+ * has to point to a '%'). Returns false for conversions whose argument cannot
+ * be stored in binary form, like %n, %ls or unknown conversions.
+ *
+ */
+bool parse_printf_spec(const char *fmt, printf_spec_t *spec) {
+    const char *walk = fmt + 1;
+    memset(spec, '\0', sizeof(printf_spec_t));
+
+    /* flags */
+    while (*walk != '\0' && strchr("-+ #0'", *walk) != NULL)
+        walk++;
+
+    /* width */
+    if (*walk == '*') {
+        spec->width_from_arg = true;
+        walk++;
+    } else {
+        while (isdigit((unsigned char)*walk))
+            walk++;
+    }
+
+    /* precision */
+    if (*walk == '.') {
+        spec->has_precision = true;
+        walk++;
+        if (*walk == '*') {
+            spec->precision_from_arg = true;
+            walk++;
+        } else {
+            while (isdigit((unsigned char)*walk)) {
+                spec->precision = spec->precision * 10 + (*walk - '0');
+                walk++;
+            }
+        }
+    }
+
+    /* length modifier */
+    char length = '\0';
+    if (strncmp(walk, "hh", 2) == 0 || strncmp(walk, "ll", 2) == 0) {
+        length = (*walk == 'h' ? 'H' : 'q');
+        walk += 2;
+    } else if (*walk != '\0' && strchr("hljztL", *walk) != NULL) {
+        length = *walk;
+        walk++;
+    }
+
+    switch (*walk) {
+        case '%':
+            spec->type = PRINTF_ARG_NONE;
+            break;
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (length) {
+                case '\0':
+                case 'h':
+                case 'H':
+                    spec->type = PRINTF_ARG_INT;
+                    break;
+                case 'l':
+                    spec->type = PRINTF_ARG_LONG;
+                    break;
+                case 'q':
+                    spec->type = PRINTF_ARG_LLONG;
+                    break;
+                case 'j':
+                    spec->type = PRINTF_ARG_INTMAX;
+                    break;
+                case 'z':
+                    spec->type = PRINTF_ARG_SIZE;
+                    break;
+                case 't':
+                    spec->type = PRINTF_ARG_PTRDIFF;
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        case 'c':
+            if (length != '\0')
+                return false;
+            spec->type = PRINTF_ARG_INT;
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if (length == 'L')
+                spec->type = PRINTF_ARG_LDOUBLE;
+            else if (length == '\0' || length == 'l')
+                spec->type = PRINTF_ARG_DOUBLE;
+            else
+                return false;
+            break;
+        case 's':
+            if (length != '\0')
+                return false;
+            spec->type = PRINTF_ARG_STRING;
+            break;
+        case 'p':
+            if (length != '\0')
+                return false;
+            spec->type = PRINTF_ARG_POINTER;
+            break;
+        default:
+            return false;
+    }
+
+    spec->len = (walk + 1) - fmt;
+    return true;
+}
@@ -21,6 +21,7 @@ state INITIAL:
   'reload' -> call cmd_reload()
   'shmlog' -> SHMLOG
   'debuglog' -> DEBUGLOG
+  'debug' -> DEBUG
   'border' -> BORDER
   'layout' -> LAYOUT
   'append_layout' -> APPEND_LAYOUT
@@ -80,9 +81,23 @@ state SHMLOG:
     -> call cmd_shmlog($argument)
 
 # debuglog toggle|on|off
+# debuglog modules <module>[,<module>...]
 state DEBUGLOG:
   argument = 'toggle', 'on', 'off'
     -> call cmd_debuglog($argument)
+  'modules'
+    -> DEBUGLOG_MODULES
+
+state DEBUGLOG_MODULES:
+  modules = string
+    -> call cmd_debuglog_modules($modules)
+
+# debug render-stats|ipc-stats
+state DEBUG:
+  'render-stats'
+    -> call cmd_debug_render_stats()
+  'ipc-stats'
+    -> call cmd_debug_ipc_stats()
 
 # border normal|pixel [<n>]
 # border none|1pixel|toggle
@@ -53,6 +53,7 @@ state INITIAL:
   'workspace'                              -> WORKSPACE
   'ipc_socket', 'ipc-socket'               -> IPC_SOCKET
   'ipc_kill_timeout'                       -> IPC_KILL_TIMEOUT
+  'ipc_client_queue_limit'                 -> IPC_CLIENT_QUEUE_LIMIT
   'restart_state'                          -> RESTART_STATE
   'popup_during_fullscreen'                -> POPUP_DURING_FULLSCREEN
   exectype = 'exec_always', 'exec'         -> EXEC
@@ -325,6 +326,11 @@ state IPC_KILL_TIMEOUT:
   timeout = number
       -> call cfg_ipc_kill_timeout(&timeout)
 
+# ipc_client_queue_limit <bytes>
+state IPC_CLIENT_QUEUE_LIMIT:
+  limit = number
+      -> call cfg_ipc_client_queue_limit(&limit)
+
 # restart_state <path> (for testcases)
 state RESTART_STATE:
   path = string
@@ -9,20 +9,108 @@
  */
 #include "all.h"
 
+/* The for_window assignments, bucketed by the window properties they depend
+ * on, so that e.g. a title change only checks the assignments whose criteria
+ * refer to the title. Each bucket keeps the order of the config file. The
+ * AF_ALL bucket contains all for_window assignments. */
+static struct assignment_bucket {
+    Assignment **assignments;
+    int num;
+} buckets[AF_ALL + 1];
+
+/*
+ * Returns true if the given criterion uses the special value __focused__,
+ * which makes the match depend on the currently focused window.
+ *
+ */
+static bool matches_focused(struct regex *regex) {
+    return (regex != NULL && regex->focused);
+}
+
+/*
+ * Returns the bitmask of the window properties (1 << assignment_field_t) on
+ * which match_matches_window() depends for the given match.
+ *
+ */
+static int match_fields(Match *match) {
+    const int all_fields = (1 << AF_ALL) - 1;
+
+    /* These criteria depend on the state of the container (or the focus)
+     * rather than on properties of the window, which may change at any time.
+     * Such assignments are checked on every property change. */
+    if (match->urgent != U_DONTCHECK ||
+        match->workspace != NULL ||
+        match->mark != NULL ||
+        match->window_mode != WM_ANY ||
+        matches_focused(match->class) ||
+        matches_focused(match->instance) ||
+        matches_focused(match->title) ||
+        matches_focused(match->window_role))
+        return all_fields;
+
+    int fields = 0;
+    if (match->class != NULL || match->instance != NULL)
+        fields |= (1 << AF_CLASS);
+    if (match->title != NULL)
+        fields |= (1 << AF_TITLE);
+    if (match->window_role != NULL)
+        fields |= (1 << AF_ROLE);
+    if (match->window_type != UINT32_MAX)
+        fields |= (1 << AF_WINDOW_TYPE);
+    return fields;
+}
+
+/*
+ * Rebuilds the index of the for_window assignments which run_assignments()
+ * uses. Needs to be called whenever the list of assignments changed.
+ *
+ */
+void assignments_reindex(void) {
+    for (int field = 0; field <= AF_ALL; field++) {
+        FREE(buckets[field].assignments);
+        buckets[field].num = 0;
+    }
+
+    Assignment *current;
+    TAILQ_FOREACH(current, &assignments, assignments) {
+        if (current->type != A_COMMAND)
+            continue;
+
+        const int fields = match_fields(&(current->match)) | (1 << AF_ALL);
+        for (int field = 0; field <= AF_ALL; field++) {
+            if ((fields & (1 << field)) == 0)
+                continue;
+
+            struct assignment_bucket *bucket = &(buckets[field]);
+            bucket->assignments = srealloc(bucket->assignments, sizeof(Assignment *) * (bucket->num + 1));
+            bucket->assignments[bucket->num++] = current;
+        }
+    }
+
+    /* The assignments of all types are part of the regex sets. */
+    match_invalidate_sets();
+
+    DLOG("Indexed %d for_window assignments (class: %d, title: %d, role: %d, window_type: %d)\n",
+         buckets[AF_ALL].num, buckets[AF_CLASS].num, buckets[AF_TITLE].num,
+         buckets[AF_ROLE].num, buckets[AF_WINDOW_TYPE].num);
+}
+
 /*
  * Checks the list of assignments for the given window and runs all matching
- * ones (unless they have already been run for this specific window).
+ * ones (unless they have already been run for this specific window). Only the
+ * assignments which depend on the given (changed) property are checked.
  *
  */
-void run_assignments(i3Window *window) {
+void run_assignments(i3Window *window, assignment_field_t changed) {
     DLOG("Checking if any assignments match this window\n");
 
     bool needs_tree_render = false;
 
     /* Check if any assignments match */
-    Assignment *current;
-    TAILQ_FOREACH(current, &assignments, assignments) {
-        if (current->type != A_COMMAND || !match_matches_window(&(current->match), window))
+    const struct assignment_bucket *bucket = &(buckets[changed]);
+    for (int i = 0; i < bucket->num; i++) {
+        Assignment *current = bucket->assignments[i];
+        if (!match_matches_window(&(current->match), window))
             continue;
 
         bool skip = false;
@@ -46,10 +134,9 @@ void run_assignments(i3Window *window) {
         window->ran_assignments[window->nr_assignments - 1] = current;
 
         DLOG("matching assignment, execute command %s\n", current->dest.command);
-        char *full_command;
-        sasprintf(&full_command, "[id=\"%d\"] %s", window->id, current->dest.command);
-        CommandResult *result = parse_command(full_command, NULL);
-        free(full_command);
+        char window_id[16];
+        snprintf(window_id, sizeof(window_id), "%d", window->id);
+        CommandResult *result = command_program_run(current->command_program, "id", window_id, NULL);
 
         if (result->needs_tree_render)
             needs_tree_render = true;
@@ -6,6 +6,7 @@
  *
  * bindings.c: Functions for configuring, finding and, running bindings.
  */
+#define I3_LOG_MODULE LOG_MODULE_BINDINGS
 #include "all.h"
 
 #include <xkbcommon/xkbcommon.h>
@@ -82,6 +83,7 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
         new_binding->input_type = B_KEYBOARD;
     }
     new_binding->command = sstrdup(command);
+    new_binding->command_program = command_program_new(command);
     new_binding->event_state_mask = event_state_from_str(modifiers);
     int group_bits_set = 0;
     if ((new_binding->event_state_mask >> 16) & I3_XKB_GROUP_MASK_1)
@@ -122,22 +124,34 @@ static bool binding_in_current_group(const Binding *bind) {
     }
 }
 
-static void grab_keycode_for_binding(xcb_connection_t *conn, Binding *bind, uint32_t keycode) {
-    /* Grab the key in all combinations */
-#define GRAB_KEY(modifier)                                                                       \
-    do {                                                                                         \
-        xcb_grab_key(conn, 0, root, modifier, keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC); \
-    } while (0)
-    const int mods = (bind->event_state_mask & 0xFFFF);
-    DLOG("Binding %p Grabbing keycode %d with event state mask 0x%x (mods 0x%x)\n",
-         bind, keycode, bind->event_state_mask, mods);
-    GRAB_KEY(mods);
-    /* Also bind the key with active NumLock */
-    GRAB_KEY(mods | xcb_numlock_mask);
-    /* Also bind the key with active CapsLock */
-    GRAB_KEY(mods | XCB_MOD_MASK_LOCK);
-    /* Also bind the key with active NumLock+CapsLock */
-    GRAB_KEY(mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
+/* The key grabs on the root window as (keycode << 16 | modifiers), sorted, so
+ * that grab_all_keys() only needs to change the grabs which differ. */
+static uint32_t *grabbed_keys = NULL;
+static int num_grabbed_keys = 0;
+
+/* Whether the keysyms need to be translated again, respectively the keys
+ * grabbed again, see bindings_schedule_key_update(). */
+static bool keysyms_outdated = false;
+static bool key_grabs_outdated = false;
+
+/* The buttons to grab on every window (see bindings_get_buttons_to_grab())
+ * and how often they changed. The grabs of a window are only updated once it
+ * is mapped, see bindings_update_button_grabs(). */
+static int *buttons_to_grab = NULL;
+static uint32_t button_grabs_generation = 1;
+
+static int key_grab_cmp(const void *a, const void *b) {
+    const uint32_t first = *((const uint32_t *)a);
+    const uint32_t second = *((const uint32_t *)b);
+    return (first < second ? -1 : (first > second ? 1 : 0));
+}
+
+static void add_key_grab(uint32_t **grabs, int *num, int *capacity, uint32_t keycode, uint32_t mods) {
+    if (*num == *capacity) {
+        *capacity = (*capacity == 0 ? 64 : *capacity * 2);
+        *grabs = srealloc(*grabs, *capacity * sizeof(uint32_t));
+    }
+    (*grabs)[(*num)++] = ((keycode & 0xFF) << 16) | (mods & 0xFFFF);
 }
 
 /*
@@ -145,6 +159,10 @@ static void grab_keycode_for_binding(xcb_connection_t *conn, Binding *bind, uint
  *
  */
 void grab_all_keys(xcb_connection_t *conn) {
+    uint32_t *grabs = NULL;
+    int num = 0;
+    int capacity = 0;
+
     Binding *bind;
     TAILQ_FOREACH(bind, bindings, bindings) {
         if (bind->input_type != B_KEYBOARD)
@@ -155,40 +173,287 @@ void grab_all_keys(xcb_connection_t *conn) {
 
         /* The easy case: the user specified a keycode directly. */
         if (bind->keycode > 0) {
-            grab_keycode_for_binding(conn, bind, bind->keycode);
+            /* Grab the key in all combinations */
+            const int mods = (bind->event_state_mask & 0xFFFF);
+            add_key_grab(&grabs, &num, &capacity, bind->keycode, mods);
+            /* Also bind the key with active NumLock */
+            add_key_grab(&grabs, &num, &capacity, bind->keycode, mods | xcb_numlock_mask);
+            /* Also bind the key with active CapsLock */
+            add_key_grab(&grabs, &num, &capacity, bind->keycode, mods | XCB_MOD_MASK_LOCK);
+            /* Also bind the key with active NumLock+CapsLock */
+            add_key_grab(&grabs, &num, &capacity, bind->keycode, mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
             continue;
         }
 
         struct Binding_Keycode *binding_keycode;
         TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
-            const int keycode = binding_keycode->keycode;
-            const int mods = (binding_keycode->modifiers & 0xFFFF);
-            DLOG("Binding %p Grabbing keycode %d with mods %d\n", bind, keycode, mods);
-            xcb_grab_key(conn, 0, root, mods, keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+            add_key_grab(&grabs, &num, &capacity, binding_keycode->keycode, binding_keycode->modifiers);
         }
     }
+
+    qsort(grabs, num, sizeof(uint32_t), key_grab_cmp);
+
+    /* Remove duplicates, then walk both sorted lists and only change the
+     * grabs which are in just one of them. */
+    int unique = 0;
+    for (int k = 0; k < num; k++) {
+        if (unique == 0 || grabs[unique - 1] != grabs[k])
+            grabs[unique++] = grabs[k];
+    }
+    num = unique;
+
+    /* The new grabs are checked, see below. grab_cookies[k] belongs to
+     * grabs[grab_index[k]]. */
+    xcb_void_cookie_t *grab_cookies = smalloc(max(num, 1) * sizeof(xcb_void_cookie_t));
+    int *grab_index = smalloc(max(num, 1) * sizeof(int));
+    int grabbed = 0, ungrabbed = 0;
+    int i = 0, j = 0;
+    while (i < num_grabbed_keys || j < num) {
+        if (j == num || (i < num_grabbed_keys && grabbed_keys[i] < grabs[j])) {
+            xcb_ungrab_key(conn, grabbed_keys[i] >> 16, root, grabbed_keys[i] & 0xFFFF);
+            ungrabbed++;
+            i++;
+        } else if (i == num_grabbed_keys || grabs[j] < grabbed_keys[i]) {
+            grab_cookies[grabbed] = xcb_grab_key_checked(conn, 0, root, grabs[j] & 0xFFFF, grabs[j] >> 16,
+                                                         XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+            grab_index[grabbed] = j;
+            grabbed++;
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+
+    /* A grab fails (BadAccess) if another client already grabbed the key.
+     * Those keys are not remembered as grabbed, so that the next update tries
+     * again. Keycodes are never 0, which marks the failed grabs. */
+    int failed = 0;
+    for (int k = 0; k < grabbed; k++) {
+        xcb_generic_error_t *error = xcb_request_check(conn, grab_cookies[k]);
+        if (error == NULL)
+            continue;
+
+        const uint32_t grab = grabs[grab_index[k]];
+        ELOG("Could not grab keycode %d with modifiers %d (error_code = %d), is another client grabbing it?\n",
+             grab >> 16, grab & 0xFFFF, error->error_code);
+        free(error);
+        grabs[grab_index[k]] = 0;
+        failed++;
+    }
+    free(grab_cookies);
+    free(grab_index);
+
+    if (failed > 0) {
+        int kept = 0;
+        for (int k = 0; k < num; k++) {
+            if (grabs[k] != 0)
+                grabs[kept++] = grabs[k];
+        }
+        num = kept;
+    }
+    DLOG("Grabbed %d (%d failed) and ungrabbed %d key combinations, %d are grabbed now\n",
+         grabbed, failed, ungrabbed, num);
+
+    free(grabbed_keys);
+    grabbed_keys = grabs;
+    num_grabbed_keys = num;
+    key_grabs_outdated = false;
+}
+
+/*
+ * Schedules grabbing the keys again, after translating the keysyms if
+ * translate is true (the keymap changed, not just the XKB group). Repeated
+ * changes are handled once by bindings_update_keys().
+ *
+ */
+void bindings_schedule_key_update(bool translate) {
+    key_grabs_outdated = true;
+    if (translate)
+        keysyms_outdated = true;
+}
+
+/*
+ * Translates the keysyms and grabs the keys, if scheduled by
+ * bindings_schedule_key_update(). Called before the event loop sleeps and
+ * before looking up a binding.
+ *
+ */
+void bindings_update_keys(void) {
+    if (keysyms_outdated)
+        translate_keysyms();
+    if (key_grabs_outdated)
+        grab_all_keys(conn);
 }
 
 /*
- * Release the button grabs on all managed windows and regrab them,
- * reevaluating which buttons need to be grabbed.
+ * Reevaluates which buttons need to be grabbed on the managed windows. The
+ * grabs are only changed when the windows are mapped, see
+ * bindings_update_button_grabs().
  *
  */
 void regrab_all_buttons(xcb_connection_t *conn) {
     int *buttons = bindings_get_buttons_to_grab();
-    xcb_grab_server(conn);
+    if (buttons_to_grab != NULL) {
+        int i = 0;
+        while (buttons[i] > 0 && buttons[i] == buttons_to_grab[i])
+            i++;
+        if (buttons[i] == buttons_to_grab[i]) {
+            DLOG("The buttons to grab did not change\n");
+            free(buttons);
+            return;
+        }
+    }
 
-    Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons) {
-        if (con->window == NULL)
-            continue;
+    free(buttons_to_grab);
+    buttons_to_grab = buttons;
+    button_grabs_generation++;
+
+    /* Update the visible windows before the event loop sleeps. */
+    tree_render_later();
+}
+
+/*
+ * Grabs the buttons on the given window, unless they are grabbed already.
+ * Releases the outdated grabs first, if the buttons to grab changed since.
+ *
+ */
+void bindings_update_button_grabs(i3Window *window) {
+    if (window->button_grabs_generation == button_grabs_generation)
+        return;
+
+    if (buttons_to_grab == NULL)
+        buttons_to_grab = bindings_get_buttons_to_grab();
+
+    if (window->button_grabs_generation != 0)
+        xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, window->id, XCB_BUTTON_MASK_ANY);
+    xcb_grab_buttons(conn, window->id, buttons_to_grab);
+    window->button_grabs_generation = button_grabs_generation;
+}
+
+/* The bindings of the current mode, indexed by the input which triggers them.
+ * There is one entry per translated keycode (see translate_keysyms()) and XKB
+ * group the binding applies to, sorted by key and then by the position of the
+ * binding in the mode, so that more specific bindings still take precedence
+ * (see reorder_bindings()). Rebuilt by translate_keysyms(). */
+struct binding_entry {
+    /* See binding_key(). */
+    uint64_t key;
+    int order;
+    Binding *bind;
+};
+
+static struct binding_entry *binding_table = NULL;
+static int binding_table_size = 0;
+
+/* Release bindings whose key or button was pressed, per input_type. They
+ * trigger on the release even if the modifiers do not match anymore, so that
+ * users can release the modifier keys before releasing the actual key. Reset
+ * on every press of the same input_type. */
+struct armed_binding {
+    Binding *bind;
+    int order;
+};
+
+static struct armed_binding *armed_bindings[2] = {NULL, NULL};
+static int num_armed_bindings[2] = {0, 0};
+
+/*
+ * Returns the key of the binding table for the given input, XKB group index
+ * (0 to 3) and modifiers.
+ *
+ */
+static uint64_t binding_key(input_type_t input_type, int group, uint32_t modifiers, uint16_t input_code) {
+    return ((uint64_t)input_type << 34) | ((uint64_t)group << 32) |
+           ((uint64_t)(modifiers & 0xFFFF) << 16) | input_code;
+}
+
+/*
+ * Returns whether a binding with the given group mask (the upper 16 bits of
+ * its event_state_mask) applies in the XKB group with the given index.
+ *
+ */
+static bool group_mask_matches(uint32_t group_mask, int group) {
+    return (((1 << group) & group_mask) == group_mask);
+}
+
+static int binding_entry_cmp(const void *a, const void *b) {
+    const struct binding_entry *first = a;
+    const struct binding_entry *second = b;
+    if (first->key != second->key)
+        return (first->key < second->key ? -1 : 1);
+    return first->order - second->order;
+}
 
-        xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, con->window->id, XCB_BUTTON_MASK_ANY);
-        xcb_grab_buttons(conn, con->window->id, buttons);
+/*
+ * Rebuilds the binding table from the keycodes of the bindings of the current
+ * mode and forgets the armed release bindings.
+ *
+ */
+static void build_binding_table(void) {
+    int capacity = 0;
+    binding_table_size = 0;
+    num_armed_bindings[B_KEYBOARD] = 0;
+    num_armed_bindings[B_MOUSE] = 0;
+
+    int order = 0;
+    Binding *bind;
+    TAILQ_FOREACH(bind, bindings, bindings) {
+        const uint32_t group_mask = (bind->event_state_mask >> 16);
+        struct Binding_Keycode *binding_keycode;
+        TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
+            for (int group = 0; group < 4; group++) {
+                if (!group_mask_matches(group_mask, group))
+                    continue;
+
+                if (binding_table_size == capacity) {
+                    capacity = (capacity == 0 ? 64 : capacity * 2);
+                    binding_table = srealloc(binding_table, capacity * sizeof(struct binding_entry));
+                }
+                binding_table[binding_table_size++] = (struct binding_entry){
+                    .key = binding_key(bind->input_type, group, binding_keycode->modifiers, binding_keycode->keycode),
+                    .order = order,
+                    .bind = bind,
+                };
+            }
+        }
+        order++;
     }
 
-    FREE(buttons);
-    xcb_ungrab_server(conn);
+    qsort(binding_table, binding_table_size, sizeof(struct binding_entry), binding_entry_cmp);
+    DLOG("Indexed %d bindings with %d binding table entries\n", order, binding_table_size);
+}
+
+/*
+ * Returns the index of the first entry of the binding table with the given
+ * key, or binding_table_size if there is none.
+ *
+ */
+static int binding_table_find(uint64_t key) {
+    int low = 0;
+    int high = binding_table_size;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (binding_table[middle].key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/*
+ * Returns whether the given binding was translated to the given keycode (or
+ * button), with any modifiers.
+ *
+ */
+static bool binding_has_keycode(Binding *bind, uint16_t input_code) {
+    struct Binding_Keycode *binding_keycode;
+    TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
+        if (binding_keycode->keycode == input_code)
+            return true;
+    }
+    return false;
 }
 
 /*
@@ -197,98 +462,67 @@ void regrab_all_buttons(xcb_connection_t *conn) {
  *
  */
 static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_release, uint16_t input_code, input_type_t input_type) {
-    Binding *bind;
-    Binding *result = NULL;
+    /* get_binding_from_xcb_event() sets exactly one group bit. */
+    const int group = __builtin_ctz((state_filtered >> 16) | (1 << 3));
+    const uint64_t key = binding_key(input_type, group, state_filtered, input_code);
+    const int first = binding_table_find(key);
 
     if (!is_release) {
-        /* On a press event, we first reset all B_UPON_KEYRELEASE_IGNORE_MODS
-         * bindings back to B_UPON_KEYRELEASE */
-        TAILQ_FOREACH(bind, bindings, bindings) {
-            if (bind->input_type != input_type)
+        /* A press resets the release bindings armed by the previous one. */
+        num_armed_bindings[input_type] = 0;
+
+        Binding *result = NULL;
+        for (int i = first; i < binding_table_size && binding_table[i].key == key; i++) {
+            const struct binding_entry *entry = &(binding_table[i]);
+            /* The same binding can be translated to the same keycode twice. */
+            if (i > first && binding_table[i - 1].bind == entry->bind)
                 continue;
-            if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
-                bind->release = B_UPON_KEYRELEASE;
-        }
-    }
 
-    const uint32_t xkb_group_state = (state_filtered & 0xFFFF0000);
-    const uint32_t modifiers_state = (state_filtered & 0x0000FFFF);
-    TAILQ_FOREACH(bind, bindings, bindings) {
-        if (bind->input_type != input_type) {
-            continue;
-        }
-
-        const uint32_t xkb_group_mask = (bind->event_state_mask & 0xFFFF0000);
-        const bool groups_match = ((xkb_group_state & xkb_group_mask) == xkb_group_mask);
-        if (!groups_match) {
-            DLOG("skipping binding %p because XKB groups do not match\n", bind);
-            continue;
-        }
-
-        /* For keyboard bindings where a symbol was specified by the user, we
-         * need to look in the array of translated keycodes for the event’s
-         * keycode */
-        bool found_keycode = false;
-        if (input_type == B_KEYBOARD && bind->symbol != NULL) {
-            xcb_keycode_t input_keycode = (xcb_keycode_t)input_code;
-            struct Binding_Keycode *binding_keycode;
-            TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
-                const uint32_t modifiers_mask = (binding_keycode->modifiers & 0x0000FFFF);
-                const bool mods_match = (modifiers_mask == modifiers_state);
-                DLOG("binding_keycode->modifiers = %d, modifiers_mask = %d, modifiers_state = %d, mods_match = %s\n",
-                     binding_keycode->modifiers, modifiers_mask, modifiers_state, (mods_match ? "yes" : "no"));
-                if (binding_keycode->keycode == input_keycode &&
-                    (mods_match || (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS && is_release))) {
-                    found_keycode = true;
+            if (entry->bind->release == B_UPON_KEYRELEASE) {
+                /* This release binding matches the key which the user
+                 * pressed, so it will be matched on the release even if the
+                 * modifiers were released first. */
+                armed_bindings[input_type] = srealloc(armed_bindings[input_type],
+                                                      (num_armed_bindings[input_type] + 1) * sizeof(struct armed_binding));
+                armed_bindings[input_type][num_armed_bindings[input_type]++] = (struct armed_binding){
+                    .bind = entry->bind,
+                    .order = entry->order,
+                };
+                DLOG("armed release binding %p\n", entry->bind);
+                if (result)
                     break;
-                }
-            }
-        } else {
-            /* This case is easier: The user specified a keycode */
-            if (bind->keycode != input_code) {
                 continue;
             }
 
-            struct Binding_Keycode *binding_keycode;
-            TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
-                const uint32_t modifiers_mask = (binding_keycode->modifiers & 0x0000FFFF);
-                const bool mods_match = (modifiers_mask == modifiers_state);
-                DLOG("binding_keycode->modifiers = %d, modifiers_mask = %d, modifiers_state = %d, mods_match = %s\n",
-                     binding_keycode->modifiers, modifiers_mask, modifiers_state, (mods_match ? "yes" : "no"));
-                if (mods_match || (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS && is_release)) {
-                    found_keycode = true;
-                    break;
-                }
-            }
-        }
-        if (!found_keycode) {
-            continue;
+            /* Keep looking to arm the release bindings. */
+            if (!result)
+                result = entry->bind;
         }
+        return result;
+    }
 
-        /* If this binding is a release binding, it matches the key which the
-         * user pressed. We therefore mark it as B_UPON_KEYRELEASE_IGNORE_MODS
-         * for later, so that the user can release the modifiers before the
-         * actual key or button and the release event will still be matched. */
-        if (bind->release == B_UPON_KEYRELEASE && !is_release) {
-            bind->release = B_UPON_KEYRELEASE_IGNORE_MODS;
-            DLOG("marked bind %p as B_UPON_KEYRELEASE_IGNORE_MODS\n", bind);
-            if (result) {
-                break;
-            }
-            continue;
+    /* On a release, the first release binding matching either the modifiers
+     * or the pressed key wins. */
+    Binding *result = NULL;
+    int result_order = INT_MAX;
+    for (int i = first; i < binding_table_size && binding_table[i].key == key; i++) {
+        if (binding_table[i].bind->release == B_UPON_KEYRELEASE) {
+            result = binding_table[i].bind;
+            result_order = binding_table[i].order;
+            break;
         }
+    }
 
-        /* Check if the binding is for a press or a release event */
-        if ((bind->release == B_UPON_KEYPRESS && is_release)) {
+    for (int i = 0; i < num_armed_bindings[input_type]; i++) {
+        const struct armed_binding *armed = &(armed_bindings[input_type][i]);
+        if (armed->order >= result_order)
             continue;
-        }
-
-        if (is_release) {
-            return bind;
-        } else if (!result) {
-            /* Continue looping to mark needed B_UPON_KEYRELEASE_IGNORE_MODS. */
-            result = bind;
-        }
+        if (!group_mask_matches(armed->bind->event_state_mask >> 16, group))
+            continue;
+        if (!binding_has_keycode(armed->bind, input_code))
+            continue;
+        result = armed->bind;
+        result_order = armed->order;
     }
 
     return result;
@@ -300,6 +534,9 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
  *
  */
 Binding *get_binding_from_xcb_event(xcb_generic_event_t *event) {
+    /* The keymap might have changed earlier in this event loop iteration. */
+    bindings_update_keys();
+
     const bool is_release = (event->response_type == XCB_KEY_RELEASE ||
                              event->response_type == XCB_BUTTON_RELEASE);
 
@@ -599,6 +836,9 @@ void translate_keysyms(void) {
     }
 
 out:
+    build_binding_table();
+    keysyms_outdated = false;
+
     xkb_state_unref(dummy_state);
     xkb_state_unref(dummy_state_no_shift);
     xkb_state_unref(dummy_state_numlock);
@@ -624,25 +864,22 @@ void switch_mode(const char *new_mode) {
         if (strcmp(mode->name, new_mode) != 0)
             continue;
 
-        ungrab_all_keys(conn);
+        /* translate_keysyms() also rebuilds the binding table, which resets
+         * the armed release bindings to avoid possibly activating one of
+         * them. grab_all_keys() only changes the grabs which differ between
+         * the modes. */
         bindings = mode->bindings;
         translate_keysyms();
         grab_all_keys(conn);
 
-        /* Reset all B_UPON_KEYRELEASE_IGNORE_MODS bindings to avoid possibly
-         * activating one of them. */
-        Binding *bind;
-        TAILQ_FOREACH(bind, bindings, bindings) {
-            if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
-                bind->release = B_UPON_KEYRELEASE;
-        }
+        if (ipc_has_event_listeners(I3_IPC_EVENT_MODE)) {
+            char *event_msg;
+            sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
+                      mode->name, (mode->pango_markup ? "true" : "false"));
 
-        char *event_msg;
-        sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
-                  mode->name, (mode->pango_markup ? "true" : "false"));
-
-        ipc_send_event("mode", I3_IPC_EVENT_MODE, event_msg);
-        FREE(event_msg);
+            ipc_send_event(I3_IPC_EVENT_MODE, event_msg);
+            FREE(event_msg);
+        }
 
         return;
     }
@@ -775,6 +1012,8 @@ static Binding *binding_copy(Binding *bind) {
         ret->symbol = sstrdup(bind->symbol);
     if (bind->command != NULL)
         ret->command = sstrdup(bind->command);
+    /* The copy only describes the binding, it is never run. */
+    ret->command_program = NULL;
     TAILQ_INIT(&(ret->keycodes_head));
     struct Binding_Keycode *binding_keycode;
     TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
@@ -802,6 +1041,7 @@ void binding_free(Binding *bind) {
 
     FREE(bind->symbol);
     FREE(bind->command);
+    command_program_free(bind->command_program);
     FREE(bind);
 }
 
@@ -813,19 +1053,18 @@ void binding_free(Binding *bind) {
  *
  */
 CommandResult *run_binding(Binding *bind, Con *con) {
-    char *command;
-
-    /* We need to copy the binding and command since “reload” may be part of
-     * the command, and then the memory that bind points to may not contain the
-     * same data anymore. */
-    if (con == NULL)
-        command = sstrdup(bind->command);
-    else
-        sasprintf(&command, "[con_id=\"%p\"] %s", con, bind->command);
-
+    /* We need to copy the binding since “reload” may be part of the command,
+     * and then the memory that bind points to may not contain the same data
+     * anymore. The command program stays valid until it finished running. */
     Binding *bind_cp = binding_copy(bind);
-    CommandResult *result = parse_command(command, NULL);
-    free(command);
+    CommandResult *result;
+    if (con == NULL) {
+        result = command_program_run(bind->command_program, NULL, NULL, NULL);
+    } else {
+        char con_id[32];
+        snprintf(con_id, sizeof(con_id), "%p", con);
+        result = command_program_run(bind->command_program, "con_id", con_id, NULL);
+    }
 
     if (result->needs_tree_render)
         tree_render();
@@ -1897,7 +1897,7 @@ void cmd_title_format(I3_CMD, const char *format) {
             current->con->window->name_x_changed = true;
         } else {
             /* For windowless containers we also need to force the redrawing. */
-            FREE(current->con->deco_render_params);
+            x_invalidate_decoration(current->con);
         }
     }
 
@@ -2172,6 +2172,93 @@ void cmd_debuglog(I3_CMD, const char *argument) {
     ysuccess(true);
 }
 
+/*
+ * Implementation of 'debuglog modules <module>[,<module>...]'
+ *
+ */
+void cmd_debuglog_modules(I3_CMD, const char *modules) {
+    if (!set_debug_log_modules(modules)) {
+        yerror("Unknown log module in \"%s\"", modules);
+        return;
+    }
+    LOG("Debug logging enabled for modules \"%s\"\n", modules);
+
+    y(map_open);
+    ystr("success");
+    y(bool, true);
+
+    ystr("modules");
+    y(array_open);
+    for (int module = 0; module < NUM_LOG_MODULES; module++) {
+        if (DLOG_ENABLED(module))
+            ystr(log_module_name(module));
+    }
+    y(array_close);
+
+    y(map_close);
+}
+
+/*
+ * Implementation of 'debug render-stats'
+ *
+ */
+void cmd_debug_render_stats(I3_CMD) {
+    stats_enable_x_request_counting();
+
+    y(map_open);
+    ystr("success");
+    y(bool, true);
+
+    ystr("renders");
+    y(integer, render_stats.renders);
+
+    ystr("last_render");
+    y(map_open);
+    ystr("nodes_rendered");
+    y(integer, render_stats.last_nodes_rendered);
+    ystr("nodes_pushed");
+    y(integer, render_stats.last_nodes_pushed);
+    ystr("workspaces_skipped");
+    y(integer, render_stats.last_workspaces_skipped);
+    ystr("x_requests");
+    y(integer, render_stats.last_x_requests);
+    ystr("restacks");
+    y(integer, render_stats.last_restacks);
+    y(map_close);
+
+    ystr("total");
+    y(map_open);
+    ystr("nodes_rendered");
+    y(integer, render_stats.total_nodes_rendered);
+    ystr("nodes_pushed");
+    y(integer, render_stats.total_nodes_pushed);
+    ystr("workspaces_skipped");
+    y(integer, render_stats.total_workspaces_skipped);
+    ystr("x_requests");
+    y(integer, render_stats.total_x_requests);
+    ystr("restacks");
+    y(integer, render_stats.total_restacks);
+    y(map_close);
+
+    y(map_close);
+}
+
+/*
+ * Implementation of 'debug ipc-stats'
+ *
+ */
+void cmd_debug_ipc_stats(I3_CMD) {
+    y(map_open);
+    ystr("success");
+    y(bool, true);
+
+    ystr("clients");
+    if (cmd_output->json_gen != NULL)
+        ipc_dump_client_stats(cmd_output->json_gen);
+
+    y(map_close);
+}
+
 /**
  * Implementation of 'gaps inner|outer|top|right|bottom|left|horizontal|vertical current|all set|plus|minus|toggle <px>'
  *
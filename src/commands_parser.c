@@ -178,17 +178,95 @@ static struct CommandResultIR command_output;
 
 #include "GENERATED_command_call.h"
 
+#ifndef TEST_PARSER
+/*******************************************************************************
+ * Command programs. Commands which are run over and over again (bindings and
+ * for_window assignments) are parsed once. The calls the parser made are
+ * recorded together with the contents of the stack and replayed on every
+ * following run. This works because the parser transitions only depend on the
+ * input, never on the result of a call.
+ ******************************************************************************/
+
+struct command_step {
+    /* CALL_CRITERIA_INIT for re-initializing the criteria after a command. */
+    int call_identifier;
+    cmdp_state state;
+    struct stack_entry stack[10];
+};
+
+#define CALL_CRITERIA_INIT -1
+
+struct CommandProgram {
+    char *command;
+
+    /* Whether the steps were recorded. Until then, and for commands which
+     * cannot be parsed (so that errors are reported like before), the
+     * command is run through the parser. */
+    bool recorded;
+    bool parse_error;
+
+    struct command_step *steps;
+    int num_steps;
+
+    /* A command can free the program which runs it (e.g. reload), so every
+     * run holds a reference. */
+    int references;
+};
+
+/* The program whose steps are currently being recorded, if any. */
+static struct CommandProgram *recording = NULL;
+
+/*
+ * Appends a step to the program which is being recorded.
+ *
+ */
+static void record_step(int call_identifier) {
+    recording->steps = srealloc(recording->steps, (recording->num_steps + 1) * sizeof(struct command_step));
+    struct command_step *step = &(recording->steps[recording->num_steps++]);
+    step->call_identifier = call_identifier;
+    step->state = state;
+    for (int c = 0; c < 10; c++) {
+        step->stack[c] = stack[c];
+        if (stack[c].identifier == NULL) {
+            step->stack[c].type = STACK_STR;
+            step->stack[c].val.str = NULL;
+        } else if (stack[c].type == STACK_STR) {
+            step->stack[c].val.str = sstrdup(stack[c].val.str);
+        }
+    }
+}
+#endif
+
+/*
+ * Runs the call with the given identifier using the arguments on the stack
+ * and transitions to the state it returns.
+ *
+ */
+static void run_call(int call_identifier) {
+    subcommand_output.json_gen = command_output.json_gen;
+    subcommand_output.needs_tree_render = false;
+    GENERATED_call(call_identifier, &subcommand_output);
+#ifndef TEST_PARSER
+    /* Every call returning to INITIAL completes a command, except for
+     * the closing bracket of the criteria. */
+    if (state != CRITERIA && subcommand_output.next_state == INITIAL)
+        loop_stats.commands++;
+#endif
+    state = subcommand_output.next_state;
+    /* If any subcommand requires a tree_render(), we need to make the
+     * whole parser result request a tree_render(). */
+    if (subcommand_output.needs_tree_render)
+        command_output.needs_tree_render = true;
+    clear_stack();
+}
+
 static void next_state(const cmdp_token *token) {
     if (token->next_state == __CALL) {
-        subcommand_output.json_gen = command_output.json_gen;
-        subcommand_output.needs_tree_render = false;
-        GENERATED_call(token->extra.call_identifier, &subcommand_output);
-        state = subcommand_output.next_state;
-        /* If any subcommand requires a tree_render(), we need to make the
-         * whole parser result request a tree_render(). */
-        if (subcommand_output.needs_tree_render)
-            command_output.needs_tree_render = true;
-        clear_stack();
+#ifndef TEST_PARSER
+        if (recording != NULL)
+            record_step(token->extra.call_identifier);
+#endif
+        run_call(token->extra.call_identifier);
         return;
     }
 
@@ -254,14 +332,28 @@ char *parse_string(const char **walk, bool as_word) {
     return str;
 }
 
+#ifndef TEST_PARSER
 /*
- * Parses and executes the given command. If a caller-allocated yajl_gen is
- * passed, a json reply will be generated in the format specified by the ipc
- * protocol. Pass NULL if no json reply is required.
+ * Adds the criterion ctype=cvalue to the freshly initialized criteria, like a
+ * leading [ctype="cvalue"] would.
  *
- * Free the returned CommandResult with command_result_free().
  */
-CommandResult *parse_command(const char *input, yajl_gen gen) {
+static void inject_criterion(const char *ctype, const char *cvalue) {
+    subcommand_output.json_gen = command_output.json_gen;
+    cmd_criteria_add(&current_match, &subcommand_output, ctype, cvalue);
+    cmd_criteria_match_windows(&current_match, &subcommand_output);
+}
+#endif
+
+/*
+ * Parses and executes the given command, see parse_command(). If ctype is not
+ * NULL, the first command is run on the windows matching ctype=cvalue.
+ *
+ */
+static CommandResult *parse_and_run(const char *input, yajl_gen gen, const char *ctype, const char *cvalue) {
+#ifndef TEST_PARSER
+    const uint64_t start = stats_now();
+#endif
     DLOG("COMMAND: *%s*\n", input);
     state = INITIAL;
     CommandResult *result = scalloc(1, sizeof(CommandResult));
@@ -281,6 +373,10 @@ CommandResult *parse_command(const char *input, yajl_gen gen) {
 // TODO: make this testable
 #ifndef TEST_PARSER
     cmd_criteria_init(&current_match, &subcommand_output);
+    if (ctype != NULL) {
+        DLOG("on the windows matching %s=%s\n", ctype, cvalue);
+        inject_criterion(ctype, cvalue);
+    }
 #endif
 
     /* The "<=" operator is intentional: We also handle the terminating 0-byte
@@ -359,8 +455,11 @@ CommandResult *parse_command(const char *input, yajl_gen gen) {
                      * every command. */
 // TODO: make this testable
 #ifndef TEST_PARSER
-                    if (*walk == '\0' || *walk == ';')
+                    if (*walk == '\0' || *walk == ';') {
+                        if (recording != NULL)
+                            record_step(CALL_CRITERIA_INIT);
                         cmd_criteria_init(&current_match, &subcommand_output);
+                    }
 #endif
                     walk++;
                     break;
@@ -448,9 +547,142 @@ CommandResult *parse_command(const char *input, yajl_gen gen) {
     y(array_close);
 
     result->needs_tree_render = command_output.needs_tree_render;
+#ifndef TEST_PARSER
+    stats_record(STATS_PHASE_COMMAND, start);
+#endif
+    return result;
+}
+
+/*
+ * Parses and executes the given command. If a caller-allocated yajl_gen is
+ * passed, a json reply will be generated in the format specified by the ipc
+ * protocol. Pass NULL if no json reply is required.
+ *
+ * Free the returned CommandResult with command_result_free().
+ */
+CommandResult *parse_command(const char *input, yajl_gen gen) {
+    return parse_and_run(input, gen, NULL, NULL);
+}
+
+#ifndef TEST_PARSER
+/*
+ * Creates a command program for the given command. It is parsed when it runs
+ * for the first time.
+ *
+ */
+CommandProgram *command_program_new(const char *command) {
+    CommandProgram *program = scalloc(1, sizeof(CommandProgram));
+    program->command = sstrdup(command);
+    program->references = 1;
+    return program;
+}
+
+/*
+ * Frees the recorded steps of the given program.
+ *
+ */
+static void free_steps(CommandProgram *program) {
+    for (int i = 0; i < program->num_steps; i++) {
+        for (int c = 0; c < 10; c++) {
+            if (program->steps[i].stack[c].type == STACK_STR)
+                free(program->steps[i].stack[c].val.str);
+        }
+    }
+    FREE(program->steps);
+    program->num_steps = 0;
+}
+
+/*
+ * Replays the recorded steps of the given program.
+ *
+ */
+static CommandResult *replay(CommandProgram *program, yajl_gen gen, const char *ctype, const char *cvalue) {
+    const uint64_t start = stats_now();
+    DLOG("COMMAND (parsed before): *%s*\n", program->command);
+    CommandResult *result = scalloc(1, sizeof(CommandResult));
+
+    command_output.json_gen = gen;
+
+    y(array_open);
+    command_output.needs_tree_render = false;
+
+    cmd_criteria_init(&current_match, &subcommand_output);
+    if (ctype != NULL) {
+        DLOG("on the windows matching %s=%s\n", ctype, cvalue);
+        inject_criterion(ctype, cvalue);
+    }
+
+    for (int i = 0; i < program->num_steps; i++) {
+        const struct command_step *step = &(program->steps[i]);
+        if (step->call_identifier == CALL_CRITERIA_INIT) {
+            cmd_criteria_init(&current_match, &subcommand_output);
+            continue;
+        }
+
+        for (int c = 0; c < 10; c++) {
+            stack[c] = step->stack[c];
+            if (stack[c].type == STACK_STR && stack[c].val.str != NULL)
+                stack[c].val.str = sstrdup(stack[c].val.str);
+        }
+        state = step->state;
+        run_call(step->call_identifier);
+    }
+
+    y(array_close);
+
+    result->needs_tree_render = command_output.needs_tree_render;
+    stats_record(STATS_PHASE_COMMAND, start);
     return result;
 }
 
+/*
+ * Executes the given command program, like parse_command() would execute its
+ * command. If ctype is not NULL, the first command is run on the windows
+ * matching ctype=cvalue (e.g. "id" and a window ID), as if the command
+ * started with [ctype="cvalue"].
+ *
+ * Free the returned CommandResult with command_result_free().
+ */
+CommandResult *command_program_run(CommandProgram *program, const char *ctype, const char *cvalue, yajl_gen gen) {
+    CommandResult *result;
+
+    program->references++;
+    if (program->recorded) {
+        result = replay(program, gen, ctype, cvalue);
+    } else if (program->parse_error) {
+        result = parse_and_run(program->command, gen, ctype, cvalue);
+    } else {
+        struct CommandProgram *previous = recording;
+        recording = program;
+        result = parse_and_run(program->command, gen, ctype, cvalue);
+        recording = previous;
+
+        if (result->parse_error) {
+            free_steps(program);
+            program->parse_error = true;
+        } else {
+            program->recorded = true;
+        }
+    }
+    command_program_free(program);
+
+    return result;
+}
+
+/*
+ * Frees the given command program (once it is no longer running).
+ *
+ */
+void command_program_free(CommandProgram *program) {
+    if (program == NULL || --(program->references) > 0)
+        return;
+
+    free_steps(program);
+    FREE(program->command);
+    FREE(program);
+}
+#endif
+
 /*
  * Frees a CommandResult
  */
@@ -469,6 +701,8 @@ void command_result_free(CommandResult *result) {
 
 #ifdef TEST_PARSER
 
+uint32_t debug_log_modules = UINT32_MAX;
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -9,12 +9,175 @@
  *        …).
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_CON
 #include "all.h"
 
 #include "yajl_utils.h"
 
 static void con_on_remove_child(Con *con);
 
+/*
+ * The container index allows looking up containers by their address, their
+ * client window ID and their frame ID without walking all_cons. It is a hash
+ * table with one set of chains per key, whose entries are embedded into the
+ * Con itself (see Con.index_by_*).
+ *
+ */
+LIST_HEAD(con_index_bucket, Con);
+
+static struct {
+    struct con_index_bucket *by_con;
+    struct con_index_bucket *by_window;
+    struct con_index_bucket *by_frame;
+    /* Number of buckets per key, always a power of two. */
+    size_t size;
+    /* Number of containers in the index. */
+    size_t count;
+} con_index;
+
+static size_t con_index_hash(uint64_t key) {
+    return hash_bucket(key, con_index.size);
+}
+
+static void con_index_link(Con *con) {
+    LIST_INSERT_HEAD(&(con_index.by_con[con_index_hash((uintptr_t)con)]), con, index_by_con);
+    if (con->indexed_window != XCB_NONE) {
+        LIST_INSERT_HEAD(&(con_index.by_window[con_index_hash(con->indexed_window)]), con, index_by_window);
+    }
+    if (con->indexed_frame != XCB_NONE) {
+        LIST_INSERT_HEAD(&(con_index.by_frame[con_index_hash(con->indexed_frame)]), con, index_by_frame);
+    }
+}
+
+/*
+ * Allocates buckets for the given number of containers and re-inserts all
+ * indexed containers. The chains are thrown away, all_cons contains every
+ * indexed container anyway.
+ *
+ */
+static void con_index_resize(size_t size) {
+    free(con_index.by_con);
+    free(con_index.by_window);
+    free(con_index.by_frame);
+
+    con_index.size = size;
+    con_index.by_con = scalloc(size, sizeof(struct con_index_bucket));
+    con_index.by_window = scalloc(size, sizeof(struct con_index_bucket));
+    con_index.by_frame = scalloc(size, sizeof(struct con_index_bucket));
+
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        con_index_link(con);
+    }
+}
+
+/*
+ * Adds a (new) container to the index. The container must already be part of
+ * all_cons.
+ *
+ */
+static void con_index_insert(Con *con) {
+    con->indexed_window = (con->window != NULL ? con->window->id : XCB_NONE);
+    con->indexed_frame = con->frame.id;
+    con_index.count++;
+
+    if (con_index.count > con_index.size) {
+        /* con_index_resize() links every con in all_cons, including the new
+         * one. */
+        con_index_resize(con_index.size == 0 ? 64 : con_index.size * 2);
+    } else {
+        con_index_link(con);
+    }
+}
+
+static void con_index_remove(Con *con) {
+    LIST_REMOVE(con, index_by_con);
+    if (con->indexed_window != XCB_NONE) {
+        LIST_REMOVE(con, index_by_window);
+    }
+    if (con->indexed_frame != XCB_NONE) {
+        LIST_REMOVE(con, index_by_frame);
+    }
+    con_index.count--;
+}
+
+/*
+ * Updates the container index so that the given container can be found by
+ * con_by_window_id() and con_by_frame_id() under its current client window and
+ * frame IDs. Needs to be called whenever con->window or con->frame changes.
+ *
+ */
+void con_index_update(Con *con) {
+    xcb_window_t window = (con->window != NULL ? con->window->id : XCB_NONE);
+    if (window != con->indexed_window) {
+        if (con->indexed_window != XCB_NONE) {
+            LIST_REMOVE(con, index_by_window);
+        }
+        con->indexed_window = window;
+        if (window != XCB_NONE) {
+            LIST_INSERT_HEAD(&(con_index.by_window[con_index_hash(window)]), con, index_by_window);
+        }
+    }
+
+    if (con->frame.id != con->indexed_frame) {
+        if (con->indexed_frame != XCB_NONE) {
+            LIST_REMOVE(con, index_by_frame);
+        }
+        con->indexed_frame = con->frame.id;
+        if (con->frame.id != XCB_NONE) {
+            LIST_INSERT_HEAD(&(con_index.by_frame[con_index_hash(con->frame.id)]), con, index_by_frame);
+        }
+    }
+}
+
+/*
+ * Verifies that the container index matches the all_cons list and aborts if
+ * it does not. This walks all containers, so it is only called in debug
+ * builds.
+ *
+ */
+void con_index_check(void) {
+    size_t count = 0;
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        count++;
+        xcb_window_t window = (con->window != NULL ? con->window->id : XCB_NONE);
+        if (con->indexed_window != window || con->indexed_frame != con->frame.id) {
+            ELOG("con %p is indexed with window 0x%08x / frame 0x%08x, but has window 0x%08x / frame 0x%08x\n",
+                 con, con->indexed_window, con->indexed_frame, window, con->frame.id);
+            assert(false);
+        }
+        assert(con_by_con_id((long)con) == con);
+        if (window != XCB_NONE) {
+            Con *found = con_by_window_id(window);
+            assert(found != NULL && found->window->id == window);
+        }
+        if (con->frame.id != XCB_NONE) {
+            Con *found = con_by_frame_id(con->frame.id);
+            assert(found != NULL && found->frame.id == con->frame.id);
+        }
+    }
+
+    if (count != con_index.count) {
+        ELOG("container index contains %zu containers, all_cons contains %zu\n",
+             con_index.count, count);
+        assert(false);
+    }
+
+    /* Every chained container must still be hashed into its current bucket. */
+    for (size_t i = 0; i < con_index.size; i++) {
+        LIST_FOREACH(con, &(con_index.by_con[i]), index_by_con) {
+            assert(con_index_hash((uintptr_t)con) == i);
+        }
+        LIST_FOREACH(con, &(con_index.by_window[i]), index_by_window) {
+            assert(con_index_hash(con->indexed_window) == i);
+        }
+        LIST_FOREACH(con, &(con_index.by_frame[i]), index_by_frame) {
+            assert(con_index_hash(con->indexed_frame) == i);
+        }
+    }
+}
+
 /*
  * force parent split containers to be redrawn
  *
@@ -24,13 +187,26 @@ void con_force_split_parents_redraw(Con *con) {
 
     while (parent != NULL && parent->type != CT_WORKSPACE && parent->type != CT_DOCKAREA) {
         if (!con_is_leaf(parent)) {
-            FREE(parent->deco_render_params);
+            x_invalidate_decoration(parent);
         }
 
         parent = parent->parent;
     }
 }
 
+/*
+ * Marks the given container and all of its parents as dirty, so that the next
+ * tree_render() will not skip the workspace containing it.
+ *
+ */
+void con_mark_dirty(Con *con) {
+    /* We cannot stop at the first container which is already dirty: a dirty
+     * container might have been detached and attached elsewhere, in which case
+     * its new parents are still clean. */
+    for (; con != NULL; con = con->parent)
+        con->dirty = true;
+}
+
 /*
  * Create a new container (and attach it to the given parent, if not NULL).
  * This function only initializes the data structures.
@@ -40,10 +216,12 @@ Con *con_new_skeleton(Con *parent, i3Window *window) {
     Con *new = scalloc(1, sizeof(Con));
     new->on_remove_child = con_on_remove_child;
     TAILQ_INSERT_TAIL(&all_cons, new, all_cons);
+    con_index_insert(new);
     new->type = CT_CON;
     new->window = window;
     new->border_style = config.default_border;
     new->current_border_width = -1;
+    new->dirty = true;
     if (window) {
         new->depth = window->depth;
     } else {
@@ -78,7 +256,7 @@ Con *con_new(Con *parent, i3Window *window) {
  */
 void con_free(Con *con) {
     free(con->name);
-    FREE(con->deco_render_params);
+    con_index_remove(con);
     TAILQ_REMOVE(&all_cons, con, all_cons);
     while (!TAILQ_EMPTY(&(con->swallow_head))) {
         Match *match = TAILQ_FIRST(&(con->swallow_head));
@@ -183,6 +361,7 @@ add_to_focus_head:
      * to focus them. */
     TAILQ_INSERT_TAIL(focus_head, con, focused);
     con_force_split_parents_redraw(con);
+    con_mark_dirty(con);
 }
 
 /*
@@ -205,6 +384,7 @@ void con_attach(Con *con, Con *parent, bool ignore_focus) {
  */
 void con_detach(Con *con) {
     con_force_split_parents_redraw(con);
+    con_mark_dirty(con);
     if (con->type == CT_FLOATING_CON) {
         TAILQ_REMOVE(&(con->parent->floating_head), con, floating_windows);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
@@ -231,6 +411,7 @@ void con_focus(Con *con) {
         con_focus(con->parent);
 
     focused = con;
+    con_mark_dirty(con);
     /* We can't blindly reset non-leaf containers since they might have
      * other urgent children. Therefore we only reset leafs and propagate
      * the changes upwards via con_update_parents_urgency() which does proper
@@ -610,10 +791,17 @@ bool con_has_parent(Con *con, Con *parent) {
  *
  */
 Con *con_by_window_id(xcb_window_t window) {
+    if (window == XCB_NONE || con_index.size == 0) {
+        return NULL;
+    }
+
     Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-    if (con->window != NULL && con->window->id == window)
-        return con;
+    LIST_FOREACH(con, &(con_index.by_window[con_index_hash(window)]), index_by_window) {
+        if (con->indexed_window == window) {
+            return con;
+        }
+    }
+
     return NULL;
 }
 
@@ -623,8 +811,12 @@ Con *con_by_window_id(xcb_window_t window) {
  *
  */
 Con *con_by_con_id(long target) {
+    if (con_index.size == 0) {
+        return NULL;
+    }
+
     Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons) {
+    LIST_FOREACH(con, &(con_index.by_con[con_index_hash((uintptr_t)target)]), index_by_con) {
         if (con == (Con *)target) {
             return con;
         }
@@ -648,10 +840,17 @@ bool con_exists(Con *con) {
  *
  */
 Con *con_by_frame_id(xcb_window_t frame) {
+    if (frame == XCB_NONE || con_index.size == 0) {
+        return NULL;
+    }
+
     Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-    if (con->frame.id == frame)
-        return con;
+    LIST_FOREACH(con, &(con_index.by_frame[con_index_hash(frame)]), index_by_frame) {
+        if (con->indexed_frame == frame) {
+            return con;
+        }
+    }
+
     return NULL;
 }
 
@@ -726,6 +925,7 @@ void con_mark(Con *con, const char *mark, mark_mode_t mode) {
     ipc_send_window_event("mark", con);
 
     con->mark_changed = true;
+    con_mark_dirty(con);
 }
 
 /*
@@ -757,6 +957,7 @@ void con_unmark(Con *con, const char *name) {
             }
 
             current->mark_changed = true;
+            con_mark_dirty(current);
         }
     } else {
         DLOG("Removing mark \"%s\".\n", name);
@@ -768,6 +969,7 @@ void con_unmark(Con *con, const char *name) {
 
         DLOG("Found mark on con = %p. Removing it now.\n", current);
         current->mark_changed = true;
+        con_mark_dirty(current);
 
         mark_t *mark;
         TAILQ_FOREACH(mark, &(current->marks_head), marks) {
@@ -1017,6 +1219,7 @@ void con_toggle_fullscreen(Con *con, int fullscreen_mode) {
  */
 static void con_set_fullscreen_mode(Con *con, fullscreen_mode_t fullscreen_mode) {
     con->fullscreen_mode = fullscreen_mode;
+    con_mark_dirty(con);
 
     DLOG("mode now: %d\n", con->fullscreen_mode);
 
@@ -1295,7 +1498,7 @@ static bool _con_move_to_con(Con *con, Con *target, bool behind_focused, bool fi
     }
 
     /* Ensure the container will be redrawn. */
-    FREE(con->deco_render_params);
+    x_invalidate_decoration(con);
 
     CALL(parent, on_remove_child);
 
@@ -1714,6 +1917,8 @@ int con_border_style(Con *con) {
  *
  */
 void con_set_border_style(Con *con, int border_style, int border_width) {
+    con_mark_dirty(con);
+
     /* Handle the simple case: non-floating containerns */
     if (!con_is_floating(con)) {
         con->border_style = border_style;
@@ -1765,6 +1970,8 @@ void con_set_layout(Con *con, layout_t layout) {
     if (con->type != CT_WORKSPACE)
         con = con->parent;
 
+    con_mark_dirty(con);
+
     /* We fill in last_split_layout when switching to a different layout
      * since there are many places in the code that don’t use
      * con_set_layout(). */
@@ -1950,15 +2157,19 @@ static void con_on_remove_child(Con *con) {
     if (con->type == CT_WORKSPACE) {
         if (TAILQ_EMPTY(&(con->focus_head)) && !workspace_is_visible(con)) {
             LOG("Closing old workspace (%p / %s), it is empty\n", con, con->name);
-            yajl_gen gen = ipc_marshal_workspace_event("empty", con, NULL);
+            /* The event has to be serialized before the workspace is freed. */
+            const bool send_event = ipc_has_event_listeners(I3_IPC_EVENT_WORKSPACE);
+            yajl_gen gen = (send_event ? ipc_marshal_workspace_event("empty", con, NULL) : NULL);
             tree_close_internal(con, DONT_KILL_WINDOW, false);
 
-            const unsigned char *payload;
-            ylength length;
-            y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+            if (send_event) {
+                const unsigned char *payload;
+                ylength length;
+                y(get_buf, &payload, &length);
+                ipc_send_event(I3_IPC_EVENT_WORKSPACE, (const char *)payload);
 
-            y(free);
+                y(free);
+            }
         }
         return;
     }
@@ -2152,6 +2363,7 @@ void con_set_urgency(Con *con, bool urgent) {
     }
 
     const bool old_urgent = con->urgent;
+    con_mark_dirty(con);
 
     if (con->urgency_timer == NULL) {
         con->urgent = urgent;
@@ -2411,6 +2623,9 @@ bool con_swap(Con *first, Con *second) {
      * doesn't change during the swap. */
     SWAP(first->percent, second->percent, double);
 
+    con_mark_dirty(first);
+    con_mark_dirty(second);
+
     if (restore_focus) {
         con_focus(restore_focus);
     }
@@ -8,6 +8,7 @@
  *           the correct path, switching key bindings mode).
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_CONFIG
 #include "all.h"
 
 #include <xkbcommon/xkbcommon.h>
@@ -18,16 +19,6 @@ Config config;
 struct modes_head modes;
 struct barconfig_head barconfigs = TAILQ_HEAD_INITIALIZER(barconfigs);
 
-/*
- * Ungrabs all keys, to be called before re-grabbing the keys because of a
- * mapping_notify event or a configuration file reload
- *
- */
-void ungrab_all_keys(xcb_connection_t *conn) {
-    DLOG("Ungrabbing all keys\n");
-    xcb_ungrab_key(conn, XCB_GRAB_ANY, root, XCB_BUTTON_MASK_ANY);
-}
-
 /*
  * Sends the current bar configuration as an event to all barconfig_update listeners.
  *
@@ -47,8 +38,8 @@ static void free_configuration(void) {
      * after parsing the config again. See #2228. */
     switch_mode("default");
 
-    /* First ungrab the keys */
-    ungrab_all_keys(conn);
+    /* The keys stay grabbed, grab_all_keys() only changes the grabs which
+     * differ after the reload. */
 
     struct Mode *mode;
     while (!SLIST_EMPTY(&modes)) {
@@ -69,12 +60,14 @@ static void free_configuration(void) {
 
     while (!TAILQ_EMPTY(&assignments)) {
         struct Assignment *assign = TAILQ_FIRST(&assignments);
-        if (assign->type == A_TO_WORKSPACE || assign->type == A_TO_WORKSPACE_NUMBER)
+        if (assign->type == A_TO_WORKSPACE || assign->type == A_TO_WORKSPACE_NUMBER) {
             FREE(assign->dest.workspace);
-        else if (assign->type == A_COMMAND)
+        } else if (assign->type == A_COMMAND) {
             FREE(assign->dest.command);
-        else if (assign->type == A_TO_OUTPUT)
+            command_program_free(assign->command_program);
+        } else if (assign->type == A_TO_OUTPUT) {
             FREE(assign->dest.output);
+        }
         match_free(&(assign->match));
         TAILQ_REMOVE(&assignments, assign, assignments);
         FREE(assign);
@@ -148,7 +141,7 @@ static void free_configuration(void) {
             FREE(con->window->ran_assignments);
         }
         /* Invalidate pixmap caches in case font or colors changed. */
-        FREE(con->deco_render_params);
+        x_invalidate_decoration(con);
     }
 
     /* Get rid of the current font */
@@ -243,6 +236,7 @@ bool load_configuration(const char *override_configpath, config_load_t load_type
     }
     LOG("Parsing configfile %s\n", current_configpath);
     const bool result = parse_file(current_configpath, load_type != C_VALIDATE);
+    assignments_reindex();
 
     if (config.font.type == FONT_TYPE_NONE && load_type != C_VALIDATE) {
         ELOG("You did not specify required configuration option \"font\"\n");
@@ -7,6 +7,7 @@
  * config_directives.c: all config storing functions (see config_parser.c)
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_CONFIG
 #include "all.h"
 
 #include <float.h>
@@ -161,6 +162,7 @@ CFGFUN(for_window, const char *command) {
     assignment->type = A_COMMAND;
     match_copy(&(assignment->match), current_match);
     assignment->dest.command = sstrdup(command);
+    assignment->command_program = command_program_new(command);
     TAILQ_INSERT_TAIL(&assignments, assignment, assignments);
 }
 
@@ -641,6 +643,14 @@ CFGFUN(ipc_kill_timeout, const long timeout_ms) {
     ipc_set_kill_timeout(timeout_ms / 1000.0);
 }
 
+CFGFUN(ipc_client_queue_limit, const long limit) {
+    if (limit < 0) {
+        ELOG("ipc_client_queue_limit must not be negative, ignoring %ld\n", limit);
+        return;
+    }
+    ipc_set_client_queue_limit(limit);
+}
+
 /*******************************************************************************
  * Bar configuration (i3bar)
  ******************************************************************************/
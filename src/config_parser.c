@@ -23,6 +23,7 @@
  *    nearest <error> token.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_CONFIG
 #include "all.h"
 
 #include <stdio.h>
@@ -570,6 +571,8 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
 
 #ifdef TEST_PARSER
 
+uint32_t debug_log_modules = UINT32_MAX;
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -7,6 +7,7 @@
  * floating.c: Floating windows.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_FLOATING
 #include "all.h"
 
 #ifndef MAX
@@ -522,6 +523,7 @@ bool floating_maybe_reassign_ws(Con *con) {
 void floating_center(Con *con, Rect rect) {
     con->rect.x = rect.x + (rect.width / 2) - (con->rect.width / 2);
     con->rect.y = rect.y + (rect.height / 2) - (con->rect.height / 2);
+    con_mark_dirty(con);
 }
 
 /*
@@ -845,6 +847,9 @@ static void xcb_drag_prepare_cb(EV_P_ ev_prepare *w, int revents) {
     while (!drain_drag_events(EV_A, dragloop)) {
         /* repeatedly drain events: draining might produce additional ones */
     }
+
+    /* IPC commands are still handled while dragging. */
+    tree_render_if_needed();
 }
 
 /*
@@ -903,6 +908,9 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_
 
     free(keyb_reply);
 
+    /* The drag callbacks work on the rendered rects. */
+    tree_render_if_needed();
+
     /* Go into our own event loop */
     struct drag_x11_cb loop = {
         .result = DRAGGING,
@@ -946,6 +954,7 @@ bool floating_reposition(Con *con, Rect newrect) {
     }
 
     con->rect = newrect;
+    con_mark_dirty(con);
 
     bool reassigned = floating_maybe_reassign_ws(con);
 
@@ -986,6 +995,7 @@ void floating_resize(Con *floating_con, uint32_t x, uint32_t y) {
         rect->height += (hi - 1 - rect->height) % hi;
 
     floating_check_size(floating_con, prefer_height);
+    con_mark_dirty(floating_con);
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (floating_con->scratchpad_state == SCRATCHPAD_FRESH)
@@ -1017,4 +1027,5 @@ void floating_fix_coordinates(Con *con, Rect *old_rect, Rect *new_rect) {
     con->rect.x = (int32_t)new_rect->x + (double)(rel_x * (int32_t)new_rect->width) / (int32_t)old_rect->width - (int32_t)(con->rect.width / 2);
     con->rect.y = (int32_t)new_rect->y + (double)(rel_y * (int32_t)new_rect->height) / (int32_t)old_rect->height - (int32_t)(con->rect.height / 2);
     DLOG("Resulting coordinates: x = %d, y = %d\n", con->rect.x, con->rect.y);
+    con_mark_dirty(con);
 }
@@ -8,6 +8,7 @@
  *             …).
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_HANDLERS
 #include "all.h"
 
 #include <time.h>
@@ -36,9 +37,19 @@ static SLIST_HEAD(ignore_head, Ignore_Event) ignore_events;
  *
  */
 void add_ignore_event(const int sequence, const int response_type) {
+    add_ignore_event_range(sequence, sequence, response_type);
+}
+
+/*
+ * Like add_ignore_event(), but ignores all sequence numbers from
+ * first_sequence up to and including last_sequence.
+ *
+ */
+void add_ignore_event_range(const int first_sequence, const int last_sequence, const int response_type) {
     struct Ignore_Event *event = smalloc(sizeof(struct Ignore_Event));
 
-    event->sequence = sequence;
+    event->sequence = first_sequence;
+    event->last_sequence = last_sequence;
     event->response_type = response_type;
     event->added = time(NULL);
 
@@ -63,7 +74,10 @@ bool event_is_ignored(const int sequence, const int response_type) {
     }
 
     SLIST_FOREACH(event, &ignore_events, ignore_events) {
-        if (event->sequence != sequence)
+        /* X11 events only carry the lower 16 bits of the sequence number,
+         * so compare modulo 2^16. */
+        if ((uint16_t)(sequence - event->sequence) >
+            (uint16_t)(event->last_sequence - event->sequence))
             continue;
 
         if (event->response_type != -1 &&
@@ -114,7 +128,7 @@ static void check_crossing_screen_boundary(uint32_t x, uint32_t y) {
 
     /* If the focus changed, we re-render to get updated decorations */
     if (old_focused != focused)
-        tree_render();
+        tree_render_later();
 }
 
 /*
@@ -184,7 +198,7 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
 
     focused_id = XCB_NONE;
     con_focus(con_descend_focused(con));
-    tree_render();
+    tree_render_later();
 }
 
 /*
@@ -245,9 +259,7 @@ static void handle_mapping_notify(xcb_mapping_notify_event_t *event) {
 
     xcb_numlock_mask = aio_get_mod_mask_for(XCB_NUM_LOCK, keysyms);
 
-    ungrab_all_keys(conn);
-    translate_keysyms();
-    grab_all_keys(conn);
+    bindings_schedule_key_update(true);
 }
 
 /*
@@ -364,7 +376,7 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
             DLOG("Dock client wants to change height to %d, we can do that.\n", event->height);
 
             con->geometry.height = event->height;
-            tree_render();
+            tree_render_later();
         }
 
         if (event->value_mask & XCB_CONFIG_WINDOW_X || event->value_mask & XCB_CONFIG_WINDOW_Y) {
@@ -381,7 +393,7 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
                 con_detach(con);
                 con_attach(con, nc, false);
 
-                tree_render();
+                tree_render_later();
             } else {
                 DLOG("Dock client will not be moved, we only support moving it to another output.\n");
             }
@@ -413,11 +425,11 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
             DLOG("Focusing con = %p\n", con);
             workspace_show(workspace);
             con_activate(con);
-            tree_render();
+            tree_render_later();
         } else if (config.focus_on_window_activation == FOWA_URGENT || (config.focus_on_window_activation == FOWA_SMART && !workspace_is_visible(workspace))) {
             DLOG("Marking con = %p urgent\n", con);
             con_set_urgency(con, true);
-            tree_render();
+            tree_render_later();
         } else {
             DLOG("Ignoring request for con = %p.\n", con);
         }
@@ -452,7 +464,7 @@ static void handle_screen_change(xcb_generic_event_t *e) {
 
     scratchpad_fix_resolution();
 
-    ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+    ipc_send_event(I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
 }
 
 /*
@@ -496,7 +508,7 @@ static void handle_unmap_notify_event(xcb_unmap_notify_event_t *event) {
     xcb_delete_property(conn, event->window, A__NET_WM_STATE);
 
     tree_close_internal(con, DONT_KILL_WINDOW, false);
-    tree_render();
+    tree_render_later();
 
 ignore_end:
     /* If the client (as opposed to i3) destroyed or unmapped a window, an
@@ -716,7 +728,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             ewmh_update_wm_desktop();
         }
 
-        tree_render();
+        tree_render_later();
     } else if (event->type == A__NET_ACTIVE_WINDOW) {
         if (event->format != 32)
             return;
@@ -772,7 +784,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 DLOG("Ignoring request for con = %p.\n", con);
         }
 
-        tree_render();
+        tree_render_later();
     } else if (event->type == A_I3_SYNC) {
         xcb_window_t window = event->data.data32[0];
         uint32_t rnd = event->data.data32[1];
@@ -834,7 +846,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
 
         DLOG("Handling request to focus workspace %s\n", ws->name);
         workspace_show(ws);
-        tree_render();
+        tree_render_later();
     } else if (event->type == A__NET_WM_DESKTOP) {
         uint32_t index = event->data.data32[0];
         DLOG("Request to move window %d to EWMH desktop index %d\n", event->window, index);
@@ -865,7 +877,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             con_move_to_workspace(con, ws, true, false, false);
         }
 
-        tree_render();
+        tree_render_later();
         ewmh_update_wm_desktop();
     } else if (event->type == A__NET_CLOSE_WINDOW) {
         /*
@@ -881,7 +893,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 last_timestamp = event->data.data32[0];
 
             tree_close_internal(con, KILL_WINDOW, false);
-            tree_render();
+            tree_render_later();
         } else {
             DLOG("Couldn't find con for _NET_CLOSE_WINDOW request. (window = %d)\n", event->window);
         }
@@ -981,7 +993,7 @@ static bool handle_normal_hints(void *data, xcb_connection_t *conn, uint8_t stat
         Con *floating = con_inside_floating(con);
         if (floating) {
             floating_check_size(con, false);
-            tree_render();
+            tree_render_later();
         }
     }
 
@@ -1006,7 +1018,7 @@ static bool handle_hints(void *data, xcb_connection_t *conn, uint8_t state, xcb_
         reply = xcb_get_property_reply(conn, xcb_icccm_get_wm_hints(conn, window), NULL);
     window_update_hints(con->window, reply, &urgency_hint);
     con_set_urgency(con, urgency_hint);
-    tree_render();
+    tree_render_later();
 
     return true;
 }
@@ -1119,7 +1131,7 @@ static void handle_focus_in(xcb_focus_in_event_t *event) {
     con_activate(con);
     /* We update focused_id because we don’t need to set focus again */
     focused_id = event->event;
-    tree_render();
+    tree_render_later();
 }
 
 /*
@@ -1270,7 +1282,7 @@ static bool handle_strut_partial_change(void *data, xcb_connection_t *conn, uint
     TAILQ_INSERT_HEAD(&(dockarea->focus_head), con, focused);
     TAILQ_INSERT_HEAD(&(dockarea->nodes_head), con, nodes);
 
-    tree_render();
+    tree_render_later();
 
     return true;
 }
@@ -1372,9 +1384,7 @@ void handle_event(int type, xcb_generic_event_t *event) {
             keysyms = xcb_key_symbols_alloc(conn);
             if (((xcb_xkb_new_keyboard_notify_event_t *)event)->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
                 (void)load_keymap();
-            ungrab_all_keys(conn);
-            translate_keysyms();
-            grab_all_keys(conn);
+            bindings_schedule_key_update(true);
         } else if (state->xkbType == XCB_XKB_MAP_NOTIFY) {
             if (event_is_ignored(event->sequence, type)) {
                 DLOG("Ignoring map notify event for sequence %d.\n", state->sequence);
@@ -1383,18 +1393,15 @@ void handle_event(int type, xcb_generic_event_t *event) {
                 add_ignore_event(event->sequence, type);
                 xcb_key_symbols_free(keysyms);
                 keysyms = xcb_key_symbols_alloc(conn);
-                ungrab_all_keys(conn);
-                translate_keysyms();
-                grab_all_keys(conn);
                 (void)load_keymap();
+                bindings_schedule_key_update(true);
             }
         } else if (state->xkbType == XCB_XKB_STATE_NOTIFY) {
             DLOG("xkb state group = %d\n", state->group);
             if (xkb_current_group == state->group)
                 return;
             xkb_current_group = state->group;
-            ungrab_all_keys(conn);
-            grab_all_keys(conn);
+            bindings_schedule_key_update(false);
         }
 
         return;
@@ -1421,6 +1428,13 @@ void handle_event(int type, xcb_generic_event_t *event) {
         return;
     }
 
+    /* Pointer events are interpreted relative to the rendered layout (e.g. to
+     * find out which tab was clicked), so a deferred render has to happen
+     * before handling them. */
+    if (type == XCB_BUTTON_PRESS || type == XCB_BUTTON_RELEASE ||
+        type == XCB_MOTION_NOTIFY || type == XCB_ENTER_NOTIFY)
+        tree_render_if_needed();
+
     switch (type) {
         case XCB_KEY_PRESS:
         case XCB_KEY_RELEASE:
@@ -7,12 +7,15 @@
  * ipc.c: UNIX domain socket IPC (initialization, client handling, protocol).
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_IPC
 #include "all.h"
 
 #include "yajl_utils.h"
 
+#include <inttypes.h>
 #include <stdint.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <fcntl.h>
 #include <libgen.h>
@@ -25,6 +28,23 @@ char *current_socketpath = NULL;
 TAILQ_HEAD(ipc_client_head, ipc_client)
 all_clients = TAILQ_HEAD_INITIALIZER(all_clients);
 
+/* The names of the event types clients can subscribe to, indexed by their
+ * number (the message type without I3_IPC_EVENT_MASK). */
+static const char *event_names[] = {
+    "workspace",
+    "output",
+    "mode",
+    "window",
+    "barconfig_update",
+    "binding",
+    "shutdown",
+    "tick",
+};
+#define NUM_EVENT_TYPES (sizeof(event_names) / sizeof(event_names[0]))
+
+/* The number of clients subscribed to each event type. */
+static int num_listeners[NUM_EVENT_TYPES];
+
 /*
  * Puts the given socket file descriptor into non-blocking mode or dies if
  * setting O_NONBLOCK failed. Non-blocking sockets are a good idea for our
@@ -43,27 +63,118 @@ static void ipc_socket_writeable_cb(EV_P_ struct ev_io *w, int revents);
 
 static ev_tstamp kill_timeout = 10.0;
 
+/* Maximum number of bytes waiting in the output queue of a client before
+ * further events for it are dropped (0 means no limit). */
+static size_t queue_limit = 0;
+
+/* Messages from clients with a larger payload are considered a protocol
+ * violation and lead to the client being disconnected. */
+#define IPC_MAX_MESSAGE_SIZE (32 * 1024 * 1024)
+
+/* The client whose message is being handled right now, reset to NULL when a
+ * handler (e.g. a failed restart) frees the client. */
+static ipc_client *dispatching_client = NULL;
+
 void ipc_set_kill_timeout(ev_tstamp new) {
     kill_timeout = new;
 }
 
+void ipc_set_client_queue_limit(size_t limit) {
+    queue_limit = limit;
+}
+
 /*
- * Try to write the contents of the pending buffer to the client's subscription
- * socket. Will set, reset or clear the timeout and io write callbacks depending
- * on the result of the write operation.
+ * A message (header and payload) in the output queue of one or more clients.
+ * Events are serialized only once and shared between all subscribed clients.
+ *
+ */
+struct ipc_chunk {
+    int refcount;
+    size_t size;
+    uint8_t data[];
+};
+
+static struct ipc_chunk *ipc_chunk_new(const uint32_t message_type, size_t size, const uint8_t *payload) {
+    const i3_ipc_header_t header = {
+        .magic = {'i', '3', '-', 'i', 'p', 'c'},
+        .size = size,
+        .type = message_type};
+    const size_t header_size = sizeof(i3_ipc_header_t);
+
+    struct ipc_chunk *chunk = smalloc(sizeof(struct ipc_chunk) + header_size + size);
+    chunk->refcount = 1;
+    chunk->size = header_size + size;
+    memcpy(chunk->data, ((void *)&header), header_size);
+    memcpy(chunk->data + header_size, payload, size);
+    return chunk;
+}
+
+static void ipc_chunk_unref(struct ipc_chunk *chunk) {
+    if (--(chunk->refcount) == 0)
+        free(chunk);
+}
+
+/* Returns the n-th oldest chunk in the output queue of the given client. */
+#define QUEUE_AT(client, n) ((client)->queue[((client)->queue_start + (n)) % (client)->queue_capacity])
+
+/*
+ * Removes the first written bytes from the output queue of the client,
+ * releasing all chunks which were written completely.
+ *
+ */
+static void ipc_queue_consume(ipc_client *client, size_t written) {
+    client->queued_bytes -= written;
+    while (written > 0) {
+        struct ipc_chunk *chunk = QUEUE_AT(client, 0);
+        const size_t remaining = chunk->size - client->queue_offset;
+        if (written < remaining) {
+            client->queue_offset += written;
+            return;
+        }
+
+        written -= remaining;
+        client->queue_offset = 0;
+        client->queue_start = (client->queue_start + 1) % client->queue_capacity;
+        client->queue_length--;
+        ipc_chunk_unref(chunk);
+    }
+}
+
+/*
+ * Try to write the contents of the output queue to the client's socket using
+ * writev(). Will set, reset or clear the timeout and io write callbacks
+ * depending on the result of the write operation.
  *
  */
 static void ipc_push_pending(ipc_client *client) {
-    const ssize_t result = writeall_nonblock(client->fd, client->buffer, client->buffer_size);
-    if (result < 0) {
-        return;
+    size_t written = 0;
+    while (client->queue_length > 0) {
+        struct iovec iov[64];
+        int cnt = 0;
+        for (size_t n = 0; n < client->queue_length && cnt < 64; n++) {
+            struct ipc_chunk *chunk = QUEUE_AT(client, n);
+            const size_t skip = (n == 0 ? client->queue_offset : 0);
+            iov[cnt].iov_base = chunk->data + skip;
+            iov[cnt].iov_len = chunk->size - skip;
+            cnt++;
+        }
+
+        const ssize_t result = writev(client->fd, iov, cnt);
+        if (result == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return;
+        }
+        written += (size_t)result;
+        loop_stats.ipc_bytes_out += (size_t)result;
+        ipc_queue_consume(client, (size_t)result);
     }
 
-    if ((size_t)result == client->buffer_size) {
+    if (client->queue_length == 0) {
         /* Everything was written successfully: clear the timer and stop the io
          * callback. */
-        FREE(client->buffer);
-        client->buffer_size = 0;
         if (client->timeout) {
             ev_timer_stop(main_loop, client->timeout);
             FREE(client->timeout);
@@ -83,46 +194,72 @@ static void ipc_push_pending(ipc_client *client) {
         client->timeout = timeout;
         ev_set_priority(timeout, EV_MINPRI);
         ev_timer_start(main_loop, client->timeout);
-    } else if (result > 0) {
+    } else if (written > 0) {
         /* Keep the old timeout when nothing is written. Otherwise, we would
          * keep a dead connection by continuously renewing its timeouts. */
         ev_timer_stop(main_loop, client->timeout);
         ev_timer_set(client->timeout, kill_timeout, 0.0);
         ev_timer_start(main_loop, client->timeout);
     }
-    if (result == 0) {
+}
+
+/*
+ * Appends the given chunk to the output queue of the client without trying to
+ * send it.
+ *
+ */
+static void ipc_queue_append(ipc_client *client, struct ipc_chunk *chunk) {
+    if (client->queue_length == client->queue_capacity) {
+        /* Grow the ring and move its contents to the beginning. */
+        const size_t capacity = (client->queue_capacity == 0 ? 16 : client->queue_capacity * 2);
+        struct ipc_chunk **queue = smalloc(capacity * sizeof(struct ipc_chunk *));
+        for (size_t n = 0; n < client->queue_length; n++)
+            queue[n] = QUEUE_AT(client, n);
+        free(client->queue);
+        client->queue = queue;
+        client->queue_capacity = capacity;
+        client->queue_start = 0;
+    }
+
+    chunk->refcount++;
+    QUEUE_AT(client, client->queue_length) = chunk;
+    client->queue_length++;
+    client->queued_bytes += chunk->size;
+    client->bytes_queued += chunk->size;
+}
+
+/*
+ * Appends the given chunk to the output queue of the client and sends it if
+ * the queue was empty. Events are dropped instead if the client already has
+ * more than queue_limit bytes waiting, replies are always queued.
+ *
+ */
+static void ipc_queue_chunk(ipc_client *client, struct ipc_chunk *chunk, const uint32_t message_type) {
+    if (queue_limit > 0 &&
+        (message_type & I3_IPC_EVENT_MASK) &&
+        client->queued_bytes + chunk->size > queue_limit) {
+        DLOG("Output queue of client on fd %d is full (%zu bytes), dropping event\n",
+             client->fd, client->queued_bytes);
+        client->bytes_dropped += chunk->size;
         return;
     }
 
-    /* Shift the buffer to the left and reduce the allocated space. */
-    client->buffer_size -= (size_t)result;
-    memmove(client->buffer, client->buffer + result, client->buffer_size);
-    client->buffer = srealloc(client->buffer, client->buffer_size);
+    ipc_queue_append(client, chunk);
+    if (client->queue_length == 1) {
+        ipc_push_pending(client);
+    }
 }
 
 /*
  * Given a message and a message type, create the corresponding header, merge it
- * with the message and append it to the given client's output buffer. Also,
- * send the message if the client's buffer was empty.
+ * with the message and append it to the given client's output queue. Also,
+ * send the message if the client's queue was empty.
  *
  */
 static void ipc_send_client_message(ipc_client *client, size_t size, const uint32_t message_type, const uint8_t *payload) {
-    const i3_ipc_header_t header = {
-        .magic = {'i', '3', '-', 'i', 'p', 'c'},
-        .size = size,
-        .type = message_type};
-    const size_t header_size = sizeof(i3_ipc_header_t);
-    const size_t message_size = header_size + size;
-
-    const bool push_now = (client->buffer_size == 0);
-    client->buffer = srealloc(client->buffer, client->buffer_size + message_size);
-    memcpy(client->buffer + client->buffer_size, ((void *)&header), header_size);
-    memcpy(client->buffer + client->buffer_size + header_size, payload, size);
-    client->buffer_size += message_size;
-
-    if (push_now) {
-        ipc_push_pending(client);
-    }
+    struct ipc_chunk *chunk = ipc_chunk_new(message_type, size, payload);
+    ipc_queue_chunk(client, chunk, message_type);
+    ipc_chunk_unref(chunk);
 }
 
 static void free_ipc_client(ipc_client *client) {
@@ -138,30 +275,92 @@ static void free_ipc_client(ipc_client *client) {
         FREE(client->timeout);
     }
 
-    free(client->buffer);
+    DLOG("Client on fd %d: %" PRIu64 " bytes queued, %" PRIu64 " bytes dropped\n",
+         client->fd, client->bytes_queued, client->bytes_dropped);
+    for (size_t n = 0; n < client->queue_length; n++)
+        ipc_chunk_unref(QUEUE_AT(client, n));
+    free(client->queue);
+    free(client->deferred_reply);
+    free(client->read_payload);
+
+    if (client == dispatching_client)
+        dispatching_client = NULL;
 
-    for (int i = 0; i < client->num_events; i++) {
-        free(client->events[i]);
+    for (size_t i = 0; i < NUM_EVENT_TYPES; i++) {
+        if (client->events & IPC_EVENT_BIT(i))
+            num_listeners[i]--;
     }
-    free(client->events);
     TAILQ_REMOVE(&all_clients, client, clients);
     free(client);
 }
 
+/*
+ * Returns true if any IPC client is subscribed to the given event type (like
+ * I3_IPC_EVENT_WINDOW). Used to avoid serializing events nobody listens to.
+ *
+ */
+bool ipc_has_event_listeners(uint32_t message_type) {
+    const uint32_t type = (message_type & ~I3_IPC_EVENT_MASK);
+    assert(type < NUM_EVENT_TYPES);
+    return (num_listeners[type] > 0);
+}
+
 /*
  * Sends the specified event to all IPC clients which are currently connected
  * and subscribed to this kind of event.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload) {
+void ipc_send_event(uint32_t message_type, const char *payload) {
+    if (!ipc_has_event_listeners(message_type))
+        return;
+
+    struct ipc_chunk *chunk = ipc_chunk_new(message_type, strlen(payload), (const uint8_t *)payload);
     ipc_client *current;
     TAILQ_FOREACH(current, &all_clients, clients) {
-        for (int i = 0; i < current->num_events; i++) {
-            if (strcasecmp(current->events[i], event) == 0) {
-                ipc_send_client_message(current, strlen(payload), message_type, (uint8_t *)payload);
-                break;
-            }
-        }
+        if (current->events & IPC_EVENT_BIT(message_type))
+            ipc_queue_chunk(current, chunk, message_type);
+    }
+    ipc_chunk_unref(chunk);
+}
+
+/*
+ * Generates a JSON array with the output queue counters of all connected
+ * clients (used by the debug ipc-stats command).
+ *
+ */
+void ipc_dump_client_stats(yajl_gen gen) {
+    y(array_open);
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        y(map_open);
+        ystr("fd");
+        y(integer, current->fd);
+        ystr("bytes_queued");
+        y(integer, current->bytes_queued);
+        ystr("bytes_dropped");
+        y(integer, current->bytes_dropped);
+        ystr("pending_bytes");
+        y(integer, current->queued_bytes);
+        y(map_close);
+    }
+    y(array_close);
+}
+
+/*
+ * Sends the replies to RUN_COMMAND messages which were waiting for the tree to
+ * be rendered. Called by tree_render().
+ *
+ */
+void ipc_send_deferred_replies(void) {
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        if (current->deferred_reply == NULL)
+            continue;
+
+        ipc_send_client_message(current, current->deferred_reply_size,
+                                I3_IPC_REPLY_TYPE_COMMAND, current->deferred_reply);
+        FREE(current->deferred_reply);
+        current->deferred_reply_size = 0;
     }
 }
 
@@ -169,6 +368,9 @@ void ipc_send_event(const char *event, uint32_t message_type, const char *payloa
  * For shutdown events, we send the reason for the shutdown.
  */
 static void ipc_send_shutdown_event(shutdown_reason_t reason) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_SHUTDOWN))
+        return;
+
     yajl_gen gen = ygenalloc();
     y(map_open);
 
@@ -186,7 +388,7 @@ static void ipc_send_shutdown_event(shutdown_reason_t reason) {
     ylength length;
 
     y(get_buf, &payload, &length);
-    ipc_send_event("shutdown", I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
 
     y(free);
 }
@@ -222,17 +424,27 @@ IPC_HANDLER(run_command) {
     CommandResult *result = parse_command(command, gen);
     free(command);
 
-    if (result->needs_tree_render)
-        tree_render();
-
+    const bool needs_tree_render = result->needs_tree_render;
     command_result_free(result);
 
     const unsigned char *reply;
     ylength length;
     yajl_gen_get_buf(gen, &reply, &length);
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_COMMAND,
-                            (const uint8_t *)reply);
+    if (needs_tree_render) {
+        /* Rendering is deferred so that a batch of commands results in a
+         * single render. The reply is only sent afterwards, clients expect
+         * the effects of their command (e.g. input focus) to be visible in
+         * X11 once they get the reply. */
+        assert(client->deferred_reply == NULL);
+        client->deferred_reply = smalloc(length);
+        memcpy(client->deferred_reply, reply, length);
+        client->deferred_reply_size = length;
+        tree_render_later();
+    } else {
+        ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_COMMAND,
+                                (const uint8_t *)reply);
+    }
 
     yajl_gen_free(gen);
 }
@@ -363,67 +575,100 @@ static void dump_binding(yajl_gen gen, Binding *bind) {
     y(map_close);
 }
 
+/* Restrictions of the GET_TREE reply, see handle_tree(). Unless a client asks
+ * for them, dump_node() emits all keys of the complete subtree. */
+static char **dump_fields = NULL;
+static int dump_num_fields = 0;
+static int dump_max_depth = -1;
+static int dump_depth = 0;
+
+/*
+ * Returns whether the given key should be part of the serialized nodes.
+ *
+ */
+static bool dump_key(const char *key) {
+    if (dump_fields == NULL)
+        return true;
+    for (int i = 0; i < dump_num_fields; i++) {
+        if (strcmp(dump_fields[i], key) == 0)
+            return true;
+    }
+    return false;
+}
+
 void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     y(map_open);
-    ystr("id");
-    y(integer, (uintptr_t)con);
+    if (dump_key("id")) {
+        ystr("id");
+        y(integer, (uintptr_t)con);
+    }
 
-    ystr("type");
-    switch (con->type) {
-        case CT_ROOT:
-            ystr("root");
-            break;
-        case CT_OUTPUT:
-            ystr("output");
-            break;
-        case CT_CON:
-            ystr("con");
-            break;
-        case CT_FLOATING_CON:
-            ystr("floating_con");
-            break;
-        case CT_WORKSPACE:
-            ystr("workspace");
-            break;
-        case CT_DOCKAREA:
-            ystr("dockarea");
-            break;
+    if (dump_key("type")) {
+        ystr("type");
+        switch (con->type) {
+            case CT_ROOT:
+                ystr("root");
+                break;
+            case CT_OUTPUT:
+                ystr("output");
+                break;
+            case CT_CON:
+                ystr("con");
+                break;
+            case CT_FLOATING_CON:
+                ystr("floating_con");
+                break;
+            case CT_WORKSPACE:
+                ystr("workspace");
+                break;
+            case CT_DOCKAREA:
+                ystr("dockarea");
+                break;
+        }
     }
 
     /* provided for backwards compatibility only. */
-    ystr("orientation");
-    if (!con_is_split(con))
-        ystr("none");
-    else {
-        if (con_orientation(con) == HORIZ)
-            ystr("horizontal");
-        else
-            ystr("vertical");
+    if (dump_key("orientation")) {
+        ystr("orientation");
+        if (!con_is_split(con))
+            ystr("none");
+        else {
+            if (con_orientation(con) == HORIZ)
+                ystr("horizontal");
+            else
+                ystr("vertical");
+        }
     }
 
-    ystr("scratchpad_state");
-    switch (con->scratchpad_state) {
-        case SCRATCHPAD_NONE:
-            ystr("none");
-            break;
-        case SCRATCHPAD_FRESH:
-            ystr("fresh");
-            break;
-        case SCRATCHPAD_CHANGED:
-            ystr("changed");
-            break;
+    if (dump_key("scratchpad_state")) {
+        ystr("scratchpad_state");
+        switch (con->scratchpad_state) {
+            case SCRATCHPAD_NONE:
+                ystr("none");
+                break;
+            case SCRATCHPAD_FRESH:
+                ystr("fresh");
+                break;
+            case SCRATCHPAD_CHANGED:
+                ystr("changed");
+                break;
+        }
     }
 
-    ystr("percent");
-    if (con->percent == 0.0)
-        y(null);
-    else
-        y(double, con->percent);
+    if (dump_key("percent")) {
+        ystr("percent");
+        if (con->percent == 0.0)
+            y(null);
+        else
+            y(double, con->percent);
+    }
 
-    ystr("urgent");
-    y(bool, con->urgent);
+    if (dump_key("urgent")) {
+        ystr("urgent");
+        y(bool, con->urgent);
+    }
 
-    if (!TAILQ_EMPTY(&(con->marks_head))) {
+    if (!TAILQ_EMPTY(&(con->marks_head)) && dump_key("marks")) {
         ystr("marks");
         y(array_open);
 
@@ -435,115 +680,138 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
         y(array_close);
     }
 
-    ystr("focused");
-    y(bool, (con == focused));
+    if (dump_key("focused")) {
+        ystr("focused");
+        y(bool, (con == focused));
+    }
 
-    if (con->type != CT_ROOT && con->type != CT_OUTPUT) {
+    if (con->type != CT_ROOT && con->type != CT_OUTPUT && dump_key("output")) {
         ystr("output");
         ystr(con_get_output(con)->name);
     }
 
-    ystr("layout");
-    switch (con->layout) {
-        case L_DEFAULT:
-            DLOG("About to dump layout=default, this is a bug in the code.\n");
-            assert(false);
-            break;
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        case L_SPLITH:
-            ystr("splith");
-            break;
-        case L_STACKED:
-            ystr("stacked");
-            break;
-        case L_TABBED:
-            ystr("tabbed");
-            break;
-        case L_DOCKAREA:
-            ystr("dockarea");
-            break;
-        case L_OUTPUT:
-            ystr("output");
-            break;
+    if (dump_key("layout")) {
+        ystr("layout");
+        switch (con->layout) {
+            case L_DEFAULT:
+                DLOG("About to dump layout=default, this is a bug in the code.\n");
+                assert(false);
+                break;
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            case L_SPLITH:
+                ystr("splith");
+                break;
+            case L_STACKED:
+                ystr("stacked");
+                break;
+            case L_TABBED:
+                ystr("tabbed");
+                break;
+            case L_DOCKAREA:
+                ystr("dockarea");
+                break;
+            case L_OUTPUT:
+                ystr("output");
+                break;
+        }
     }
 
-    ystr("workspace_layout");
-    switch (con->workspace_layout) {
-        case L_DEFAULT:
-            ystr("default");
-            break;
-        case L_STACKED:
-            ystr("stacked");
-            break;
-        case L_TABBED:
-            ystr("tabbed");
-            break;
-        default:
-            DLOG("About to dump workspace_layout=%d (none of default/stacked/tabbed), this is a bug.\n", con->workspace_layout);
-            assert(false);
-            break;
+    if (dump_key("workspace_layout")) {
+        ystr("workspace_layout");
+        switch (con->workspace_layout) {
+            case L_DEFAULT:
+                ystr("default");
+                break;
+            case L_STACKED:
+                ystr("stacked");
+                break;
+            case L_TABBED:
+                ystr("tabbed");
+                break;
+            default:
+                DLOG("About to dump workspace_layout=%d (none of default/stacked/tabbed), this is a bug.\n", con->workspace_layout);
+                assert(false);
+                break;
+        }
     }
 
-    ystr("last_split_layout");
-    switch (con->layout) {
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        default:
-            ystr("splith");
-            break;
+    if (dump_key("last_split_layout")) {
+        ystr("last_split_layout");
+        switch (con->layout) {
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            default:
+                ystr("splith");
+                break;
+        }
     }
 
-    ystr("border");
-    switch (con->border_style) {
-        case BS_NORMAL:
-            ystr("normal");
-            break;
-        case BS_NONE:
-            ystr("none");
-            break;
-        case BS_PIXEL:
-            ystr("pixel");
-            break;
+    if (dump_key("border")) {
+        ystr("border");
+        switch (con->border_style) {
+            case BS_NORMAL:
+                ystr("normal");
+                break;
+            case BS_NONE:
+                ystr("none");
+                break;
+            case BS_PIXEL:
+                ystr("pixel");
+                break;
+        }
     }
 
-    ystr("current_border_width");
-    y(integer, con->current_border_width);
+    if (dump_key("current_border_width")) {
+        ystr("current_border_width");
+        y(integer, con->current_border_width);
+    }
 
-    dump_rect(gen, "rect", con->rect);
-    dump_rect(gen, "deco_rect", con->deco_rect);
-    dump_rect(gen, "window_rect", con->window_rect);
-    dump_rect(gen, "geometry", con->geometry);
+    if (dump_key("rect"))
+        dump_rect(gen, "rect", con->rect);
+    if (dump_key("deco_rect"))
+        dump_rect(gen, "deco_rect", con->deco_rect);
+    if (dump_key("window_rect"))
+        dump_rect(gen, "window_rect", con->window_rect);
+    if (dump_key("geometry"))
+        dump_rect(gen, "geometry", con->geometry);
 
-    ystr("name");
-    if (con->window && con->window->name)
-        ystr(i3string_as_utf8(con->window->name));
-    else if (con->name != NULL)
-        ystr(con->name);
-    else
-        y(null);
+    if (dump_key("name")) {
+        ystr("name");
+        if (con->window && con->window->name)
+            ystr(i3string_as_utf8(con->window->name));
+        else if (con->name != NULL)
+            ystr(con->name);
+        else
+            y(null);
+    }
 
-    if (con->title_format != NULL) {
+    if (con->title_format != NULL && dump_key("title_format")) {
         ystr("title_format");
         ystr(con->title_format);
     }
 
     if (con->type == CT_WORKSPACE) {
-        ystr("num");
-        y(integer, con->num);
+        if (dump_key("num")) {
+            ystr("num");
+            y(integer, con->num);
+        }
 
-        dump_gaps(gen, "gaps", con->gaps);
+        if (dump_key("gaps"))
+            dump_gaps(gen, "gaps", con->gaps);
     }
 
-    ystr("window");
-    if (con->window)
-        y(integer, con->window->id);
-    else
-        y(null);
+    if (dump_key("window")) {
+        ystr("window");
+        if (con->window)
+            y(integer, con->window->id);
+        else
+            y(null);
+    }
 
-    if (con->window && !inplace_restart) {
+    if (con->window && !inplace_restart && dump_key("window_properties")) {
         /* Window properties are useless to preserve when restarting because
          * they will be queried again anyway. However, for i3-save-tree(1),
          * they are very useful and save i3-save-tree dealing with X11. */
@@ -576,67 +844,89 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
         y(map_close);
     }
 
-    ystr("nodes");
-    y(array_open);
+    /* Children below the maximum depth are left out, their IDs are still
+     * part of the focus array. */
+    const bool dump_children = (dump_max_depth < 0 || dump_depth < dump_max_depth);
+    dump_depth++;
+
     Con *node;
-    if (con->type != CT_DOCKAREA || !inplace_restart) {
-        TAILQ_FOREACH(node, &(con->nodes_head), nodes) {
-            dump_node(gen, node, inplace_restart);
+    if (dump_key("nodes")) {
+        ystr("nodes");
+        y(array_open);
+        if (dump_children && (con->type != CT_DOCKAREA || !inplace_restart)) {
+            TAILQ_FOREACH(node, &(con->nodes_head), nodes) {
+                dump_node(gen, node, inplace_restart);
+            }
         }
+        y(array_close);
     }
-    y(array_close);
 
-    ystr("floating_nodes");
-    y(array_open);
-    TAILQ_FOREACH(node, &(con->floating_head), floating_windows) {
-        dump_node(gen, node, inplace_restart);
+    if (dump_key("floating_nodes")) {
+        ystr("floating_nodes");
+        y(array_open);
+        if (dump_children) {
+            TAILQ_FOREACH(node, &(con->floating_head), floating_windows) {
+                dump_node(gen, node, inplace_restart);
+            }
+        }
+        y(array_close);
     }
-    y(array_close);
 
-    ystr("focus");
-    y(array_open);
-    TAILQ_FOREACH(node, &(con->focus_head), focused) {
-        y(integer, (uintptr_t)node);
-    }
-    y(array_close);
+    dump_depth--;
 
-    ystr("fullscreen_mode");
-    y(integer, con->fullscreen_mode);
+    if (dump_key("focus")) {
+        ystr("focus");
+        y(array_open);
+        TAILQ_FOREACH(node, &(con->focus_head), focused) {
+            y(integer, (uintptr_t)node);
+        }
+        y(array_close);
+    }
 
-    ystr("sticky");
-    y(bool, con->sticky);
+    if (dump_key("fullscreen_mode")) {
+        ystr("fullscreen_mode");
+        y(integer, con->fullscreen_mode);
+    }
 
-    ystr("floating");
-    switch (con->floating) {
-        case FLOATING_AUTO_OFF:
-            ystr("auto_off");
-            break;
-        case FLOATING_AUTO_ON:
-            ystr("auto_on");
-            break;
-        case FLOATING_USER_OFF:
-            ystr("user_off");
-            break;
-        case FLOATING_USER_ON:
-            ystr("user_on");
-            break;
+    if (dump_key("sticky")) {
+        ystr("sticky");
+        y(bool, con->sticky);
     }
 
-    ystr("swallows");
-    y(array_open);
-    Match *match;
-    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
-        /* We will generate a new restart_mode match specification after this
-         * loop, so skip this one. */
-        if (match->restart_mode)
-            continue;
-        y(map_open);
-        if (match->dock != M_DONTCHECK) {
-            ystr("dock");
-            y(integer, match->dock);
-            ystr("insert_where");
-            y(integer, match->insert_where);
+    if (dump_key("floating")) {
+        ystr("floating");
+        switch (con->floating) {
+            case FLOATING_AUTO_OFF:
+                ystr("auto_off");
+                break;
+            case FLOATING_AUTO_ON:
+                ystr("auto_on");
+                break;
+            case FLOATING_USER_OFF:
+                ystr("user_off");
+                break;
+            case FLOATING_USER_ON:
+                ystr("user_on");
+                break;
         }
+    }
+
+    if (dump_key("swallows")) {
+        ystr("swallows");
+        y(array_open);
+        Match *match;
+        TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+            /* We will generate a new restart_mode match specification after this
+             * loop, so skip this one. */
+            if (match->restart_mode)
+                continue;
+            y(map_open);
+            if (match->dock != M_DONTCHECK) {
+                ystr("dock");
+                y(integer, match->dock);
+                ystr("insert_where");
+                y(integer, match->insert_where);
+            }
 
 #define DUMP_REGEX(re_name)                \
     do {                                   \
@@ -646,26 +936,27 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
         }                                  \
     } while (0)
 
-        DUMP_REGEX(class);
-        DUMP_REGEX(instance);
-        DUMP_REGEX(window_role);
-        DUMP_REGEX(title);
+            DUMP_REGEX(class);
+            DUMP_REGEX(instance);
+            DUMP_REGEX(window_role);
+            DUMP_REGEX(title);
 
 #undef DUMP_REGEX
-        y(map_close);
-    }
-
-    if (inplace_restart) {
-        if (con->window != NULL) {
-            y(map_open);
-            ystr("id");
-            y(integer, con->window->id);
-            ystr("restart_mode");
-            y(bool, true);
             y(map_close);
         }
+
+        if (inplace_restart) {
+            if (con->window != NULL) {
+                y(map_open);
+                ystr("id");
+                y(integer, con->window->id);
+                ystr("restart_mode");
+                y(bool, true);
+                y(map_close);
+            }
+        }
+        y(array_close);
     }
-    y(array_close);
 
     if (inplace_restart && con->window != NULL) {
         ystr("depth");
@@ -859,11 +1150,147 @@ static void dump_bar_config(yajl_gen gen, Barconfig *config) {
 #undef YSTR_IF_SET
 }
 
-IPC_HANDLER(tree) {
-    setlocale(LC_NUMERIC, "C");
+/* Size of the chunks in which streamed replies are queued. */
+#define IPC_STREAM_CHUNK_SIZE 16384
+
+/*
+ * A reply which is appended to the output queue of a client while it is
+ * generated, see ipc_stream_begin() and ipc_stream_end().
+ *
+ */
+struct ipc_stream {
+    ipc_client *client;
+    bool was_empty;
+    /* The header is queued first, its size is filled in at the end. */
+    struct ipc_chunk *header;
+    /* The chunk which is currently filled. */
+    struct ipc_chunk *current;
+    size_t size;
+};
+
+static void ipc_stream_flush(struct ipc_stream *stream) {
+    if (stream->current == NULL)
+        return;
+    ipc_queue_append(stream->client, stream->current);
+    ipc_chunk_unref(stream->current);
+    stream->current = NULL;
+}
+
+/*
+ * Print callback for yajl generators which copies the generated JSON into
+ * the chunks of the stream.
+ *
+ */
+static void ipc_stream_print(void *ctx, const char *str, size_t len) {
+    struct ipc_stream *stream = ctx;
+    stream->size += len;
+    while (len > 0) {
+        if (stream->current == NULL) {
+            stream->current = smalloc(sizeof(struct ipc_chunk) + IPC_STREAM_CHUNK_SIZE);
+            stream->current->refcount = 1;
+            stream->current->size = 0;
+        }
+
+        size_t n = IPC_STREAM_CHUNK_SIZE - stream->current->size;
+        if (n > len)
+            n = len;
+        memcpy(stream->current->data + stream->current->size, str, n);
+        stream->current->size += n;
+        str += n;
+        len -= n;
+
+        if (stream->current->size == IPC_STREAM_CHUNK_SIZE)
+            ipc_stream_flush(stream);
+    }
+}
+
+static void ipc_stream_begin(struct ipc_stream *stream, ipc_client *client, const uint32_t message_type) {
+    memset(stream, '\0', sizeof(struct ipc_stream));
+    stream->client = client;
+    stream->was_empty = (client->queue_length == 0);
+    stream->header = ipc_chunk_new(message_type, 0, (const uint8_t *)"");
+    ipc_queue_append(client, stream->header);
+}
+
+/*
+ * Queues the last chunk of the stream and fills in the size of the reply.
+ * Nothing is written to the socket before, so the header can still be
+ * modified.
+ *
+ */
+static void ipc_stream_end(struct ipc_stream *stream) {
+    ipc_stream_flush(stream);
+
+    const uint32_t size = stream->size;
+    memcpy(stream->header->data + offsetof(i3_ipc_header_t, size), &size, sizeof(uint32_t));
+    ipc_chunk_unref(stream->header);
+
+    if (stream->was_empty)
+        ipc_push_pending(stream->client);
+}
+
+struct tree_request {
+    char *last_key;
+    long long con_id;
+    long long max_depth;
+    bool fields_set;
+    /* Whether the parser is inside the fields array. */
+    bool in_fields;
+    char **fields;
+    int num_fields;
+};
+
+static int _tree_json_key(void *extra, const unsigned char *val, size_t len) {
+    struct tree_request *request = extra;
+    FREE(request->last_key);
+    request->last_key = sstrndup((const char *)val, len);
+    return 1;
+}
+
+static int _tree_json_int(void *extra, long long val) {
+    struct tree_request *request = extra;
+    if (request->last_key == NULL)
+        return 0;
+    if (strcasecmp(request->last_key, "con_id") == 0) {
+        request->con_id = val;
+    } else if (strcasecmp(request->last_key, "max_depth") == 0) {
+        request->max_depth = val;
+    }
+    return 1;
+}
+
+static int _tree_json_start_array(void *extra) {
+    struct tree_request *request = extra;
+    if (request->last_key != NULL && strcasecmp(request->last_key, "fields") == 0) {
+        request->fields_set = true;
+        request->in_fields = true;
+    }
+    return 1;
+}
+
+static int _tree_json_end_array(void *extra) {
+    struct tree_request *request = extra;
+    request->in_fields = false;
+    return 1;
+}
+
+static int _tree_json_string(void *extra, const unsigned char *val, size_t len) {
+    struct tree_request *request = extra;
+    if (!request->in_fields)
+        return 1;
+    request->fields = srealloc(request->fields, (request->num_fields + 1) * sizeof(char *));
+    request->fields[request->num_fields++] = sstrndup((const char *)val, len);
+    return 1;
+}
+
+static void send_tree_error(ipc_client *client, const char *error) {
     yajl_gen gen = ygenalloc();
-    dump_node(gen, croot, false);
-    setlocale(LC_NUMERIC, "");
+    y(map_open);
+    ystr("success");
+    y(bool, false);
+    ystr("error");
+    ystr(error);
+    y(map_close);
 
     const unsigned char *payload;
     ylength length;
@@ -873,6 +1300,78 @@ IPC_HANDLER(tree) {
     y(free);
 }
 
+/*
+ * Sends the layout tree to the client. The reply is streamed into the
+ * client’s output queue while it is generated instead of being serialized
+ * into a single buffer first.
+ *
+ * An optional JSON payload restricts the reply to a subtree, e.g.
+ * {"con_id": 94812345, "max_depth": 2, "fields": ["id", "name", "nodes"]}
+ * All keys of the payload are optional.
+ *
+ */
+IPC_HANDLER(tree) {
+    struct tree_request request = {.max_depth = -1};
+    if (message_size > 0) {
+        static yajl_callbacks callbacks = {
+            .yajl_map_key = _tree_json_key,
+            .yajl_integer = _tree_json_int,
+            .yajl_start_array = _tree_json_start_array,
+            .yajl_end_array = _tree_json_end_array,
+            .yajl_string = _tree_json_string,
+        };
+
+        yajl_handle p = yalloc(&callbacks, (void *)&request);
+        yajl_status stat = yajl_parse(p, (const unsigned char *)message, message_size);
+        if (stat == yajl_status_ok)
+            stat = yajl_complete_parse(p);
+        if (stat != yajl_status_ok) {
+            unsigned char *err = yajl_get_error(p, true, (const unsigned char *)message, message_size);
+            ELOG("YAJL parse error: %s\n", err);
+            yajl_free_error(p, err);
+            yajl_free(p);
+            send_tree_error(client, "Could not parse the GET_TREE payload");
+            goto free_request;
+        }
+        yajl_free(p);
+    }
+
+    Con *root = croot;
+    if (request.con_id != 0 && (root = con_by_con_id(request.con_id)) == NULL) {
+        send_tree_error(client, "No container with the given con_id");
+        goto free_request;
+    }
+
+    if (request.fields_set && request.fields == NULL)
+        request.fields = scalloc(1, sizeof(char *));
+    dump_fields = (request.fields_set ? request.fields : NULL);
+    dump_num_fields = request.num_fields;
+    dump_max_depth = (request.max_depth < 0 ? -1 : (int)request.max_depth);
+    dump_depth = 0;
+
+    struct ipc_stream stream;
+    ipc_stream_begin(&stream, client, I3_IPC_REPLY_TYPE_TREE);
+
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ygenalloc();
+    y(config, yajl_gen_print_callback, ipc_stream_print, &stream);
+    dump_node(gen, root, false);
+    y(free);
+    setlocale(LC_NUMERIC, "");
+
+    ipc_stream_end(&stream);
+
+    dump_fields = NULL;
+    dump_num_fields = 0;
+    dump_max_depth = -1;
+
+free_request:
+    FREE(request.last_key);
+    for (int i = 0; i < request.num_fields; i++)
+        free(request.fields[i]);
+    free(request.fields);
+}
+
 /*
  * Formats the reply message for a GET_WORKSPACES request and sends it to the
  * client
@@ -1144,21 +1643,20 @@ static int add_subscription(void *extra, const unsigned char *s,
     ipc_client *client = extra;
 
     DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, s);
-    int event = client->num_events;
-
-    client->num_events++;
-    client->events = srealloc(client->events, client->num_events * sizeof(char *));
-    /* We copy the string because it is not null-terminated and strndup()
-     * is missing on some BSD systems */
-    client->events[event] = scalloc(len + 1, 1);
-    memcpy(client->events[event], s, len);
+    for (size_t i = 0; i < NUM_EVENT_TYPES; i++) {
+        if (strlen(event_names[i]) != len ||
+            strncasecmp(event_names[i], (const char *)s, len) != 0)
+            continue;
 
-    DLOG("client is now subscribed to:\n");
-    for (int i = 0; i < client->num_events; i++) {
-        DLOG("event %s\n", client->events[i]);
+        if (!(client->events & IPC_EVENT_BIT(i))) {
+            client->events |= IPC_EVENT_BIT(i);
+            num_listeners[i]++;
+        }
+        DLOG("client is now subscribed to events 0x%08x\n", client->events);
+        return 1;
     }
-    DLOG("(done)\n");
 
+    DLOG("Ignoring subscription to unknown event %.*s\n", (int)len, s);
     return 1;
 }
 
@@ -1198,14 +1696,7 @@ IPC_HANDLER(subscribe) {
         return;
     }
 
-    bool is_tick = false;
-    for (int i = 0; i < client->num_events; i++) {
-        if (strcmp(client->events[i], "tick") == 0) {
-            is_tick = true;
-            break;
-        }
-    }
-    if (!is_tick) {
+    if (!(client->events & IPC_EVENT_BIT(I3_IPC_EVENT_TICK))) {
         return;
     }
 
@@ -1240,6 +1731,12 @@ IPC_HANDLER(get_config) {
  * synchronization point in event-related tests.
  */
 IPC_HANDLER(send_tick) {
+    const char *reply = "{\"success\":true}";
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_TICK)) {
+        ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_TICK, (const uint8_t *)reply);
+        return;
+    }
+
     yajl_gen gen = ygenalloc();
 
     y(map_open);
@@ -1256,10 +1753,9 @@ IPC_HANDLER(send_tick) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("tick", I3_IPC_EVENT_TICK, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_TICK, (const char *)payload);
     y(free);
 
-    const char *reply = "{\"success\":true}";
     ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_TICK, (const uint8_t *)reply);
     DLOG("Sent tick event\n");
 }
@@ -1323,9 +1819,32 @@ IPC_HANDLER(sync) {
     ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SYNC, (const uint8_t *)reply);
 }
 
+/*
+ * Sends the main loop latency histograms and counters (see src/stats.c). With
+ * the payload "reset", they are reset after the reply was generated, so that
+ * consecutive requests each cover the time since the previous one.
+ *
+ */
+IPC_HANDLER(get_stats) {
+    yajl_gen gen = ygenalloc();
+    stats_dump(gen);
+
+    if (message_size == strlen("reset") && strncmp((const char *)message, "reset", message_size) == 0) {
+        DLOG("Resetting the main loop statistics\n");
+        stats_reset();
+    }
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_STATS, payload);
+    y(free);
+}
+
 /* The index of each callback function corresponds to the numeric
  * value of the message type (see include/i3/ipc.h) */
-handler_t handlers[12] = {
+handler_t handlers[13] = {
     handle_run_command,
     handle_get_workspaces,
     handle_subscribe,
@@ -1338,49 +1857,122 @@ handler_t handlers[12] = {
     handle_get_config,
     handle_send_tick,
     handle_sync,
+    handle_get_stats,
 };
 
 /*
- * Handler for activity on a client connection, receives a message from a
- * client.
+ * Passes a completely received message to its handler. Returns false if the
+ * client was freed while handling the message.
+ *
+ */
+static bool ipc_dispatch_message(ipc_client *client, uint32_t message_type, uint32_t message_length, uint8_t *message) {
+    /* Only consecutive commands are coalesced into a single render. All other
+     * messages (and commands of clients which are still waiting for a reply)
+     * need to see the rendered tree. */
+    if (message_type != I3_IPC_MESSAGE_TYPE_RUN_COMMAND ||
+        client->deferred_reply != NULL)
+        tree_render_if_needed();
+
+    const uint64_t start = stats_now();
+    dispatching_client = client;
+    if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
+        DLOG("Unhandled message type: %d\n", message_type);
+    else {
+        handler_t h = handlers[message_type];
+        h(client, message, 0, message_length, message_type);
+    }
+    stats_record(STATS_PHASE_IPC, start);
+
+    const bool alive = (dispatching_client != NULL);
+    dispatching_client = NULL;
+    return alive;
+}
+
+/*
+ * Handler for activity on a client connection, receives a message or (more
+ * likely) a part of one.
  *
- * For now, the maximum message size is 2048. I’m not sure for what the
- * IPC interface will be used in the future, thus I’m not implementing a
- * mechanism for arbitrarily long messages, as it seems like overkill
- * at the moment.
+ * The socket is non-blocking and read only once per callback, so a client
+ * which stops in the middle of a message cannot block i3. Whatever arrived is
+ * fed into the client's receive state (header first, then payload), which is
+ * resumed on the next callback. All messages which are complete after this
+ * read are handled right away, so pipelined requests are processed in order.
  *
  */
 static void ipc_receive_message(EV_P_ struct ev_io *w, int revents) {
-    uint32_t message_type;
-    uint32_t message_length;
-    uint8_t *message = NULL;
+    static uint8_t buffer[65536];
     ipc_client *client = (ipc_client *)w->data;
     assert(client->fd == w->fd);
 
-    int ret = ipc_recv_message(w->fd, &message_type, &message_length, &message);
-    /* EOF or other error */
-    if (ret < 0) {
-        /* Was this a spurious read? See ev(3) */
-        if (ret == -1 && errno == EAGAIN) {
-            FREE(message);
-            return;
+    const ssize_t n = read(w->fd, buffer, sizeof(buffer));
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        /* Spurious read, see ev(3) */
+        return;
+    }
+    if (n <= 0) {
+        /* EOF or some kind of error. We don’t bother and close the connection.
+         * Delete the client from the list of clients. */
+        if (n == 0 && client->read_offset > 0) {
+            ELOG("IPC: unexpected EOF on fd %d after %zu bytes of a message\n",
+                 client->fd, client->read_offset);
         }
-
-        /* If not, there was some kind of error. We don’t bother and close the
-         * connection. Delete the client from the list of clients. */
         free_ipc_client(client);
-        FREE(message);
         return;
     }
+    loop_stats.ipc_bytes_in += n;
 
-    if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
-        DLOG("Unhandled message type: %d\n", message_type);
-    else {
-        handler_t h = handlers[message_type];
-        h(client, message, 0, message_length, message_type);
-    }
+    const size_t header_size = sizeof(i3_ipc_header_t);
+    const uint8_t *walk = buffer;
+    const uint8_t *end = buffer + n;
+    while (walk < end) {
+        if (client->read_offset < header_size) {
+            size_t chunk = header_size - client->read_offset;
+            if (chunk > (size_t)(end - walk))
+                chunk = end - walk;
+            memcpy(((uint8_t *)&(client->read_header)) + client->read_offset, walk, chunk);
+            client->read_offset += chunk;
+            walk += chunk;
+            if (client->read_offset < header_size)
+                break;
+
+            if (memcmp(client->read_header.magic, I3_IPC_MAGIC, strlen(I3_IPC_MAGIC)) != 0) {
+                ELOG("IPC: invalid magic in header on fd %d, disconnecting\n", client->fd);
+                free_ipc_client(client);
+                return;
+            }
+            if (client->read_header.size > IPC_MAX_MESSAGE_SIZE) {
+                ELOG("IPC: message of %" PRIu32 " bytes on fd %d exceeds the limit of %d bytes, disconnecting\n",
+                     client->read_header.size, client->fd, IPC_MAX_MESSAGE_SIZE);
+                free_ipc_client(client);
+                return;
+            }
+            if (client->read_header.size > 0)
+                client->read_payload = smalloc(client->read_header.size);
+        }
+
+        const size_t received = client->read_offset - header_size;
+        size_t chunk = client->read_header.size - received;
+        if (chunk > (size_t)(end - walk))
+            chunk = end - walk;
+        if (chunk > 0) {
+            memcpy(client->read_payload + received, walk, chunk);
+            client->read_offset += chunk;
+            walk += chunk;
+        }
+        if (client->read_offset < header_size + client->read_header.size)
+            break;
 
-    FREE(message);
+        /* The message is complete. Reset the receive state before handling
+         * it, the next message might already be in the buffer. */
+        uint8_t *message = client->read_payload;
+        client->read_payload = NULL;
+        client->read_offset = 0;
+        const bool alive = ipc_dispatch_message(client, client->read_header.type,
+                                                client->read_header.size, message);
+        free(message);
+        if (!alive)
+            return;
+    }
 }
 
 static void ipc_client_timeout(EV_P_ ev_timer *w, int revents) {
@@ -1567,13 +2159,16 @@ yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old)
  * previously focused workspace in "old".
  */
 void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_WORKSPACE))
+        return;
+
     yajl_gen gen = ipc_marshal_workspace_event(change, current, old);
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_WORKSPACE, (const char *)payload);
 
     y(free);
 }
@@ -1583,6 +2178,9 @@ void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
  * also the window container, in "container".
  */
 void ipc_send_window_event(const char *property, Con *con) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_WINDOW))
+        return;
+
     DLOG("Issue IPC window %s event (con = %p, window = 0x%08x)\n",
          property, con, (con->window ? con->window->id : XCB_WINDOW_NONE));
 
@@ -1603,7 +2201,7 @@ void ipc_send_window_event(const char *property, Con *con) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("window", I3_IPC_EVENT_WINDOW, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_WINDOW, (const char *)payload);
     y(free);
     setlocale(LC_NUMERIC, "");
 }
@@ -1612,6 +2210,9 @@ void ipc_send_window_event(const char *property, Con *con) {
  * For the barconfig update events, we send the serialized barconfig.
  */
 void ipc_send_barconfig_update_event(Barconfig *barconfig) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_BARCONFIG_UPDATE))
+        return;
+
     DLOG("Issue barconfig_update event for id = %s\n", barconfig->id);
     setlocale(LC_NUMERIC, "C");
     yajl_gen gen = ygenalloc();
@@ -1622,7 +2223,7 @@ void ipc_send_barconfig_update_event(Barconfig *barconfig) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("barconfig_update", I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
     y(free);
     setlocale(LC_NUMERIC, "");
 }
@@ -1631,6 +2232,9 @@ void ipc_send_barconfig_update_event(Barconfig *barconfig) {
  * For the binding events, we send the serialized binding struct.
  */
 void ipc_send_binding_event(const char *event_type, Binding *bind) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_BINDING))
+        return;
+
     DLOG("Issue IPC binding %s event (sym = %s, code = %d)\n", event_type, bind->symbol, bind->keycode);
 
     setlocale(LC_NUMERIC, "C");
@@ -1651,7 +2255,7 @@ void ipc_send_binding_event(const char *event_type, Binding *bind) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("binding", I3_IPC_EVENT_BINDING, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_BINDING, (const char *)payload);
 
     y(free);
     setlocale(LC_NUMERIC, "");
@@ -7,6 +7,7 @@
  * key_press.c: key press handler
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_BINDINGS
 #include "all.h"
 
 /*
@@ -691,6 +691,9 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
     yajl_complete_parse(hand);
     yajl_free(hand);
 
+    /* The restored containers may contain new swallow criteria. */
+    match_invalidate_sets();
+
     if (to_focus) {
         con_activate(to_focus);
     }
@@ -10,11 +10,14 @@
 #include <config.h>
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -35,6 +38,21 @@
 #endif
 
 static bool debug_logging = false;
+uint32_t debug_log_modules = UINT32_MAX;
+static const char *log_module_names[NUM_LOG_MODULES] = {
+    [LOG_MODULE_OTHER] = "other",
+    [LOG_MODULE_RENDER] = "render",
+    [LOG_MODULE_X] = "x",
+    [LOG_MODULE_IPC] = "ipc",
+    [LOG_MODULE_HANDLERS] = "handlers",
+    [LOG_MODULE_CON] = "con",
+    [LOG_MODULE_BINDINGS] = "bindings",
+    [LOG_MODULE_TREE] = "tree",
+    [LOG_MODULE_WORKSPACE] = "workspace",
+    [LOG_MODULE_FLOATING] = "floating",
+    [LOG_MODULE_MANAGE] = "manage",
+    [LOG_MODULE_CONFIG] = "config",
+};
 static bool verbose = false;
 static FILE *errorfile;
 char *errorfilename;
@@ -62,6 +80,31 @@ static int logbuffer_size;
 static int logbuffer_shm;
 /* Size (in bytes) of physical memory */
 static long long physical_mem_bytes;
+/* A pointer to the oldest complete record. */
+static char *logoldest;
+/* Whether logoldest points to a record written before the last wrap (which
+ * will be overwritten next). */
+static bool logoldest_before_wrap;
+/* A pointer to the format string table, which follows the ringbuffer. */
+static char *logformats;
+
+/* Number of entries of the format cache. i3 has less than 2000 log
+ * statements, so this is plenty. */
+#define FORMAT_CACHE_SIZE 8192
+
+/*
+ * Caches the ID in the format table (and the conversion specifications) of
+ * the format strings which were logged, keyed by their address.
+ *
+ */
+struct format_entry {
+    const char *fmt;
+    uint32_t id;
+    int num_specs;
+    printf_spec_t *specs;
+};
+static struct format_entry format_cache[FORMAT_CACHE_SIZE];
+static int format_cache_used;
 
 /*
  * Writes the offsets for the next write and for the last wrap to the
@@ -72,9 +115,301 @@ static long long physical_mem_bytes;
 static void store_log_markers(void) {
     header->offset_next_write = (logwalk - logbuffer);
     header->offset_last_wrap = (loglastwrap - logbuffer);
+    header->offset_oldest = (logoldest - logbuffer);
     header->size = logbuffer_size;
 }
 
+/*
+ * Empties the format cache, for example because the format table of a new
+ * shmlog is empty.
+ *
+ */
+static void clear_format_cache(void) {
+    for (int i = 0; i < FORMAT_CACHE_SIZE; i++)
+        free(format_cache[i].specs);
+    memset(format_cache, '\0', sizeof(format_cache));
+    format_cache_used = 0;
+}
+
+/*
+ * Parses the given format string and copies it into the format table. The
+ * entry keeps the ID SHMLOG_FORMAT_TEXT if the arguments of the format string
+ * cannot be packed or if the table is full.
+ *
+ */
+static void intern_format(struct format_entry *entry, const char *fmt) {
+    entry->fmt = fmt;
+    entry->id = SHMLOG_FORMAT_TEXT;
+    entry->num_specs = 0;
+    FREE(entry->specs);
+
+    printf_spec_t specs[32];
+    int num_specs = 0;
+    for (const char *walk = fmt; *walk != '\0'; walk++) {
+        if (*walk != '%')
+            continue;
+        if (num_specs == 32 || !parse_printf_spec(walk, &specs[num_specs]))
+            return;
+        walk += specs[num_specs].len - 1;
+        num_specs++;
+    }
+
+    const size_t len = strlen(fmt) + 1;
+    if (header->formats_used + len > header->formats_size)
+        return;
+    memcpy(logformats + header->formats_used, fmt, len);
+    entry->id = header->formats_used;
+    header->formats_used += len;
+
+    entry->num_specs = num_specs;
+    if (num_specs > 0) {
+        entry->specs = smalloc(num_specs * sizeof(printf_spec_t));
+        memcpy(entry->specs, specs, num_specs * sizeof(printf_spec_t));
+    }
+}
+
+/*
+ * Returns the format cache entry for the given format string, adding it to
+ * the cache and the format table if necessary. Returns NULL if the cache is
+ * full.
+ *
+ */
+static struct format_entry *lookup_format(const char *fmt) {
+    size_t idx = ((uintptr_t)fmt >> 3) % FORMAT_CACHE_SIZE;
+    for (int n = 0; n < FORMAT_CACHE_SIZE; n++, idx = (idx + 1) % FORMAT_CACHE_SIZE) {
+        struct format_entry *entry = &format_cache[idx];
+        if (entry->fmt == fmt) {
+            /* Format strings which are not literals might be freed and their
+             * memory reused for another format string. */
+            if (entry->id != SHMLOG_FORMAT_TEXT && strcmp(logformats + entry->id, fmt) != 0)
+                intern_format(entry, fmt);
+            return entry;
+        }
+        if (entry->fmt == NULL) {
+            if (format_cache_used >= FORMAT_CACHE_SIZE * 3 / 4)
+                return NULL;
+            format_cache_used++;
+            intern_format(entry, fmt);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static bool pack_int(uint8_t **walk, const uint8_t *end, int64_t value) {
+    if (*walk + sizeof(int64_t) > end)
+        return false;
+    memcpy(*walk, &value, sizeof(int64_t));
+    *walk += sizeof(int64_t);
+    return true;
+}
+
+static bool pack_double(uint8_t **walk, const uint8_t *end, double value) {
+    if (*walk + sizeof(double) > end)
+        return false;
+    memcpy(*walk, &value, sizeof(double));
+    *walk += sizeof(double);
+    return true;
+}
+
+static bool pack_string(uint8_t **walk, const uint8_t *end, const char *str, size_t len) {
+    if (*walk + sizeof(uint32_t) > end)
+        return false;
+    /* Long strings are truncated to fit into the record. */
+    if (len > (size_t)(end - *walk) - sizeof(uint32_t))
+        len = (end - *walk) - sizeof(uint32_t);
+    const uint32_t len32 = len;
+    memcpy(*walk, &len32, sizeof(uint32_t));
+    memcpy(*walk + sizeof(uint32_t), str, len);
+    *walk += sizeof(uint32_t) + len;
+    return true;
+}
+
+/*
+ * Stores the arguments of the given format string in binary form (see
+ * i3_shmlog_record). Returns the number of bytes used or -1 if the arguments
+ * do not fit.
+ *
+ */
+static ssize_t pack_args(uint8_t *buffer, size_t size, const struct format_entry *entry, va_list args) {
+    uint8_t *walk = buffer;
+    const uint8_t *end = buffer + size;
+    for (int i = 0; i < entry->num_specs; i++) {
+        const printf_spec_t *spec = &(entry->specs[i]);
+        if (spec->width_from_arg && !pack_int(&walk, end, va_arg(args, int)))
+            return -1;
+        int precision = (spec->has_precision ? spec->precision : -1);
+        if (spec->precision_from_arg) {
+            precision = va_arg(args, int);
+            if (!pack_int(&walk, end, precision))
+                return -1;
+        }
+
+        bool packed = true;
+        switch (spec->type) {
+            case PRINTF_ARG_NONE:
+                break;
+            case PRINTF_ARG_INT:
+                packed = pack_int(&walk, end, va_arg(args, int));
+                break;
+            case PRINTF_ARG_LONG:
+                packed = pack_int(&walk, end, va_arg(args, long));
+                break;
+            case PRINTF_ARG_LLONG:
+                packed = pack_int(&walk, end, va_arg(args, long long));
+                break;
+            case PRINTF_ARG_INTMAX:
+                packed = pack_int(&walk, end, va_arg(args, intmax_t));
+                break;
+            case PRINTF_ARG_SIZE:
+                packed = pack_int(&walk, end, va_arg(args, size_t));
+                break;
+            case PRINTF_ARG_PTRDIFF:
+                packed = pack_int(&walk, end, va_arg(args, ptrdiff_t));
+                break;
+            case PRINTF_ARG_DOUBLE:
+                packed = pack_double(&walk, end, va_arg(args, double));
+                break;
+            case PRINTF_ARG_LDOUBLE:
+                packed = pack_double(&walk, end, va_arg(args, long double));
+                break;
+            case PRINTF_ARG_POINTER:
+                packed = pack_int(&walk, end, (uintptr_t)va_arg(args, void *));
+                break;
+            case PRINTF_ARG_STRING: {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL)
+                    str = "(null)";
+                const size_t len = (precision >= 0 ? strnlen(str, precision) : strlen(str));
+                packed = pack_string(&walk, end, str, len);
+                break;
+            }
+        }
+        if (!packed)
+            return -1;
+    }
+    return walk - buffer;
+}
+
+/*
+ * Appends a record with the given format ID and packed arguments to the
+ * ringbuffer, wrapping if necessary.
+ *
+ * Readers do not lock the ringbuffer. All changes happen between two
+ * increments of header->lock (which is odd in the meantime), and records
+ * are only overwritten after oldest_seq was advanced past them. Readers copy
+ * a record and then check (with a consistent copy of the header) that its
+ * sequence number is still >= oldest_seq.
+ *
+ */
+static void write_record(uint32_t format_id, const uint8_t *args, size_t args_len) {
+    const size_t size = (sizeof(i3_shmlog_record) + args_len + 7) & ~((size_t)7);
+    char *start = logbuffer + sizeof(i3_shmlog_header);
+    char *end = logformats;
+    if (size > (size_t)(end - start))
+        return;
+
+    __atomic_store_n(&(header->lock), header->lock + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    /* If there is no space for the current record in the ringbuffer, we
+     * need to wrap and write to the beginning again. The records after
+     * logwalk are older than the one at the beginning, so they are dropped
+     * as well. */
+    if (size > (size_t)(end - logwalk)) {
+        loglastwrap = logwalk;
+        logwalk = start;
+        logoldest = start;
+        logoldest_before_wrap = true;
+        header->oldest_seq = ((i3_shmlog_record *)start)->seq;
+        header->wrap_count++;
+    }
+
+    /* Skip the old records which are about to be overwritten. */
+    if (logoldest_before_wrap) {
+        while (logoldest < loglastwrap && logoldest < logwalk + size) {
+            const i3_shmlog_record *old = (i3_shmlog_record *)logoldest;
+            header->oldest_seq = old->seq + 1;
+            logoldest += old->size;
+        }
+        if (logoldest >= loglastwrap) {
+            /* All records before the wrap are gone, the oldest one is the
+             * first record after the wrap. */
+            logoldest = start;
+            logoldest_before_wrap = false;
+        }
+    }
+    header->offset_oldest = (logoldest - logbuffer);
+
+    /* Make sure that readers see the new oldest_seq before the data of the
+     * old records changes. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    i3_shmlog_record *record = (i3_shmlog_record *)logwalk;
+    record->size = size;
+    record->format_id = format_id;
+    record->seq = header->next_seq;
+    record->timestamp = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    memcpy(logwalk + sizeof(i3_shmlog_record), args, args_len);
+    logwalk += size;
+
+    header->next_seq++;
+    store_log_markers();
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&(header->lock), header->lock + 1, __ATOMIC_RELAXED);
+
+#if !defined(__OpenBSD__)
+    /* Wake up all (i3-dump-log) processes waiting for condvar, if any. */
+    if (__atomic_load_n(&(header->followers), __ATOMIC_ACQUIRE) > 0)
+        pthread_cond_broadcast(&(header->condvar));
+#endif
+}
+
+/*
+ * Saves the given message in the i3 SHM log. The arguments are packed in
+ * binary form and formatted by i3-dump-log. Messages whose format string is
+ * not supported are formatted here and stored as text.
+ *
+ */
+static void shmlog_write(const char *fmt, va_list args) {
+    static uint8_t buffer[SHMLOG_MAX_RECORD_SIZE - sizeof(i3_shmlog_record)];
+
+    struct format_entry *entry = lookup_format(fmt);
+    if (entry != NULL && entry->id != SHMLOG_FORMAT_TEXT) {
+        va_list copy;
+        va_copy(copy, args);
+        const ssize_t len = pack_args(buffer, sizeof(buffer), entry, copy);
+        va_end(copy);
+        if (len >= 0) {
+            write_record(entry->id, buffer, len);
+            return;
+        }
+    }
+
+    char *text = (char *)buffer + sizeof(uint32_t);
+    const size_t text_size = sizeof(buffer) - sizeof(uint32_t);
+    size_t len = vsnprintf(text, text_size, fmt, args);
+    if (len >= text_size) {
+        fprintf(stderr, "BUG: single log message > 4k\n");
+
+        /* vsnprintf returns the number of bytes that *would have been written*,
+         * not the actual amount written. Thus, limit len to the buffer size to
+         * avoid memory corruption and outputting garbage later. */
+        len = text_size - 1;
+
+        /* Punch in a newline so the next log message is not dangling at
+         * the end of the truncated message. */
+        text[len - 1] = '\n';
+    }
+    const uint32_t len32 = len;
+    memcpy(buffer, &len32, sizeof(uint32_t));
+    write_record(SHMLOG_FORMAT_TEXT, buffer, sizeof(uint32_t) + len);
+}
+
 /*
  * Initializes logging by creating an error logfile in /tmp (or
  * XDG_RUNTIME_DIR, see get_process_filename()).
@@ -172,8 +507,25 @@ void open_logbuffer(void) {
     pthread_cond_init(&(header->condvar), &cond_attr);
 #endif
 
+    /* The format table takes an eighth of the SHM log, but at most 256 KiB. */
+    header->formats_size = min(logbuffer_size / 8, 256 * 1024);
+    header->offset_formats = logbuffer_size - header->formats_size;
+    header->formats_used = 0;
+    logformats = logbuffer + header->offset_formats;
+    clear_format_cache();
+
+    struct timespec realtime, monotonic;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    header->realtime_offset = ((int64_t)realtime.tv_sec - monotonic.tv_sec) * 1000000000 +
+                              ((int64_t)realtime.tv_nsec - monotonic.tv_nsec);
+
     logwalk = logbuffer + sizeof(i3_shmlog_header);
-    loglastwrap = logbuffer + logbuffer_size;
+    loglastwrap = logformats;
+    logoldest = logwalk;
+    logoldest_before_wrap = false;
+    header->oldest_seq = 0;
+    header->next_seq = 0;
     store_log_markers();
 }
 
@@ -215,6 +567,79 @@ void set_debug_logging(const bool _debug_logging) {
     debug_logging = _debug_logging;
 }
 
+/*
+ * Returns the name of the given log module (e.g. "render").
+ *
+ */
+const char *log_module_name(int module) {
+    if (module < 0 || module >= NUM_LOG_MODULES)
+        return NULL;
+    return log_module_names[module];
+}
+
+/*
+ * Changes the modules for which debug messages are logged. spec is a
+ * space-separated list of module names (or "all"), each optionally prefixed
+ * with + or - to enable or disable it. Without a prefix on the first entry,
+ * only the listed modules are enabled. Returns false (and leaves the modules
+ * unchanged) if spec contains an unknown module.
+ *
+ */
+bool set_debug_log_modules(const char *spec) {
+    const uint32_t all = (UINT32_C(1) << NUM_LOG_MODULES) - 1;
+    uint32_t modules = debug_log_modules;
+    bool first = true;
+
+    const char *walk = spec;
+    while (*walk != '\0') {
+        /* Commas separate commands, so the list is separated by white
+         * space. */
+        walk += strspn(walk, " \t");
+        const char *name = walk;
+        size_t len = strcspn(walk, " \t");
+        walk += len;
+        if (len == 0)
+            continue;
+
+        char op = '=';
+        if (*name == '+' || *name == '-') {
+            op = *name;
+            name++;
+            len--;
+        }
+
+        uint32_t bits = 0;
+        if (len == strlen("all") && strncasecmp(name, "all", len) == 0) {
+            bits = all;
+        } else if (len == strlen("none") && strncasecmp(name, "none", len) == 0) {
+            bits = 0;
+        } else {
+            int module;
+            for (module = 0; module < NUM_LOG_MODULES; module++) {
+                if (strlen(log_module_names[module]) == len &&
+                    strncasecmp(name, log_module_names[module], len) == 0)
+                    break;
+            }
+            if (module == NUM_LOG_MODULES) {
+                ELOG("Unknown log module \"%.*s\"\n", (int)len, name);
+                return false;
+            }
+            bits = (UINT32_C(1) << module);
+        }
+
+        if (op == '-')
+            modules &= ~bits;
+        else if (op == '+' || !first)
+            modules |= bits;
+        else
+            modules = bits;
+        first = false;
+    }
+
+    debug_log_modules = modules;
+    return true;
+}
+
 /*
  * Logs the given message to stdout (if print is true) while prefixing the
  * current time to it. Additionally, the message will be saved in the i3 SHM
@@ -223,77 +648,36 @@ void set_debug_logging(const bool _debug_logging) {
  *
  */
 static void vlog(const bool print, const char *fmt, va_list args) {
-    /* Precisely one page to not consume too much memory but to hold enough
-     * data to be useful. */
-    static char message[4096];
+    if (logbuffer) {
+        va_list copy;
+        va_copy(copy, args);
+        shmlog_write(fmt, copy);
+        va_end(copy);
+    }
+
+    if (!print)
+        return;
+
+    static char prefix[64];
     static struct tm result;
     static time_t t;
     static struct tm *tmp;
-    static size_t len;
 
     /* Get current time */
     t = time(NULL);
     /* Convert time to local time (determined by the locale) */
     tmp = localtime_r(&t, &result);
     /* Generate time prefix */
-    len = strftime(message, sizeof(message), "%x %X - ", tmp);
-
-    /*
-     * logbuffer  print
-     * ----------------
-     *  true      true   format message, save, print
-     *  true      false  format message, save
-     *  false     true   print message only
-     *  false     false  INVALID, never called
-     */
-    if (!logbuffer) {
+    strftime(prefix, sizeof(prefix), "%x %X - ", tmp);
+
 #ifdef DEBUG_TIMING
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        printf("%s%d.%d - ", message, tv.tv_sec, tv.tv_usec);
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    printf("%s%d.%d - ", prefix, tv.tv_sec, tv.tv_usec);
 #else
-        printf("%s", message);
-#endif
-        vprintf(fmt, args);
-    } else {
-        len += vsnprintf(message + len, sizeof(message) - len, fmt, args);
-        if (len >= sizeof(message)) {
-            fprintf(stderr, "BUG: single log message > 4k\n");
-
-            /* vsnprintf returns the number of bytes that *would have been written*,
-             * not the actual amount written. Thus, limit len to sizeof(message) to avoid
-             * memory corruption and outputting garbage later.  */
-            len = sizeof(message);
-
-            /* Punch in a newline so the next log message is not dangling at
-             * the end of the truncated message. */
-            message[len - 2] = '\n';
-        }
-
-        /* If there is no space for the current message in the ringbuffer, we
-         * need to wrap and write to the beginning again. */
-        if (len >= (size_t)(logbuffer_size - (logwalk - logbuffer))) {
-            loglastwrap = logwalk;
-            logwalk = logbuffer + sizeof(i3_shmlog_header);
-            store_log_markers();
-            header->wrap_count++;
-        }
-
-        /* Copy the buffer, move the write pointer to the byte after our
-         * current message. */
-        strncpy(logwalk, message, len);
-        logwalk += len;
-
-        store_log_markers();
-
-#if !defined(__OpenBSD__)
-        /* Wake up all (i3-dump-log) processes waiting for condvar. */
-        pthread_cond_broadcast(&(header->condvar));
+    printf("%s", prefix);
 #endif
-
-        if (print)
-            fwrite(message, len, 1, stdout);
-    }
+    vprintf(fmt, args);
 }
 
 /*
@@ -105,37 +105,56 @@ static void xcb_got_event(EV_P_ struct ev_io *w, int revents) {
 /*
  * Called just before the event loop sleeps. Ensures xcb’s incoming and outgoing
  * queues are empty so that any activity will trigger another event loop
- * iteration, and hence another xcb_prepare_cb invocation.
+ * iteration, and hence another xcb_prepare_cb invocation. Also performs the
+ * render scheduled with tree_render_later(), if any.
  *
  */
 static void xcb_prepare_cb(EV_P_ ev_prepare *w, int revents) {
+    const uint64_t start = stats_now();
+
     /* Process all queued (and possibly new) events before the event loop
-       sleeps. */
+       sleeps. Rendering waits for replies (e.g. when warping the pointer),
+       during which xcb reads and queues further events. These would not make
+       the connection readable again, so they are handled right away. */
     xcb_generic_event_t *event;
 
-    while ((event = xcb_poll_for_event(conn)) != NULL) {
-        if (event->response_type == 0) {
-            if (event_is_ignored(event->sequence, 0))
-                DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
-            else {
-                xcb_generic_error_t *error = (xcb_generic_error_t *)event;
-                DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
-                     error->sequence, error->error_code);
+    do {
+        while ((event = xcb_poll_for_event(conn)) != NULL) {
+            if (event->response_type == 0) {
+                if (event_is_ignored(event->sequence, 0))
+                    DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
+                else {
+                    xcb_generic_error_t *error = (xcb_generic_error_t *)event;
+                    DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
+                         error->sequence, error->error_code);
+                }
+                free(event);
+                continue;
             }
+
+            /* Strip off the highest bit (set if the event is generated) */
+            int type = (event->response_type & 0x7F);
+
+            const uint64_t event_start = stats_now();
+            handle_event(type, event);
+            stats_record(STATS_PHASE_X_EVENT, event_start);
+            loop_stats.x_events[type]++;
+
             free(event);
-            continue;
         }
 
-        /* Strip off the highest bit (set if the event is generated) */
-        int type = (event->response_type & 0x7F);
+        /* Handle all keymap changes of this event loop iteration at once. */
+        bindings_update_keys();
 
-        handle_event(type, event);
-
-        free(event);
-    }
+        /* Render the tree once for all the events and IPC commands which were
+         * handled during this event loop iteration, then handle the events
+         * which were queued while rendering. */
+    } while (tree_render_if_needed());
 
     /* Flush all queued events to X11. */
     xcb_flush(conn);
+
+    stats_record(STATS_PHASE_PREPARE, start);
 }
 
 /*
@@ -522,6 +541,8 @@ int main(int argc, char *argv[]) {
     if (xcb_connection_has_error(conn))
         errx(EXIT_FAILURE, "Cannot open display");
 
+    stats_reset();
+
     sndisplay = sn_xcb_display_new(conn, NULL, NULL);
 
     /* Initialize the libev event loop. This needs to be done before loading
@@ -726,9 +747,26 @@ int main(int argc, char *argv[]) {
     grab_all_keys(conn);
 
     bool needs_tree_init = true;
+    char *snapshot_path = getenv("I3_RESTART_SNAPSHOT");
+    if (snapshot_path != NULL && delete_layout_path) {
+        /* Not to be inherited by the processes started by i3. */
+        snapshot_path = sstrdup(snapshot_path);
+        unsetenv("I3_RESTART_SNAPSHOT");
+
+        LOG("Trying to restore the layout from the snapshot \"%s\".\n", snapshot_path);
+        needs_tree_init = !tree_restore(snapshot_path, greply);
+        const int snapshot_fd = restart_snapshot_inherited_fd(snapshot_path);
+        if (snapshot_fd != -1)
+            close(snapshot_fd);
+        free(snapshot_path);
+    }
     if (layout_path != NULL) {
-        LOG("Trying to restore the layout from \"%s\".\n", layout_path);
-        needs_tree_init = !tree_restore(layout_path, greply);
+        /* The JSON layout is the fallback for when there is no snapshot or it
+         * could not be loaded. */
+        if (needs_tree_init) {
+            LOG("Trying to restore the layout from \"%s\".\n", layout_path);
+            needs_tree_init = !tree_restore(layout_path, greply);
+        }
         if (delete_layout_path) {
             unlink(layout_path);
             const char *dir = dirname(layout_path);
@@ -7,12 +7,46 @@
  * manage.c: Initially managing new windows (or existing ones on restart).
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_MANAGE
 #include "all.h"
 
 #include "yajl_utils.h"
 
 #include <yajl/yajl_gen.h>
 
+/* Number of windows whose requests are in flight at the same time in
+ * manage_existing_windows(). Bounds the memory used for buffered replies. */
+#define MANAGE_BATCH_SIZE 128
+
+/*
+ * The requests manage_window() needs answered for one window. They are sent
+ * for a whole batch of windows before any reply is waited for (see
+ * manage_windows()), so managing many windows at once (e.g. on restart) costs a
+ * few round trips in total instead of several per window.
+ *
+ */
+struct manage_request {
+    xcb_window_t window;
+    bool needs_to_be_mapped;
+
+    xcb_get_window_attributes_cookie_t attr_cookie;
+    xcb_get_geometry_cookie_t geom_cookie;
+    xcb_get_window_attributes_reply_t *attr;
+
+    /* Only sent if the window is to be managed, see manage_send_properties(). */
+    bool properties_sent;
+    xcb_void_cookie_t event_mask_cookie;
+    xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
+        utf8_title_cookie, title_cookie,
+        class_cookie, leader_cookie, transient_cookie,
+        role_cookie, startup_id_cookie, wm_hints_cookie,
+        wm_normal_hints_cookie, motif_wm_hints_cookie, wm_user_time_cookie, wm_desktop_cookie,
+        protocols_cookie;
+    xcb_shape_query_extents_cookie_t shape_cookie;
+};
+
+static void manage_windows(struct manage_request *requests, int num);
+
 /*
  * Go through all existing windows (if the window manager is restarted) and manage them
  *
@@ -21,26 +55,32 @@ void manage_existing_windows(xcb_window_t root) {
     xcb_query_tree_reply_t *reply;
     int i, len;
     xcb_window_t *children;
-    xcb_get_window_attributes_cookie_t *cookies;
 
     /* Get the tree of windows whose parent is the root window (= all) */
     if ((reply = xcb_query_tree_reply(conn, xcb_query_tree(conn, root), 0)) == NULL)
         return;
 
     len = xcb_query_tree_children_length(reply);
-    cookies = smalloc(len * sizeof(*cookies));
-
-    /* Request the window attributes for every window */
     children = xcb_query_tree_children(reply);
-    for (i = 0; i < len; ++i)
-        cookies[i] = xcb_get_window_attributes(conn, children[i]);
 
-    /* Call manage_window with the attributes for every window */
-    for (i = 0; i < len; ++i)
-        manage_window(children[i], cookies[i], true);
+    struct manage_request *requests = scalloc(MANAGE_BATCH_SIZE, sizeof(struct manage_request));
+    for (int start = 0; start < len; start += MANAGE_BATCH_SIZE) {
+        const int num = min(len - start, MANAGE_BATCH_SIZE);
+
+        /* Request the window attributes for every window of this batch */
+        for (i = 0; i < num; ++i) {
+            requests[i] = (struct manage_request){
+                .window = children[start + i],
+                .needs_to_be_mapped = true,
+                .attr_cookie = xcb_get_window_attributes(conn, children[start + i]),
+            };
+        }
+
+        manage_windows(requests, num);
+    }
 
+    free(requests);
     free(reply);
-    free(cookies);
 }
 
 /*
@@ -75,128 +115,203 @@ void restore_geometry(void) {
 }
 
 /*
- * Do some sanity checks and then reparent the window.
+ * Sends the requests for everything manage_window_finish() needs to know about
+ * the window, without waiting for any reply.
+ *
+ * The event mask is changed first, so that we are notified of property changes
+ * which happen after we requested the properties but before we reparented the
+ * window and set our final event mask. We need StructureNotify because the
+ * client may unmap the window before we get to re-parent it.
  *
  */
-void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cookie,
-                   bool needs_to_be_mapped) {
-    DLOG("window 0x%08x\n", window);
+static void manage_send_properties(struct manage_request *request) {
+    const xcb_window_t window = request->window;
+    uint32_t values[] = {XCB_EVENT_MASK_PROPERTY_CHANGE |
+                         XCB_EVENT_MASK_STRUCTURE_NOTIFY};
+    request->event_mask_cookie =
+        xcb_change_window_attributes_checked(conn, window, XCB_CW_EVENT_MASK, values);
 
-    xcb_drawable_t d = {window};
-    xcb_get_geometry_cookie_t geomc;
-    xcb_get_geometry_reply_t *geom;
-    xcb_get_window_attributes_reply_t *attr = NULL;
+#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
 
-    xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
-        utf8_title_cookie, title_cookie,
-        class_cookie, leader_cookie, transient_cookie,
-        role_cookie, startup_id_cookie, wm_hints_cookie,
-        wm_normal_hints_cookie, motif_wm_hints_cookie, wm_user_time_cookie, wm_desktop_cookie;
+    request->wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
+    request->strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
+    request->state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
+    request->utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
+    request->leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
+    request->transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
+    request->title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
+    request->class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
+    request->role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
+    request->startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
+    request->wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
+    request->wm_normal_hints_cookie = xcb_icccm_get_wm_normal_hints(conn, window);
+    request->motif_wm_hints_cookie = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
+    request->wm_user_time_cookie = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
+    request->wm_desktop_cookie = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
+    request->protocols_cookie = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
+
+#undef GET_PROPERTY
+
+    if (shape_supported) {
+        /* Receive ShapeNotify events whenever the client altered its window
+         * shape. */
+        xcb_shape_select_input(conn, window, true);
+
+        /* Check if the window is shaped. Sadly, we can check only for the
+         * bounding shape, not for the input shape. */
+        request->shape_cookie = xcb_shape_query_extents(conn, window);
+    }
+
+    request->properties_sent = true;
+}
+
+/*
+ * Discards the replies to the requests sent by manage_send_properties() when
+ * the window will not be managed after all.
+ *
+ */
+static void manage_discard_properties(struct manage_request *request) {
+    if (!request->properties_sent)
+        return;
+
+    const xcb_get_property_cookie_t cookies[] = {
+        request->wm_type_cookie, request->strut_cookie, request->state_cookie,
+        request->utf8_title_cookie, request->title_cookie,
+        request->class_cookie, request->leader_cookie, request->transient_cookie,
+        request->role_cookie, request->startup_id_cookie, request->wm_hints_cookie,
+        request->wm_normal_hints_cookie, request->motif_wm_hints_cookie,
+        request->wm_user_time_cookie, request->wm_desktop_cookie,
+        request->protocols_cookie};
+    for (size_t i = 0; i < sizeof(cookies) / sizeof(cookies[0]); i++)
+        xcb_discard_reply(conn, cookies[i].sequence);
+
+    if (shape_supported)
+        xcb_discard_reply(conn, request->shape_cookie.sequence);
+}
+
+/*
+ * Returns true if the WM_PROTOCOLS reply contains the given protocol atom.
+ *
+ */
+static bool manage_supports_protocol(xcb_get_property_cookie_t cookie, xcb_atom_t atom) {
+    xcb_icccm_get_wm_protocols_reply_t protocols;
+    bool result = false;
+
+    if (xcb_icccm_get_wm_protocols_reply(conn, cookie, &protocols, NULL) != 1)
+        return false;
+
+    for (uint32_t i = 0; i < protocols.atoms_len; i++)
+        if (protocols.atoms[i] == atom)
+            result = true;
 
-    geomc = xcb_get_geometry(conn, d);
+    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+
+    return result;
+}
+
+/*
+ * Waits for the window attributes and decides whether the window is to be
+ * managed. If so, sends the property requests (see manage_send_properties()).
+ * Returns false if the window is not to be managed.
+ *
+ */
+static bool manage_check_attributes(struct manage_request *request) {
+    DLOG("window 0x%08x\n", request->window);
 
     /* Check if the window is mapped (it could be not mapped when intializing and
        calling manage_window() for every window) */
-    if ((attr = xcb_get_window_attributes_reply(conn, cookie, 0)) == NULL) {
+    xcb_get_window_attributes_reply_t *attr;
+    if ((attr = xcb_get_window_attributes_reply(conn, request->attr_cookie, 0)) == NULL) {
         DLOG("Could not get attributes\n");
-        xcb_discard_reply(conn, geomc.sequence);
-        return;
+        xcb_discard_reply(conn, request->geom_cookie.sequence);
+        return false;
     }
 
-    if (needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
-    }
+    if (request->needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE)
+        goto skip;
 
     /* Don’t manage clients with the override_redirect flag */
-    if (attr->override_redirect) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
-    }
+    if (attr->override_redirect)
+        goto skip;
 
     /* Check if the window is already managed */
-    if (con_by_window_id(window) != NULL) {
-        DLOG("already managed (by con %p)\n", con_by_window_id(window));
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+    if (con_by_window_id(request->window) != NULL) {
+        DLOG("already managed (by con %p)\n", con_by_window_id(request->window));
+        goto skip;
     }
 
+    request->attr = attr;
+    manage_send_properties(request);
+    return true;
+
+skip:
+    xcb_discard_reply(conn, request->geom_cookie.sequence);
+    free(attr);
+    return false;
+}
+
+/*
+ * Waits for the replies of one window whose requests were sent by
+ * manage_check_attributes() and puts the window into the tree.
+ *
+ */
+static void manage_window_finish(struct manage_request *request) {
+    const xcb_window_t window = request->window;
+    xcb_get_window_attributes_reply_t *attr = request->attr;
+    xcb_get_geometry_reply_t *geom;
+
     /* Get the initial geometry (position, size, …) */
-    if ((geom = xcb_get_geometry_reply(conn, geomc, 0)) == NULL) {
+    if ((geom = xcb_get_geometry_reply(conn, request->geom_cookie, 0)) == NULL) {
         DLOG("could not get geometry\n");
+        /* The event mask change is checked, so its error would otherwise be
+         * reported as an unexpected one later. */
+        xcb_discard_reply(conn, request->event_mask_cookie.sequence);
+        manage_discard_properties(request);
         goto out;
     }
 
-    uint32_t values[1];
-
-    /* Set a temporary event mask for the new window, consisting only of
-     * PropertyChange and StructureNotify. We need to be notified of
-     * PropertyChanges because the client can change its properties *after* we
-     * requested them but *before* we actually reparented it and have set our
-     * final event mask.
-     * We need StructureNotify because the client may unmap the window before
-     * we get to re-parent it.
-     * If this request fails, we assume the client has already unmapped the
-     * window between the MapRequest and our event mask change. */
-    values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE |
-                XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-    xcb_void_cookie_t event_mask_cookie =
-        xcb_change_window_attributes_checked(conn, window, XCB_CW_EVENT_MASK, values);
-    if (xcb_request_check(conn, event_mask_cookie) != NULL) {
+    /* If changing the event mask failed, we assume the client has already
+     * unmapped the window between the MapRequest and our event mask change.
+     * As the property requests were sent after it, checking does not need
+     * another round trip. */
+    if (xcb_request_check(conn, request->event_mask_cookie) != NULL) {
         LOG("Could not change event mask, the window probably already disappeared.\n");
-        goto out;
+        manage_discard_properties(request);
+        goto geom_out;
     }
 
-#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
-
-    wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
-    strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
-    state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
-    utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
-    leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
-    transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
-    title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
-    class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
-    role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
-    startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
-    wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
-    wm_normal_hints_cookie = xcb_icccm_get_wm_normal_hints(conn, window);
-    motif_wm_hints_cookie = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
-    wm_user_time_cookie = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
-    wm_desktop_cookie = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
+    uint32_t values[1];
 
     i3Window *cwindow = scalloc(1, sizeof(i3Window));
     cwindow->id = window;
     cwindow->depth = get_visual_depth(attr->visual);
 
-    int *buttons = bindings_get_buttons_to_grab();
-    xcb_grab_buttons(conn, window, buttons);
-    FREE(buttons);
+    bindings_update_button_grabs(cwindow);
 
     /* update as much information as possible so far (some replies may be NULL) */
-    window_update_class(cwindow, xcb_get_property_reply(conn, class_cookie, NULL), true);
-    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, title_cookie, NULL), true);
-    window_update_name(cwindow, xcb_get_property_reply(conn, utf8_title_cookie, NULL), true);
-    window_update_leader(cwindow, xcb_get_property_reply(conn, leader_cookie, NULL));
-    window_update_transient_for(cwindow, xcb_get_property_reply(conn, transient_cookie, NULL));
-    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, strut_cookie, NULL));
-    window_update_role(cwindow, xcb_get_property_reply(conn, role_cookie, NULL), true);
+    window_update_class(cwindow, xcb_get_property_reply(conn, request->class_cookie, NULL), true);
+    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, request->title_cookie, NULL), true);
+    window_update_name(cwindow, xcb_get_property_reply(conn, request->utf8_title_cookie, NULL), true);
+    window_update_leader(cwindow, xcb_get_property_reply(conn, request->leader_cookie, NULL));
+    window_update_transient_for(cwindow, xcb_get_property_reply(conn, request->transient_cookie, NULL));
+    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, request->strut_cookie, NULL));
+    window_update_role(cwindow, xcb_get_property_reply(conn, request->role_cookie, NULL), true);
     bool urgency_hint;
-    window_update_hints(cwindow, xcb_get_property_reply(conn, wm_hints_cookie, NULL), &urgency_hint);
+    window_update_hints(cwindow, xcb_get_property_reply(conn, request->wm_hints_cookie, NULL), &urgency_hint);
     border_style_t motif_border_style = BS_NORMAL;
-    window_update_motif_hints(cwindow, xcb_get_property_reply(conn, motif_wm_hints_cookie, NULL), &motif_border_style);
-    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, wm_normal_hints_cookie, NULL), geom);
-    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, wm_type_cookie, NULL);
-    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, state_cookie, NULL);
+    window_update_motif_hints(cwindow, xcb_get_property_reply(conn, request->motif_wm_hints_cookie, NULL), &motif_border_style);
+    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, request->wm_normal_hints_cookie, NULL), geom);
+    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, request->wm_type_cookie, NULL);
+    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, request->state_cookie, NULL);
 
     xcb_get_property_reply_t *startup_id_reply;
-    startup_id_reply = xcb_get_property_reply(conn, startup_id_cookie, NULL);
+    startup_id_reply = xcb_get_property_reply(conn, request->startup_id_cookie, NULL);
     char *startup_ws = startup_workspace_for_window(cwindow, startup_id_reply);
     DLOG("startup workspace = %s\n", startup_ws);
 
     /* Get _NET_WM_DESKTOP if it was set. */
     xcb_get_property_reply_t *wm_desktop_reply;
-    wm_desktop_reply = xcb_get_property_reply(conn, wm_desktop_cookie, NULL);
+    wm_desktop_reply = xcb_get_property_reply(conn, request->wm_desktop_cookie, NULL);
     cwindow->wm_desktop = NET_WM_DESKTOP_NONE;
     if (wm_desktop_reply != NULL && xcb_get_property_value_length(wm_desktop_reply) != 0) {
         uint32_t *wm_desktops = xcb_get_property_value(wm_desktop_reply);
@@ -205,7 +320,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     FREE(wm_desktop_reply);
 
     /* check if the window needs WM_TAKE_FOCUS */
-    cwindow->needs_take_focus = window_supports_protocol(cwindow->id, A_WM_TAKE_FOCUS);
+    cwindow->needs_take_focus = manage_supports_protocol(request->protocols_cookie, A_WM_TAKE_FOCUS);
 
     /* read the preferred _NET_WM_WINDOW_TYPE atom */
     cwindow->window_type = xcb_get_preferred_window_type(type_reply);
@@ -362,6 +477,9 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
     nc->window = cwindow;
     x_reinit(nc);
+    /* A swallowing placeholder is already attached, so nothing marked its
+     * (possibly invisible) workspace for the next render yet. */
+    con_mark_dirty(nc);
 
     nc->border_width = geom->border_width;
 
@@ -535,6 +653,9 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     xcb_void_cookie_t rcookie = xcb_reparent_window_checked(conn, window, nc->frame.id, 0, 0);
     if (xcb_request_check(conn, rcookie) != NULL) {
         LOG("Could not reparent the window, aborting\n");
+        if (shape_supported)
+            xcb_discard_reply(conn, request->shape_cookie.sequence);
+        xcb_discard_reply(conn, request->wm_user_time_cookie.sequence);
         goto geom_out;
     }
 
@@ -549,16 +670,8 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     xcb_change_save_set(conn, XCB_SET_MODE_INSERT, window);
 
     if (shape_supported) {
-        /* Receive ShapeNotify events whenever the client altered its window
-         * shape. */
-        xcb_shape_select_input(conn, window, true);
-
-        /* Check if the window is shaped. Sadly, we can check only for the
-         * bounding shape, not for the input shape. */
-        xcb_shape_query_extents_cookie_t cookie =
-            xcb_shape_query_extents(conn, window);
         xcb_shape_query_extents_reply_t *reply =
-            xcb_shape_query_extents_reply(conn, cookie, NULL);
+            xcb_shape_query_extents_reply(conn, request->shape_cookie, NULL);
         if (reply != NULL && reply->bounding_shaped) {
             cwindow->shaped = true;
         }
@@ -566,7 +679,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
 
     /* Check if any assignments match */
-    run_assignments(cwindow);
+    run_assignments(cwindow, AF_ALL);
 
     /* 'ws' may be invalid because of the assignments, e.g. when the user uses
      * "move window to workspace 1", but had it assigned to workspace 2. */
@@ -613,7 +726,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         DLOG("Checking con = %p for _NET_WM_USER_TIME.\n", nc);
 
         uint32_t *wm_user_time;
-        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, wm_user_time_cookie, NULL);
+        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, request->wm_user_time_cookie, NULL);
         if (wm_user_time_reply != NULL && xcb_get_property_value_length(wm_user_time_reply) != 0 &&
             (wm_user_time = xcb_get_property_value(wm_user_time_reply)) &&
             wm_user_time[0] == 0) {
@@ -623,7 +736,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
         FREE(wm_user_time_reply);
     } else {
-        xcb_discard_reply(conn, wm_user_time_cookie.sequence);
+        xcb_discard_reply(conn, request->wm_user_time_cookie.sequence);
     }
 
     if (set_focus) {
@@ -670,3 +783,39 @@ geom_out:
 out:
     free(attr);
 }
+
+/*
+ * Manages the given windows. All requests are sent before waiting for any
+ * reply: first the geometry of every window, then (once the attributes tell
+ * which windows are to be managed) the event masks and properties. Only then
+ * are the windows put into the tree one after the other.
+ *
+ */
+static void manage_windows(struct manage_request *requests, int num) {
+    for (int i = 0; i < num; i++)
+        requests[i].geom_cookie = xcb_get_geometry(conn, requests[i].window);
+
+    bool *manage = smalloc(num * sizeof(bool));
+    for (int i = 0; i < num; i++)
+        manage[i] = manage_check_attributes(&(requests[i]));
+
+    for (int i = 0; i < num; i++) {
+        if (manage[i])
+            manage_window_finish(&(requests[i]));
+    }
+    free(manage);
+}
+
+/*
+ * Do some sanity checks and then reparent the window.
+ *
+ */
+void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cookie,
+                   bool needs_to_be_mapped) {
+    struct manage_request request = {
+        .window = window,
+        .needs_to_be_mapped = needs_to_be_mapped,
+        .attr_cookie = cookie,
+    };
+    manage_windows(&request, 1);
+}
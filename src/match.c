@@ -17,6 +17,70 @@
 #define _i3_timercmp(a, b, CMP) \
     (((a).tv_sec == (b).tv_sec) ? ((a).tv_usec CMP(b).tv_usec) : ((a).tv_sec CMP(b).tv_sec))
 
+/* The class, instance, title and window_role patterns of all assignments and
+ * swallow criteria, one regex_set per window property. Checking all of them
+ * against a window thus takes one pass over each property. The sets are
+ * rebuilt lazily after match_invalidate_sets(). */
+static struct regex_set *class_set;
+static struct regex_set *instance_set;
+static struct regex_set *title_set;
+static struct regex_set *role_set;
+static bool sets_valid = false;
+
+/*
+ * Adds the patterns of the given match to the regex sets.
+ *
+ */
+static void match_add_to_sets(Match *match) {
+    regex_set_add(class_set, match->class);
+    regex_set_add(instance_set, match->instance);
+    regex_set_add(title_set, match->title);
+    regex_set_add(role_set, match->window_role);
+}
+
+/*
+ * Rebuilds the regex sets if they are outdated.
+ *
+ */
+static void match_update_sets(void) {
+    if (sets_valid)
+        return;
+
+    regex_set_free(class_set);
+    regex_set_free(instance_set);
+    regex_set_free(title_set);
+    regex_set_free(role_set);
+    class_set = regex_set_new();
+    instance_set = regex_set_new();
+    title_set = regex_set_new();
+    role_set = regex_set_new();
+
+    Assignment *assignment;
+    TAILQ_FOREACH(assignment, &assignments, assignments) {
+        match_add_to_sets(&(assignment->match));
+    }
+
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        Match *match;
+        TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+            match_add_to_sets(match);
+        }
+    }
+
+    sets_valid = true;
+}
+
+/*
+ * Marks the regex sets of the assignment and swallow criteria as outdated.
+ * Needs to be called after adding assignments or swallow criteria (removing
+ * them is fine, see regex_free()).
+ *
+ */
+void match_invalidate_sets(void) {
+    sets_valid = false;
+}
+
 /*
  * Initializes the Match data structure. This function is necessary because the
  * members representing boolean values (like dock) need to be initialized with
@@ -87,6 +151,8 @@ void match_copy(Match *dest, Match *src) {
 bool match_matches_window(Match *match, i3Window *window) {
     LOG("Checking window 0x%08x (class %s)\n", window->id, window->class_class);
 
+    match_update_sets();
+
 #define GET_FIELD_str(field) (field)
 #define GET_FIELD_i3string(field) (i3string_as_utf8(field))
 #define CHECK_WINDOW_FIELD(match_field, window_field, type)                                       \
@@ -97,7 +163,7 @@ bool match_matches_window(Match *match, i3Window *window) {
             }                                                                                     \
                                                                                                   \
             const char *window_field_str = GET_FIELD_##type(window->window_field);                \
-            if (strcmp(match->match_field->pattern, "__focused__") == 0 &&                        \
+            if (match->match_field->focused &&                                                    \
                 focused && focused->window && focused->window->window_field &&                    \
                 strcmp(window_field_str, GET_FIELD_##type(focused->window->window_field)) == 0) { \
                 LOG("window " #match_field " matches focused window\n");                          \
@@ -172,7 +238,7 @@ bool match_matches_window(Match *match, i3Window *window) {
         if (ws == NULL)
             return false;
 
-        if (strcmp(match->workspace->pattern, "__focused__") == 0 &&
+        if (match->workspace->focused &&
             strcmp(ws->name, con_get_workspace(focused)->name) == 0) {
             LOG("workspace matches focused workspace\n");
         } else if (regex_matches(match->workspace, ws->name)) {
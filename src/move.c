@@ -160,6 +160,7 @@ void insert_con_into(Con *con, Con *target, position_t position) {
     } else if (position == AFTER) {
         TAILQ_INSERT_AFTER(&(parent->nodes_head), target, con, nodes);
     }
+    con_mark_dirty(con);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -235,7 +236,7 @@ static void move_to_output_directed(Con *con, direction_t direction) {
     }
 
     /* force re-painting the indicators */
-    FREE(con->deco_render_params);
+    x_invalidate_decoration(con);
 
     tree_flatten(croot);
     ipc_send_window_event("move", con);
@@ -321,6 +322,7 @@ void tree_move(Con *con, int direction) {
                 } else {
                     TAILQ_SWAP(con, swap, &(swap->parent->nodes_head), nodes);
                 }
+                con_mark_dirty(con);
 
                 ipc_send_window_event("move", con);
                 return;
@@ -383,7 +385,7 @@ void tree_move(Con *con, int direction) {
 
 end:
     /* force re-painting the indicators */
-    FREE(con->deco_render_params);
+    x_invalidate_decoration(con);
 
     tree_flatten(croot);
     ipc_send_window_event("move", con);
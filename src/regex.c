@@ -9,6 +9,133 @@
  */
 #include "all.h"
 
+/* A regex_set matches all of its members against an input in one pass: the
+ * literals of the members (see regex_find_literal()) are compiled into an
+ * Aho-Corasick automaton, which finds all literal occurrences at once. Only
+ * members whose literal occurs and does not decide the match on its own (or
+ * which have no literal at all) are then run through PCRE. */
+struct regex_set_state {
+    /* Transitions of this state, as a list in edges. */
+    int first_edge;
+    /* The state of the longest proper suffix which is also in the trie. */
+    int fail;
+    /* The nearest state on the fail chain (including this one) in which a
+     * literal ends, or -1. */
+    int output;
+    /* The first member whose literal ends in this state, chained via
+     * next_member, or -1. */
+    int first_member;
+};
+
+struct regex_set_edge {
+    unsigned char byte;
+    int target;
+    int next;
+};
+
+struct regex_set {
+    /* Freed members are set to NULL, see regex_free(). */
+    struct regex **members;
+    int num_members;
+
+    bool compiled;
+    struct regex_set_state *states;
+    int num_states;
+    struct regex_set_edge *edges;
+    int num_edges;
+    int *next_member;
+
+    /* The input of the last evaluation and its results, as bitsets indexed by
+     * member, see regex_set_evaluate(). */
+    char *last_input;
+    uint32_t *hits;
+    uint32_t *matches;
+};
+
+#define BIT_SET(bitset, index) ((bitset)[(index) / 32] |= (UINT32_C(1) << ((index) % 32)))
+#define BIT_IS_SET(bitset, index) (((bitset)[(index) / 32] & (UINT32_C(1) << ((index) % 32))) != 0)
+
+/*
+ * Finds the literal text at the start of the pattern (if any), which lets
+ * regex_matches() decide most matches with a string comparison. Patterns such
+ * as "^Firefox$" (exact), "^Firefox" (prefix) or "Firefox" (substring) are
+ * decided entirely by the literal test; for others like "^Fire.*fox" it is a
+ * necessary condition which is checked before running PCRE.
+ *
+ */
+static void regex_find_literal(struct regex *re) {
+    const char *pattern = re->pattern;
+
+    /* With alternatives, no single literal is required. */
+    if (strchr(pattern, '|') != NULL)
+        return;
+
+    const bool anchored = (pattern[0] == '^');
+    if (anchored)
+        pattern++;
+
+    size_t len = strcspn(pattern, "\\^$.[]()?*+{}");
+    const char *rest = pattern + len;
+    bool complete = (*rest == '\0');
+    bool exact = false;
+    if (rest[0] == '$' && rest[1] == '\0') {
+        exact = anchored;
+        complete = anchored;
+    } else if (*rest != '\0' && strchr("?*+{", *rest) != NULL) {
+        /* The quantifier applies to the last (possibly multi-byte) character,
+         * which therefore is not required. */
+        while (len > 0 && (pattern[len - 1] & 0xC0) == 0x80)
+            len--;
+        if (len > 0)
+            len--;
+    }
+
+    if (len == 0 && !complete)
+        return;
+
+    re->literal = smalloc(len + 1);
+    memcpy(re->literal, pattern, len);
+    re->literal[len] = '\0';
+    re->literal_len = len;
+    re->literal_complete = complete;
+    if (exact)
+        re->literal_type = RL_EXACT;
+    else if (anchored)
+        re->literal_type = RL_PREFIX;
+    else
+        re->literal_type = RL_CONTAINS;
+}
+
+/*
+ * Checks the input against the literal of the regex (see
+ * regex_find_literal()). Returns true if that decides whether the regex
+ * matches, in which case the result is stored in *matches.
+ *
+ */
+static bool regex_literal_decides(struct regex *regex, const char *input, size_t length, bool *matches) {
+    const char *literal = regex->literal;
+    const size_t literal_len = regex->literal_len;
+
+    switch (regex->literal_type) {
+        case RL_NONE:
+            return false;
+        case RL_CONTAINS:
+            *matches = (strstr(input, literal) != NULL);
+            break;
+        case RL_PREFIX:
+            *matches = (length >= literal_len && memcmp(input, literal, literal_len) == 0);
+            break;
+        case RL_EXACT:
+            /* Like PCRE, let $ match before a trailing newline, too. */
+            *matches = ((length == literal_len ||
+                         (length == literal_len + 1 && input[literal_len] == '\n')) &&
+                        memcmp(input, literal, literal_len) == 0);
+            break;
+    }
+
+    return (regex->literal_complete || !*matches);
+}
+
 /*
  * Creates a new 'regex' struct containing the given pattern and a PCRE
  * compiled regular expression. Also, calls pcre_study because this regex will
@@ -48,6 +175,8 @@ struct regex *regex_new(const char *pattern) {
     if (error) {
         ELOG("PCRE regular expression studying failed: %s\n", error);
     }
+    regex_find_literal(re);
+    re->focused = (strcmp(pattern, "__focused__") == 0);
     return re;
 }
 
@@ -58,36 +187,280 @@ struct regex *regex_new(const char *pattern) {
 void regex_free(struct regex *regex) {
     if (!regex)
         return;
+    if (regex->set != NULL)
+        regex->set->members[regex->set_index] = NULL;
     FREE(regex->pattern);
+    FREE(regex->literal);
     FREE(regex->regex);
     FREE(regex->extra);
     FREE(regex);
 }
 
+/*
+ * Runs PCRE on the given input. Logs errors, but not the outcome.
+ *
+ */
+static bool regex_exec(struct regex *regex, const char *input, size_t length) {
+    int rc = pcre_exec(regex->regex, regex->extra, input, length, 0, 0, NULL, 0);
+    if (rc == 0)
+        return true;
+
+    if (rc != PCRE_ERROR_NOMATCH) {
+        ELOG("PCRE error %d while trying to use regular expression \"%s\" on input \"%s\", see pcreapi(3)\n",
+             rc, regex->pattern, input);
+    }
+    return false;
+}
+
+/*
+ * Creates a new, empty regex set. See regex_set_add().
+ *
+ */
+struct regex_set *regex_set_new(void) {
+    return scalloc(1, sizeof(struct regex_set));
+}
+
+/*
+ * Adds the given regex to the set, unless it already belongs to a set. From
+ * then on, regex_matches() on it evaluates all members of the set at once and
+ * caches the result for the input.
+ *
+ */
+void regex_set_add(struct regex_set *set, struct regex *regex) {
+    if (regex == NULL || regex->set != NULL)
+        return;
+
+    set->members = srealloc(set->members, sizeof(struct regex *) * (set->num_members + 1));
+    set->members[set->num_members] = regex;
+    regex->set = set;
+    regex->set_index = set->num_members++;
+    set->compiled = false;
+}
+
+/*
+ * Frees the given regex set. Its members are not freed, but removed from the
+ * set.
+ *
+ */
+void regex_set_free(struct regex_set *set) {
+    if (set == NULL)
+        return;
+
+    for (int i = 0; i < set->num_members; i++) {
+        if (set->members[i] != NULL)
+            set->members[i]->set = NULL;
+    }
+    FREE(set->members);
+    FREE(set->states);
+    FREE(set->edges);
+    FREE(set->next_member);
+    FREE(set->last_input);
+    FREE(set->hits);
+    FREE(set->matches);
+    FREE(set);
+}
+
+/*
+ * Returns true if the literal of the given member is part of the automaton.
+ *
+ */
+static bool regex_set_uses_literal(struct regex *member) {
+    return (member->literal_type != RL_NONE && member->literal_len > 0);
+}
+
+/*
+ * Returns the state reached from the given state with the given byte, or -1
+ * if there is no such transition.
+ *
+ */
+static int regex_set_next_state(struct regex_set *set, int state, unsigned char byte) {
+    for (int e = set->states[state].first_edge; e != -1; e = set->edges[e].next) {
+        if (set->edges[e].byte == byte)
+            return set->edges[e].target;
+    }
+    return -1;
+}
+
+/*
+ * Adds a transition (and the state it leads to) to the automaton. Returns
+ * the new state.
+ *
+ */
+static int regex_set_add_state(struct regex_set *set, int from, unsigned char byte) {
+    const int state = set->num_states++;
+    set->states = srealloc(set->states, sizeof(struct regex_set_state) * set->num_states);
+    set->states[state] = (struct regex_set_state){
+        .first_edge = -1,
+        .fail = 0,
+        .output = -1,
+        .first_member = -1};
+
+    if (from != -1) {
+        const int edge = set->num_edges++;
+        set->edges = srealloc(set->edges, sizeof(struct regex_set_edge) * set->num_edges);
+        set->edges[edge] = (struct regex_set_edge){
+            .byte = byte,
+            .target = state,
+            .next = set->states[from].first_edge};
+        set->states[from].first_edge = edge;
+    }
+    return state;
+}
+
+/*
+ * Builds the Aho-Corasick automaton from the literals of all members.
+ *
+ */
+static void regex_set_compile(struct regex_set *set) {
+    FREE(set->states);
+    FREE(set->edges);
+    set->num_states = 0;
+    set->num_edges = 0;
+    set->next_member = srealloc(set->next_member, sizeof(int) * set->num_members);
+
+    /* Build the trie of all literals. */
+    regex_set_add_state(set, -1, 0);
+    for (int i = 0; i < set->num_members; i++) {
+        struct regex *member = set->members[i];
+        set->next_member[i] = -1;
+        if (member == NULL || !regex_set_uses_literal(member))
+            continue;
+
+        int state = 0;
+        for (size_t c = 0; c < member->literal_len; c++) {
+            const unsigned char byte = member->literal[c];
+            int next = regex_set_next_state(set, state, byte);
+            if (next == -1)
+                next = regex_set_add_state(set, state, byte);
+            state = next;
+        }
+        set->next_member[i] = set->states[state].first_member;
+        set->states[state].first_member = i;
+    }
+
+    /* Compute the fail and output links in breadth-first order, so that the
+     * links of all shallower states are known already. */
+    int *queue = smalloc(sizeof(int) * set->num_states);
+    int head = 0, tail = 0;
+    queue[tail++] = 0;
+    while (head < tail) {
+        const int state = queue[head++];
+        for (int e = set->states[state].first_edge; e != -1; e = set->edges[e].next) {
+            const unsigned char byte = set->edges[e].byte;
+            const int child = set->edges[e].target;
+            queue[tail++] = child;
+
+            int fail = 0;
+            if (state != 0) {
+                int f = set->states[state].fail;
+                while (f != 0 && regex_set_next_state(set, f, byte) == -1)
+                    f = set->states[f].fail;
+                const int next = regex_set_next_state(set, f, byte);
+                if (next != -1)
+                    fail = next;
+            }
+            set->states[child].fail = fail;
+            set->states[child].output = (set->states[child].first_member != -1 ? child : set->states[fail].output);
+        }
+    }
+    free(queue);
+
+    const size_t words = (set->num_members + 31) / 32;
+    set->hits = srealloc(set->hits, sizeof(uint32_t) * words);
+    set->matches = srealloc(set->matches, sizeof(uint32_t) * words);
+    FREE(set->last_input);
+    set->compiled = true;
+
+    DLOG("Compiled regex set of %d patterns into %d states\n", set->num_members, set->num_states);
+}
+
+/*
+ * Matches all members of the set against the given input, storing the
+ * results in set->matches. The results are cached until the input changes.
+ *
+ */
+static void regex_set_evaluate(struct regex_set *set, const char *input) {
+    if (!set->compiled)
+        regex_set_compile(set);
+    else if (set->last_input != NULL && strcmp(set->last_input, input) == 0)
+        return;
+
+    FREE(set->last_input);
+    set->last_input = sstrdup(input);
+
+    const size_t words = (set->num_members + 31) / 32;
+    memset(set->hits, 0, sizeof(uint32_t) * words);
+    memset(set->matches, 0, sizeof(uint32_t) * words);
+
+    /* One pass over the input finds all literal occurrences. Prefix and exact
+     * literals only count at the start of the input. */
+    const size_t length = strlen(input);
+    int state = 0;
+    for (size_t i = 0; i < length; i++) {
+        const unsigned char byte = input[i];
+        int next;
+        while ((next = regex_set_next_state(set, state, byte)) == -1 && state != 0)
+            state = set->states[state].fail;
+        state = (next == -1 ? 0 : next);
+
+        for (int out = set->states[state].output; out != -1; out = set->states[set->states[out].fail].output) {
+            for (int m = set->states[out].first_member; m != -1; m = set->next_member[m]) {
+                struct regex *member = set->members[m];
+                if (member != NULL && (member->literal_type == RL_CONTAINS || i + 1 == member->literal_len))
+                    BIT_SET(set->hits, m);
+            }
+        }
+    }
+
+    for (int m = 0; m < set->num_members; m++) {
+        struct regex *member = set->members[m];
+        if (member == NULL)
+            continue;
+
+        bool matches;
+        if (!regex_set_uses_literal(member)) {
+            if (!regex_literal_decides(member, input, length, &matches))
+                matches = regex_exec(member, input, length);
+        } else if (!BIT_IS_SET(set->hits, m)) {
+            matches = false;
+        } else if (member->literal_type == RL_EXACT) {
+            /* Like PCRE, let $ match before a trailing newline, too. */
+            matches = (length == member->literal_len ||
+                       (length == member->literal_len + 1 && input[member->literal_len] == '\n'));
+        } else if (member->literal_complete) {
+            matches = true;
+        } else {
+            matches = regex_exec(member, input, length);
+        }
+
+        if (matches)
+            BIT_SET(set->matches, m);
+    }
+}
+
 /*
  * Checks if the given regular expression matches the given input and returns
  * true if it does. In either case, it logs the outcome using LOG(), so it will
  * be visible without debug logging.
  *
+ * If the regex belongs to a regex_set, all members of the set are matched at
+ * once, so that checking the others against the same input is a lookup.
+ *
  */
 bool regex_matches(struct regex *regex, const char *input) {
-    int rc;
-
-    /* We use strlen() because pcre_exec() expects the length of the input
-     * string in bytes */
-    if ((rc = pcre_exec(regex->regex, regex->extra, input, strlen(input), 0, 0, NULL, 0)) == 0) {
-        LOG("Regular expression \"%s\" matches \"%s\"\n",
-            regex->pattern, input);
-        return true;
+    bool matches;
+    if (regex->set != NULL) {
+        regex_set_evaluate(regex->set, input);
+        matches = BIT_IS_SET(regex->set->matches, regex->set_index);
+    } else {
+        /* We use strlen() because pcre_exec() expects the length of the input
+         * string in bytes */
+        const size_t length = strlen(input);
+        if (!regex_literal_decides(regex, input, length, &matches))
+            matches = regex_exec(regex, input, length);
     }
 
-    if (rc == PCRE_ERROR_NOMATCH) {
-        LOG("Regular expression \"%s\" does not match \"%s\"\n",
-            regex->pattern, input);
-        return false;
-    }
-
-    ELOG("PCRE error %d while trying to use regular expression \"%s\" on input \"%s\", see pcreapi(3)\n",
-         rc, regex->pattern, input);
-    return false;
+    LOG("Regular expression \"%s\" %s \"%s\"\n",
+        regex->pattern, (matches ? "matches" : "does not match"), input);
+    return matches;
 }
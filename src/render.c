@@ -8,6 +8,7 @@
  *           various rects. Needs to be pushed to X11 (see x.c) to be visible.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_RENDER
 #include "all.h"
 
 /* Forward declarations */
@@ -46,6 +47,7 @@ void render_con(Con *con, bool already_inset) {
         .y = con->rect.y,
         .children = con_num_children(con)};
 
+    render_stats.last_nodes_rendered++;
     DLOG("Rendering node %p / %s / layout %d / children %d\n", con, con->name,
          con->layout, params.children);
 
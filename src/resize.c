@@ -7,6 +7,7 @@
  * resize.c: Interactive resizing.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_FLOATING
 #include "all.h"
 
 /*
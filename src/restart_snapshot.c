@@ -0,0 +1,596 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * restart_snapshot.c: Compact binary snapshot of the tree, used instead of the
+ *                     JSON layout for inplace restarts.
+ *
+ * The snapshot contains exactly the information that dump_node() generates
+ * with inplace_restart = true and that tree_append_json() uses, but as a
+ * pre-order stream of fixed-size fields and length-prefixed strings which can
+ * be generated and loaded without formatting, tokenizing or key comparisons.
+ * It is only ever read by the i3 process which replaces the writer via exec(),
+ * so all values are stored in native byte order. Snapshots with a different
+ * version or corrupt contents are rejected and i3 falls back to the JSON
+ * layout, which is always stored as well (see store_restart_layout()).
+ *
+ */
+#include "all.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+static const char snapshot_magic[8] = {'i', '3', '-', 's', 'n', 'a', 'p', '\n'};
+
+/* Increment whenever the format changes. */
+#define SNAPSHOT_VERSION 1
+
+/* Marks a NULL string (as opposed to an empty one). */
+#define SNAPSHOT_NULL_STRING UINT32_MAX
+
+#define SNAPSHOT_FOCUSED (1 << 0)
+#define SNAPSHOT_STICKY (1 << 1)
+#define SNAPSHOT_HAS_DEPTH (1 << 2)
+
+#define SNAPSHOT_FD_PREFIX "/proc/self/fd/"
+
+struct snapshot_buffer {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+/* Like struct snapshot_buffer, but for reading: every read past end sets
+ * error and returns zeroes instead. */
+struct snapshot_reader {
+    const char *pos;
+    const char *end;
+    bool error;
+};
+
+/* The fixed part of a container record, with the strings pointing into the
+ * snapshot and the lists of marks and swallows to be read later. */
+struct snapshot_con {
+    uint8_t type;
+    uint8_t layout;
+    uint8_t workspace_layout;
+    uint8_t last_split_layout;
+    uint8_t border_style;
+    uint8_t scratchpad_state;
+    uint8_t floating;
+    uint8_t fullscreen_mode;
+    uint8_t flags;
+    int32_t current_border_width;
+    int32_t num;
+    int32_t depth;
+    double percent;
+    Rect rect;
+    Rect window_rect;
+    Rect geometry;
+    gaps_t gaps;
+    const char *name;
+    const char *title_format;
+    uint32_t num_marks;
+    struct snapshot_reader marks;
+    uint32_t num_swallows;
+    struct snapshot_reader swallows;
+};
+
+static void put(struct snapshot_buffer *buffer, const void *data, size_t len) {
+    if (buffer->len + len > buffer->size) {
+        buffer->size = max(buffer->size * 2, buffer->len + len);
+        buffer->data = srealloc(buffer->data, buffer->size);
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+}
+
+static void put_u8(struct snapshot_buffer *buffer, uint8_t value) {
+    put(buffer, &value, sizeof(value));
+}
+
+static void put_u32(struct snapshot_buffer *buffer, uint32_t value) {
+    put(buffer, &value, sizeof(value));
+}
+
+static void put_i32(struct snapshot_buffer *buffer, int32_t value) {
+    put(buffer, &value, sizeof(value));
+}
+
+/*
+ * Stores a string including its terminating NUL byte, so that the loader can
+ * use it without copying.
+ *
+ */
+static void put_string(struct snapshot_buffer *buffer, const char *str) {
+    if (str == NULL) {
+        put_u32(buffer, SNAPSHOT_NULL_STRING);
+        return;
+    }
+    const size_t len = strlen(str);
+    put_u32(buffer, len);
+    put(buffer, str, len + 1);
+}
+
+static void put_con(struct snapshot_buffer *buffer, Con *con) {
+    put_u8(buffer, con->type);
+    put_u8(buffer, con->layout);
+    put_u8(buffer, con->workspace_layout);
+    /* Like dump_node(), which derives it from the layout. */
+    put_u8(buffer, (con->layout == L_SPLITV ? L_SPLITV : L_SPLITH));
+    put_u8(buffer, con->border_style);
+    put_u8(buffer, con->scratchpad_state);
+    put_u8(buffer, con->floating);
+    put_u8(buffer, con->fullscreen_mode);
+    put_u8(buffer, (con == focused ? SNAPSHOT_FOCUSED : 0) |
+                       (con->sticky ? SNAPSHOT_STICKY : 0) |
+                       (con->window != NULL ? SNAPSHOT_HAS_DEPTH : 0));
+    put_i32(buffer, con->current_border_width);
+    put_i32(buffer, con->num);
+    put_i32(buffer, con->depth);
+    put(buffer, &(con->percent), sizeof(con->percent));
+    put(buffer, &(con->rect), sizeof(Rect));
+    put(buffer, &(con->window_rect), sizeof(Rect));
+    put(buffer, &(con->geometry), sizeof(Rect));
+    put_i32(buffer, con->gaps.inner);
+    put_i32(buffer, con->gaps.top);
+    put_i32(buffer, con->gaps.right);
+    put_i32(buffer, con->gaps.bottom);
+    put_i32(buffer, con->gaps.left);
+
+    if (con->window && con->window->name)
+        put_string(buffer, i3string_as_utf8(con->window->name));
+    else
+        put_string(buffer, con->name);
+    put_string(buffer, con->title_format);
+
+    uint32_t num_marks = 0;
+    mark_t *mark;
+    TAILQ_FOREACH(mark, &(con->marks_head), marks) {
+        num_marks++;
+    }
+    put_u32(buffer, num_marks);
+    TAILQ_FOREACH(mark, &(con->marks_head), marks) {
+        put_string(buffer, mark->name);
+    }
+
+    /* As in dump_node(), the restart_mode match of the window replaces the
+     * one from the previous restart. */
+    uint32_t num_swallows = (con->window != NULL ? 1 : 0);
+    Match *match;
+    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+        if (!match->restart_mode)
+            num_swallows++;
+    }
+    put_u32(buffer, num_swallows);
+    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+        if (match->restart_mode)
+            continue;
+        put_i32(buffer, match->dock);
+        put_i32(buffer, (match->dock != M_DONTCHECK ? match->insert_where : M_HERE));
+        put_u32(buffer, XCB_NONE);
+        put_u8(buffer, false);
+        put_string(buffer, (match->class ? match->class->pattern : NULL));
+        put_string(buffer, (match->instance ? match->instance->pattern : NULL));
+        put_string(buffer, (match->window_role ? match->window_role->pattern : NULL));
+        put_string(buffer, (match->title ? match->title->pattern : NULL));
+    }
+    if (con->window != NULL) {
+        put_i32(buffer, M_DONTCHECK);
+        put_i32(buffer, M_HERE);
+        put_u32(buffer, con->window->id);
+        put_u8(buffer, true);
+        for (int i = 0; i < 4; i++)
+            put_string(buffer, NULL);
+    }
+
+    /* The focus order is stored as indexes into the children (tiling first,
+     * then floating). old_id is only used while loading layouts, so it can
+     * hold the index of each child in the meantime. */
+    uint32_t num_children = 0;
+    Con *child;
+    const bool skip_nodes = (con->type == CT_DOCKAREA);
+    put_u32(buffer, 0);
+    const size_t num_nodes_offset = buffer->len - sizeof(uint32_t);
+    if (!skip_nodes) {
+        TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+            child->old_id = num_children++;
+            put_con(buffer, child);
+        }
+    }
+    memcpy(buffer->data + num_nodes_offset, &num_children, sizeof(uint32_t));
+
+    const uint32_t num_tiling = num_children;
+    put_u32(buffer, 0);
+    const size_t num_floating_offset = buffer->len - sizeof(uint32_t);
+    TAILQ_FOREACH(child, &(con->floating_head), floating_windows) {
+        child->old_id = num_children++;
+        put_con(buffer, child);
+    }
+    const uint32_t num_floating = num_children - num_tiling;
+    memcpy(buffer->data + num_floating_offset, &num_floating, sizeof(uint32_t));
+
+    put_u32(buffer, (skip_nodes ? 0 : num_children));
+    if (!skip_nodes) {
+        TAILQ_FOREACH(child, &(con->focus_head), focused) {
+            put_u32(buffer, child->old_id);
+        }
+    }
+}
+
+/*
+ * Serializes the whole tree (like dump_node() with inplace_restart = true
+ * does) into a newly allocated buffer. The length of the snapshot is stored
+ * in *length.
+ *
+ */
+char *restart_snapshot_generate(size_t *length) {
+    struct snapshot_buffer buffer = {
+        .data = NULL,
+        .len = 0,
+        .size = 0,
+    };
+
+    put(&buffer, snapshot_magic, sizeof(snapshot_magic));
+    put_u32(&buffer, SNAPSHOT_VERSION);
+    put_string(&buffer, previous_workspace_name);
+    put_con(&buffer, croot);
+
+    *length = buffer.len;
+    return buffer.data;
+}
+
+/*
+ * Stores the given snapshot in an anonymous in-memory file which is inherited
+ * by the restarted i3. Returns the path to pass in I3_RESTART_SNAPSHOT or NULL
+ * if no such file could be created (e.g. memfd_create() is not available), in
+ * which case only the JSON layout is restored.
+ *
+ */
+char *restart_snapshot_store(const char *snapshot, size_t length) {
+#if defined(HAVE_MEMFD_CREATE)
+    /* No MFD_CLOEXEC: the file descriptor needs to survive the exec(). The
+     * restarted i3 closes it after loading, i3_restart() if the exec fails. */
+    int fd = memfd_create("i3-restart-state", 0);
+    if (fd == -1) {
+        ELOG("Could not create the restart snapshot file: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    if (writeall(fd, snapshot, length) == -1) {
+        ELOG("Could not write the restart snapshot: %s\n", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    /* The restarted i3 opens the file via /proc, which creates a new open file
+     * description starting at offset 0. */
+    char *path;
+    sasprintf(&path, SNAPSHOT_FD_PREFIX "%d", fd);
+    DLOG("Stored the restart snapshot (%zu bytes) in %s\n", length, path);
+    return path;
+#else
+    return NULL;
+#endif
+}
+
+/*
+ * Returns the file descriptor of a path returned by restart_snapshot_store(),
+ * or -1 if path refers to a regular file.
+ *
+ */
+int restart_snapshot_inherited_fd(const char *path) {
+    if (strncmp(path, SNAPSHOT_FD_PREFIX, strlen(SNAPSHOT_FD_PREFIX)) != 0)
+        return -1;
+
+    char *end;
+    errno = 0;
+    const long fd = strtol(path + strlen(SNAPSHOT_FD_PREFIX), &end, 10);
+    if (errno != 0 || *end != '\0' || end == path + strlen(SNAPSHOT_FD_PREFIX) ||
+        fd < 0 || fd > INT_MAX)
+        return -1;
+    return fd;
+}
+
+/*
+ * Returns true if buf starts with the header of a snapshot, in which case it
+ * should be loaded with restart_snapshot_load() instead of as JSON.
+ *
+ */
+bool restart_snapshot_detect(const char *buf, size_t len) {
+    return (len >= sizeof(snapshot_magic) &&
+            memcmp(buf, snapshot_magic, sizeof(snapshot_magic)) == 0);
+}
+
+static const void *get(struct snapshot_reader *reader, size_t len) {
+    if (reader->error || (size_t)(reader->end - reader->pos) < len) {
+        reader->error = true;
+        return NULL;
+    }
+    const void *data = reader->pos;
+    reader->pos += len;
+    return data;
+}
+
+static uint8_t get_u8(struct snapshot_reader *reader) {
+    const uint8_t *data = get(reader, sizeof(uint8_t));
+    return (data ? *data : 0);
+}
+
+static uint32_t get_u32(struct snapshot_reader *reader) {
+    uint32_t value = 0;
+    const void *data = get(reader, sizeof(value));
+    if (data)
+        memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static int32_t get_i32(struct snapshot_reader *reader) {
+    return (int32_t)get_u32(reader);
+}
+
+static void get_raw(struct snapshot_reader *reader, void *value, size_t len) {
+    const void *data = get(reader, len);
+    if (data)
+        memcpy(value, data, len);
+}
+
+static const char *get_string(struct snapshot_reader *reader) {
+    const uint32_t len = get_u32(reader);
+    if (len == SNAPSHOT_NULL_STRING)
+        return NULL;
+    const char *str = get(reader, (size_t)len + 1);
+    if (str == NULL || str[len] != '\0') {
+        reader->error = true;
+        return NULL;
+    }
+    return str;
+}
+
+/*
+ * Reads the fixed part of a container record and skips over its marks and
+ * swallows, remembering where they start.
+ *
+ */
+static bool get_con(struct snapshot_reader *reader, struct snapshot_con *con) {
+    con->type = get_u8(reader);
+    con->layout = get_u8(reader);
+    con->workspace_layout = get_u8(reader);
+    con->last_split_layout = get_u8(reader);
+    con->border_style = get_u8(reader);
+    con->scratchpad_state = get_u8(reader);
+    con->floating = get_u8(reader);
+    con->fullscreen_mode = get_u8(reader);
+    con->flags = get_u8(reader);
+    con->current_border_width = get_i32(reader);
+    con->num = get_i32(reader);
+    con->depth = get_i32(reader);
+    get_raw(reader, &(con->percent), sizeof(con->percent));
+    get_raw(reader, &(con->rect), sizeof(Rect));
+    get_raw(reader, &(con->window_rect), sizeof(Rect));
+    get_raw(reader, &(con->geometry), sizeof(Rect));
+    con->gaps.inner = get_i32(reader);
+    con->gaps.top = get_i32(reader);
+    con->gaps.right = get_i32(reader);
+    con->gaps.bottom = get_i32(reader);
+    con->gaps.left = get_i32(reader);
+    con->name = get_string(reader);
+    con->title_format = get_string(reader);
+
+    con->num_marks = get_u32(reader);
+    con->marks = *reader;
+    for (uint32_t i = 0; i < con->num_marks && !reader->error; i++) {
+        if (get_string(reader) == NULL)
+            reader->error = true;
+    }
+
+    con->num_swallows = get_u32(reader);
+    con->swallows = *reader;
+    for (uint32_t i = 0; i < con->num_swallows && !reader->error; i++) {
+        get(reader, 2 * sizeof(int32_t) + sizeof(uint32_t) + sizeof(uint8_t));
+        for (int j = 0; j < 4; j++)
+            get_string(reader);
+    }
+
+    return !reader->error;
+}
+
+/*
+ * Checks a container record and all of its children, so that
+ * restart_snapshot_load() never has to give up halfway through.
+ *
+ */
+static bool check_con(struct snapshot_reader *reader) {
+    struct snapshot_con con;
+    if (!get_con(reader, &con))
+        return false;
+
+    if (con.type > CT_DOCKAREA ||
+        con.layout == L_DEFAULT || con.layout > L_SPLITH ||
+        (con.workspace_layout != L_DEFAULT && con.workspace_layout != L_STACKED && con.workspace_layout != L_TABBED) ||
+        con.border_style > BS_PIXEL ||
+        con.scratchpad_state > SCRATCHPAD_CHANGED ||
+        con.floating > FLOATING_USER_ON ||
+        con.fullscreen_mode > CF_GLOBAL)
+        return false;
+
+    uint32_t num_children = 0;
+    for (int list = 0; list < 2; list++) {
+        const uint32_t num = get_u32(reader);
+        for (uint32_t i = 0; i < num; i++) {
+            if (!check_con(reader))
+                return false;
+        }
+        num_children += num;
+    }
+
+    const uint32_t num_focus = get_u32(reader);
+    if (num_focus > num_children)
+        return false;
+    for (uint32_t i = 0; i < num_focus; i++) {
+        if (get_u32(reader) >= num_children)
+            return false;
+    }
+
+    return !reader->error;
+}
+
+/*
+ * Creates the container described by the next record (and its children),
+ * following json_start_map() and json_end_map() in load_layout.c.
+ *
+ */
+static Con *load_con(struct snapshot_reader *reader, Con *parent, Con **to_focus) {
+    struct snapshot_con record;
+    get_con(reader, &record);
+
+    Con *con = con_new_skeleton(NULL, NULL);
+    con->parent = parent;
+    con->type = record.type;
+    con->layout = record.layout;
+    con->workspace_layout = record.workspace_layout;
+    con->last_split_layout = record.last_split_layout;
+    con->border_style = record.border_style;
+    con->scratchpad_state = record.scratchpad_state;
+    con->floating = record.floating;
+    con->fullscreen_mode = record.fullscreen_mode;
+    con->sticky = (record.flags & SNAPSHOT_STICKY);
+    con->current_border_width = record.current_border_width;
+    if (record.flags & SNAPSHOT_HAS_DEPTH)
+        con->depth = record.depth;
+    con->percent = record.percent;
+    con->rect = record.rect;
+    con->window_rect = record.window_rect;
+    con->geometry = record.geometry;
+    con->name = (record.name ? sstrdup(record.name) : NULL);
+    con->title_format = (record.title_format ? sstrdup(record.title_format) : NULL);
+    if (con->type == CT_WORKSPACE) {
+        con->num = record.num;
+        con->gaps = record.gaps;
+    }
+    if (record.flags & SNAPSHOT_FOCUSED)
+        *to_focus = con;
+
+    for (uint32_t i = 0; i < record.num_swallows; i++) {
+        Match *match = smalloc(sizeof(Match));
+        match_init(match);
+        match->dock = get_i32(&(record.swallows));
+        match->insert_where = get_i32(&(record.swallows));
+        match->id = get_u32(&(record.swallows));
+        match->restart_mode = get_u8(&(record.swallows));
+        const char *class = get_string(&(record.swallows));
+        const char *instance = get_string(&(record.swallows));
+        const char *window_role = get_string(&(record.swallows));
+        const char *title = get_string(&(record.swallows));
+        if (class)
+            match->class = regex_new(class);
+        if (instance)
+            match->instance = regex_new(instance);
+        if (window_role)
+            match->window_role = regex_new(window_role);
+        if (title)
+            match->title = regex_new(title);
+        TAILQ_INSERT_TAIL(&(con->swallow_head), match, matches);
+    }
+
+    /* check_con() guarantees that children and focus indexes are valid. */
+    uint32_t num_children = 0;
+    Con **children = NULL;
+    for (int list = 0; list < 2; list++) {
+        const uint32_t num = get_u32(reader);
+        children = srealloc(children, (num_children + num) * sizeof(Con *));
+        for (uint32_t i = 0; i < num; i++) {
+            children[num_children++] = load_con(reader, con, to_focus);
+        }
+        con_fix_percent(con);
+    }
+
+    /* Move the focused children to the top of the focus stack in reverse
+     * order, just like json_end_array(). */
+    const uint32_t num_focus = get_u32(reader);
+    const char *focus_indexes = reader->pos;
+    get(reader, num_focus * sizeof(uint32_t));
+    for (uint32_t i = num_focus; i-- > 0;) {
+        uint32_t index;
+        memcpy(&index, focus_indexes + i * sizeof(uint32_t), sizeof(uint32_t));
+        Con *child = children[index];
+        TAILQ_REMOVE(&(con->focus_head), child, focused);
+        TAILQ_INSERT_HEAD(&(con->focus_head), child, focused);
+    }
+    free(children);
+
+    /* Sanity check: swallow criteria don’t make any sense on a split
+     * container. */
+    if (con_is_split(con) && !TAILQ_EMPTY(&(con->swallow_head))) {
+        DLOG("sanity check: removing swallows specification from split container\n");
+        while (!TAILQ_EMPTY(&(con->swallow_head))) {
+            Match *match = TAILQ_FIRST(&(con->swallow_head));
+            TAILQ_REMOVE(&(con->swallow_head), match, matches);
+            match_free(match);
+            free(match);
+        }
+    }
+
+    if (con->type == CT_FLOATING_CON)
+        floating_check_size(con, false);
+
+    for (uint32_t i = 0; i < record.num_marks; i++) {
+        con_mark(con, get_string(&(record.marks)), MM_ADD);
+    }
+
+    con_attach(con, con->parent, true);
+    x_con_init(con);
+    return con;
+}
+
+/*
+ * Restores the tree from the given snapshot and attaches it to parent,
+ * mirroring what tree_append_json() does for the JSON layout. Returns false
+ * if the snapshot is invalid or was written by an incompatible version of i3,
+ * in which case nothing was attached.
+ *
+ */
+bool restart_snapshot_load(Con *parent, const char *buf, size_t len) {
+    struct snapshot_reader reader = {
+        .pos = buf,
+        .end = buf + len,
+        .error = false,
+    };
+
+    if (!restart_snapshot_detect(buf, len)) {
+        ELOG("Not a restart snapshot\n");
+        return false;
+    }
+    get(&reader, sizeof(snapshot_magic));
+
+    const uint32_t version = get_u32(&reader);
+    if (version != SNAPSHOT_VERSION) {
+        ELOG("Restart snapshot has version %u, but only version %d is supported\n",
+             version, SNAPSHOT_VERSION);
+        return false;
+    }
+
+    const char *previous = get_string(&reader);
+    const struct snapshot_reader start = reader;
+    if (!check_con(&reader) || reader.pos != reader.end) {
+        ELOG("Restart snapshot is corrupt, not restoring it\n");
+        return false;
+    }
+
+    if (previous != NULL) {
+        FREE(previous_workspace_name);
+        previous_workspace_name = sstrdup(previous);
+    }
+
+    reader = start;
+    Con *to_focus = NULL;
+    load_con(&reader, parent, &to_focus);
+    con_fix_percent(parent);
+    match_invalidate_sets();
+
+    if (to_focus)
+        con_activate(to_focus);
+    return true;
+}
@@ -0,0 +1,312 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Latency histograms and counters of the main loop, reported via the
+ *          GET_STATS IPC message.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#include <time.h>
+#include <xcb/xcb_event.h>
+
+/* The histograms are log-linear like HdrHistogram: every power of two is
+ * split into STATS_SUB_BUCKETS linear buckets, so each recorded latency is
+ * accurate to within 1/STATS_SUB_BUCKETS (6.25%) regardless of its magnitude,
+ * while recording stays a handful of integer operations. Latencies are
+ * recorded in nanoseconds and clamped to STATS_MAX_VALUE (about 18 minutes). */
+#define STATS_SUB_BUCKET_BITS 4
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+#define STATS_MAX_EXPONENT 40
+#define STATS_MAX_VALUE ((UINT64_C(1) << STATS_MAX_EXPONENT) - 1)
+#define STATS_BUCKETS ((STATS_MAX_EXPONENT - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS)
+
+struct stats_histogram {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint32_t buckets[STATS_BUCKETS];
+};
+
+static const char *phase_names[STATS_NUM_PHASES] = {
+    [STATS_PHASE_PREPARE] = "prepare",
+    [STATS_PHASE_X_EVENT] = "x_event",
+    [STATS_PHASE_RENDER] = "render",
+    [STATS_PHASE_X_PUSH_CHANGES] = "x_push_changes",
+    [STATS_PHASE_IPC] = "ipc",
+    [STATS_PHASE_COMMAND] = "command",
+};
+
+struct loop_stats loop_stats;
+
+static struct stats_histogram histograms[STATS_NUM_PHASES];
+
+/* X11 requests sent since the last reset, see stats_count_x_requests(). */
+static uint64_t x_requests;
+static unsigned int last_sequence;
+static bool have_last_sequence;
+
+/* Counting the X11 requests of tree_render() costs two additional requests per
+ * render, so it only starts once statistics are requested for the first time,
+ * see stats_enable_x_request_counting(). */
+static bool counting_x_requests = false;
+
+/* CLOCK_MONOTONIC timestamp of the last reset. */
+static uint64_t reset_time;
+
+/* Counters of the libi3 text cache at the last reset. */
+static uint64_t text_width_hits_at_reset;
+static uint64_t text_width_misses_at_reset;
+static uint64_t text_layout_hits_at_reset;
+static uint64_t text_layout_misses_at_reset;
+
+/*
+ * Returns the index of the bucket containing value.
+ *
+ */
+static int bucket_index(uint64_t value) {
+    if (value < STATS_SUB_BUCKETS)
+        return value;
+    const int exponent = 63 - __builtin_clzll(value);
+    const int shift = exponent - STATS_SUB_BUCKET_BITS;
+    return (shift + 1) * STATS_SUB_BUCKETS + (int)(value >> shift) - STATS_SUB_BUCKETS;
+}
+
+/*
+ * Returns the smallest value which ends up in the given bucket.
+ *
+ */
+static uint64_t bucket_lowest_value(int index) {
+    if (index < STATS_SUB_BUCKETS)
+        return index;
+    const int shift = index / STATS_SUB_BUCKETS - 1;
+    return (uint64_t)(index % STATS_SUB_BUCKETS + STATS_SUB_BUCKETS) << shift;
+}
+
+/*
+ * Returns the value below which the given fraction of the recorded latencies
+ * lies, rounded up to the end of its bucket.
+ *
+ */
+static uint64_t histogram_percentile(const struct stats_histogram *histogram, double fraction) {
+    if (histogram->count == 0)
+        return 0;
+
+    uint64_t wanted = (uint64_t)(fraction * histogram->count + 0.5);
+    if (wanted == 0)
+        wanted = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= wanted) {
+            const uint64_t highest = bucket_lowest_value(i + 1) - 1;
+            return (highest > histogram->max ? histogram->max : highest);
+        }
+    }
+    return histogram->max;
+}
+
+/*
+ * Returns the current time of the monotonic clock in nanoseconds, to be
+ * passed to stats_record() at the end of the phase.
+ *
+ */
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Records that the given phase, started at start (see stats_now()), ended now.
+ *
+ */
+void stats_record(stats_phase_t phase, uint64_t start) {
+    struct stats_histogram *histogram = &(histograms[phase]);
+    const uint64_t now = stats_now();
+    uint64_t value = (now > start ? now - start : 0);
+    if (value > STATS_MAX_VALUE)
+        value = STATS_MAX_VALUE;
+
+    if (histogram->count == 0 || value < histogram->min)
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+    histogram->count++;
+    histogram->total += value;
+    histogram->buckets[bucket_index(value)]++;
+}
+
+/*
+ * Adds the X11 requests sent since the last call to the request counter.
+ * sequence is the sequence number of a request which was just sent.
+ *
+ */
+void stats_count_x_requests(unsigned int sequence) {
+    /* Sequence numbers are 32 bit wide, but they cannot wrap around between
+     * two calls as every tree_render() calls this once counting is enabled. */
+    if (have_last_sequence)
+        x_requests += (uint32_t)(sequence - last_sequence);
+    last_sequence = sequence;
+    have_last_sequence = true;
+}
+
+/*
+ * Makes tree_render() count its X11 requests from now on.
+ *
+ */
+void stats_enable_x_request_counting(void) {
+    if (counting_x_requests)
+        return;
+
+    /* Requests sent before were not counted, the next call starts over. */
+    counting_x_requests = true;
+    have_last_sequence = false;
+}
+
+/*
+ * Returns whether tree_render() should count its X11 requests.
+ *
+ */
+bool stats_counting_x_requests(void) {
+    return counting_x_requests;
+}
+
+/*
+ * Returns a name for the given X11 event type, e.g. "MapRequest".
+ *
+ */
+static const char *x_event_name(int type, char *buffer, size_t size) {
+    if (randr_base > -1 && type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY)
+        return "RandrScreenChangeNotify";
+    if (xkb_base > -1 && type == xkb_base)
+        return "XkbEvent";
+    if (shape_supported && type == shape_base + XCB_SHAPE_NOTIFY)
+        return "ShapeNotify";
+
+    const char *label = xcb_event_get_label(type);
+    if (label != NULL)
+        return label;
+
+    snprintf(buffer, size, "%d", type);
+    return buffer;
+}
+
+/*
+ * Generates the summary of one histogram: count, sum, extremes and
+ * percentiles, all in nanoseconds.
+ *
+ */
+static void dump_histogram(yajl_gen gen, const struct stats_histogram *histogram) {
+    y(map_open);
+    ystr("count");
+    y(integer, histogram->count);
+    ystr("total_ns");
+    y(integer, histogram->total);
+    ystr("min_ns");
+    y(integer, histogram->min);
+    ystr("max_ns");
+    y(integer, histogram->max);
+    ystr("mean_ns");
+    y(integer, (histogram->count > 0 ? histogram->total / histogram->count : 0));
+    ystr("p50_ns");
+    y(integer, histogram_percentile(histogram, 0.5));
+    ystr("p90_ns");
+    y(integer, histogram_percentile(histogram, 0.9));
+    ystr("p99_ns");
+    y(integer, histogram_percentile(histogram, 0.99));
+    ystr("p999_ns");
+    y(integer, histogram_percentile(histogram, 0.999));
+    y(map_close);
+}
+
+/*
+ * Generates the GET_STATS reply: a map with the counters and one histogram
+ * summary per phase.
+ *
+ */
+void stats_dump(yajl_gen gen) {
+    stats_enable_x_request_counting();
+    stats_count_x_requests(xcb_no_operation(conn).sequence);
+
+    y(map_open);
+
+    ystr("elapsed_ns");
+    y(integer, stats_now() - reset_time);
+
+    ystr("phases");
+    y(map_open);
+    for (int phase = 0; phase < STATS_NUM_PHASES; phase++) {
+        ystr(phase_names[phase]);
+        dump_histogram(gen, &(histograms[phase]));
+    }
+    y(map_close);
+
+    ystr("renders");
+    y(integer, histograms[STATS_PHASE_RENDER].count);
+
+    ystr("x_requests");
+    y(integer, x_requests);
+
+    ystr("x_events");
+    y(map_open);
+    for (int type = 0; type < 128; type++) {
+        if (loop_stats.x_events[type] == 0)
+            continue;
+        char buffer[16];
+        ystr(x_event_name(type, buffer, sizeof(buffer)));
+        y(integer, loop_stats.x_events[type]);
+    }
+    y(map_close);
+
+    ystr("ipc_bytes_in");
+    y(integer, loop_stats.ipc_bytes_in);
+
+    ystr("ipc_bytes_out");
+    y(integer, loop_stats.ipc_bytes_out);
+
+    ystr("commands");
+    y(integer, loop_stats.commands);
+
+    uint64_t hits, misses;
+    text_width_cache_stats(&hits, &misses);
+    ystr("text_width_cache");
+    y(map_open);
+    ystr("hits");
+    y(integer, hits - text_width_hits_at_reset);
+    ystr("misses");
+    y(integer, misses - text_width_misses_at_reset);
+    y(map_close);
+
+    text_layout_cache_stats(&hits, &misses);
+    ystr("text_layout_cache");
+    y(map_open);
+    ystr("hits");
+    y(integer, hits - text_layout_hits_at_reset);
+    ystr("misses");
+    y(integer, misses - text_layout_misses_at_reset);
+    y(map_close);
+
+    y(map_close);
+}
+
+/*
+ * Resets all histograms and counters. Needs the X11 connection.
+ *
+ */
+void stats_reset(void) {
+    memset(histograms, 0, sizeof(histograms));
+    memset(&loop_stats, 0, sizeof(loop_stats));
+    x_requests = 0;
+    have_last_sequence = false;
+    stats_count_x_requests(xcb_no_operation(conn).sequence);
+    text_width_cache_stats(&text_width_hits_at_reset, &text_width_misses_at_reset);
+    text_layout_cache_stats(&text_layout_hits_at_reset, &text_layout_misses_at_reset);
+    reset_time = stats_now();
+}
@@ -10,6 +10,10 @@
 #include "all.h"
 
 void sync_respond(xcb_window_t window, uint32_t rnd) {
+    /* Everything requested before the sync request must be visible in X11
+     * once the client receives our reply. */
+    tree_render_if_needed();
+
     DLOG("[i3 sync protocol] Sending random value %d back to X11 window 0x%08x\n", rnd, window);
 
     void *reply = scalloc(32, 1);
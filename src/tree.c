@@ -7,6 +7,7 @@
  * tree.c: Everything that primarily modifies the layout tree data structure.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_TREE
 #include "all.h"
 
 struct Con *croot;
@@ -14,6 +15,11 @@ struct Con *focused;
 
 struct all_cons_head all_cons = TAILQ_HEAD_INITIALIZER(all_cons);
 
+struct render_stats render_stats;
+
+/* Set by tree_render_later(), reset by tree_render(). */
+static bool render_scheduled = false;
+
 /*
  * Create the pseudo-output __i3. Output-independent workspaces such as
  * __i3_scratch will live there.
@@ -80,20 +86,29 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
     }
 
     /* TODO: refactor the following */
-    croot = con_new(NULL, NULL);
-    croot->rect = (Rect){
+    Con *parent = con_new(NULL, NULL);
+    parent->rect = (Rect){
         geometry->x,
         geometry->y,
         geometry->width,
         geometry->height};
+    croot = parent;
     focused = croot;
 
-    tree_append_json(focused, buf, len, NULL);
+    if (restart_snapshot_detect(buf, len))
+        restart_snapshot_load(focused, buf, len);
+    else
+        tree_append_json(focused, buf, len, NULL);
 
     DLOG("appended tree, using new root\n");
-    croot = TAILQ_FIRST(&(croot->nodes_head));
+    croot = TAILQ_FIRST(&(parent->nodes_head));
     if (!croot) {
-        /* tree_append_json failed. Continuing here would segfault. */
+        /* Loading the layout failed. Continuing here would segfault. Remove
+         * the temporary parent again, the caller falls back to another layout
+         * or to a fresh tree. */
+        x_con_kill(parent);
+        con_free(parent);
+        focused = NULL;
         goto out;
     }
     DLOG("new root = %p\n", croot);
@@ -260,6 +275,7 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
         ipc_send_window_event("close", con);
         window_free(con->window);
         con->window = NULL;
+        con_index_update(con);
     }
 
     Con *ws = con_get_workspace(con);
@@ -432,6 +448,13 @@ bool level_down(void) {
 static void mark_unmapped(Con *con) {
     Con *current;
 
+    /* Invisible workspaces which did not change since the last render were
+     * already unmapped back then, so there is nothing to reset. */
+    if (con->type == CT_WORKSPACE && !workspace_needs_render(con)) {
+        render_stats.last_workspaces_skipped++;
+        return;
+    }
+
     con->mapped = false;
     TAILQ_FOREACH(current, &(con->nodes_head), nodes)
     mark_unmapped(current);
@@ -443,16 +466,51 @@ static void mark_unmapped(Con *con) {
     }
 }
 
+/*
+ * Resets the dirty flag of all containers below con. Since con_mark_dirty()
+ * always marks all parents, clean subtrees can be skipped.
+ *
+ */
+static void mark_clean(Con *con) {
+    Con *current;
+
+    if (!con->dirty)
+        return;
+
+    con->dirty = false;
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+    mark_clean(current);
+    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
+    mark_clean(current);
+}
+
 /*
  * Renders the tree, that is rendering all outputs using render_con() and
  * pushing the changes to X11 using x_push_changes().
  *
+ * Invisible workspaces are only visited if they changed since the last call
+ * (see workspace_needs_render()).
+ *
  */
 void tree_render(void) {
     if (croot == NULL)
         return;
 
+    const uint64_t start = stats_now();
     DLOG("-- BEGIN RENDERING --\n");
+    render_scheduled = false;
+    render_stats.last_nodes_rendered = 0;
+    render_stats.last_nodes_pushed = 0;
+    render_stats.last_workspaces_skipped = 0;
+    /* There is no way to get the current sequence number without sending a
+     * request, so we send a NoOperation request at the beginning and at the
+     * end and subtract those. This is only done once statistics were
+     * requested. */
+    const bool count_x_requests = stats_counting_x_requests();
+    unsigned int first_sequence = 0;
+    if (count_x_requests)
+        first_sequence = xcb_no_operation(conn).sequence;
+
     /* Reset map state for all nodes in tree */
     /* TODO: a nicer method to walk all nodes would be good, maybe? */
     mark_unmapped(croot);
@@ -461,7 +519,64 @@ void tree_render(void) {
     render_con(croot, false);
 
     x_push_changes(croot);
+
+    /* Remember which workspaces are visible now and reset the dirty flags.
+     * With the dirty flag reset, workspace_needs_render() tells whether a
+     * workspace is visible. */
+    mark_clean(croot);
+    Con *output, *workspace;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        Con *content = output_get_content(output);
+        if (content == NULL)
+            continue;
+        TAILQ_FOREACH(workspace, &(content->nodes_head), nodes) {
+            workspace->rendered_visible = false;
+            workspace->rendered_visible = workspace_needs_render(workspace);
+        }
+    }
+
+    if (count_x_requests) {
+        const unsigned int last_sequence = xcb_no_operation(conn).sequence;
+        stats_count_x_requests(last_sequence);
+        render_stats.last_x_requests = last_sequence - first_sequence - 1;
+        }
+    render_stats.renders++;
+    render_stats.total_nodes_rendered += render_stats.last_nodes_rendered;
+    render_stats.total_nodes_pushed += render_stats.last_nodes_pushed;
+    render_stats.total_workspaces_skipped += render_stats.last_workspaces_skipped;
+    render_stats.total_x_requests += render_stats.last_x_requests;
+    stats_record(STATS_PHASE_RENDER, start);
+#ifdef I3_DEBUG_BUILD
+    con_index_check();
+#endif
     DLOG("-- END RENDERING --\n");
+
+    /* Replies to commands which waited for this render can be sent now. */
+    ipc_send_deferred_replies();
+}
+
+/*
+ * Schedules a tree_render(). The tree will be rendered exactly once right
+ * before the event loop blocks again (see xcb_prepare_cb() in src/main.c), no
+ * matter how many events or IPC commands requested it in the meantime.
+ *
+ */
+void tree_render_later(void) {
+    render_scheduled = true;
+}
+
+/*
+ * Renders the tree now if tree_render_later() was called since the last
+ * tree_render(). Used before acting on state which depends on the rendered
+ * tree, like input events or sync requests. Returns whether it rendered.
+ *
+ */
+bool tree_render_if_needed(void) {
+    if (!render_scheduled)
+        return false;
+
+    tree_render();
+    return true;
 }
 
 /*
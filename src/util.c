@@ -32,6 +32,17 @@ int max(int a, int b) {
     return (a > b ? a : b);
 }
 
+/*
+ * Returns the bucket for the given key (a pointer or an X11 ID) in a hash
+ * table with the given number of buckets, which must be a power of two.
+ *
+ */
+size_t hash_bucket(uint64_t key, size_t size) {
+    /* Fibonacci hashing: the upper bits of the product are well distributed
+     * even for aligned pointers and sequential X11 IDs. */
+    return (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (size - 1);
+}
+
 bool rect_contains(Rect rect, uint32_t x, uint32_t y) {
     return (x >= rect.x &&
             x <= (rect.x + rect.width) &&
@@ -217,6 +228,38 @@ static char **add_argument(char **original, char *opt_char, char *opt_arg, char
 #define y(x, ...) yajl_gen_##x(gen, ##__VA_ARGS__)
 #define ystr(str) yajl_gen_string(gen, (unsigned char *)str, strlen(str))
 
+/*
+ * Stores the binary snapshot of the tree in an inherited in-memory file and
+ * passes its path to the restarted i3 in I3_RESTART_SNAPSHOT.
+ *
+ */
+static void store_restart_snapshot(void) {
+    size_t length;
+    char *snapshot = restart_snapshot_generate(&length);
+    char *path = restart_snapshot_store(snapshot, length);
+    if (path != NULL) {
+        setenv("I3_RESTART_SNAPSHOT", path, 1);
+        free(path);
+    }
+    free(snapshot);
+}
+
+/*
+ * Closes the snapshot stored by store_restart_snapshot() if the restart did
+ * not happen, so that it is not inherited by the processes i3 starts.
+ *
+ */
+static void discard_restart_snapshot(void) {
+    const char *path = getenv("I3_RESTART_SNAPSHOT");
+    if (path == NULL)
+        return;
+
+    const int fd = restart_snapshot_inherited_fd(path);
+    if (fd != -1)
+        close(fd);
+    unsetenv("I3_RESTART_SNAPSHOT");
+}
+
 static char *store_restart_layout(void) {
     setlocale(LC_NUMERIC, "C");
     yajl_gen gen = yajl_gen_alloc(NULL);
@@ -271,6 +314,14 @@ static char *store_restart_layout(void) {
 
     y(free);
 
+    /* The binary snapshot is a lot faster to load for large trees, but only
+     * this version of i3 can read it. The JSON layout is still stored as the
+     * fallback, e.g. when restarting into a different version of i3. A
+     * user-specified restart_state_path only gets the JSON layout, which can
+     * be inspected or reused with append_layout. */
+    if (config.restart_state_path == NULL)
+        store_restart_snapshot();
+
     return filename;
 }
 
@@ -305,7 +356,9 @@ void i3_restart(bool forget_layout) {
 
     execvp(start_argv[0], start_argv);
 
-    /* not reached */
+    /* Only reached if the exec failed. */
+    ELOG("Could not restart \"%s\": %s\n", start_argv[0], strerror(errno));
+    discard_restart_snapshot();
 }
 
 #if defined(__OpenBSD__) || defined(__APPLE__)
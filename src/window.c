@@ -7,6 +7,7 @@
  * window.c: Updates window attributes (X11 hints/properties).
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_MANAGE
 #include "all.h"
 
 /*
@@ -53,7 +54,7 @@ void window_update_class(i3Window *win, xcb_get_property_reply_t *prop, bool bef
 
     free(prop);
     if (!before_mgmt) {
-        run_assignments(win);
+        run_assignments(win, AF_CLASS);
     }
 }
 
@@ -90,7 +91,7 @@ void window_update_name(i3Window *win, xcb_get_property_reply_t *prop, bool befo
 
     free(prop);
     if (!before_mgmt) {
-        run_assignments(win);
+        run_assignments(win, AF_TITLE);
     }
 }
 
@@ -135,7 +136,7 @@ void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bo
 
     free(prop);
     if (!before_mgmt) {
-        run_assignments(win);
+        run_assignments(win, AF_TITLE);
     }
 }
 
@@ -234,7 +235,7 @@ void window_update_role(i3Window *win, xcb_get_property_reply_t *prop, bool befo
 
     free(prop);
     if (!before_mgmt) {
-        run_assignments(win);
+        run_assignments(win, AF_ROLE);
     }
 }
 
@@ -253,7 +254,7 @@ void window_update_type(i3Window *window, xcb_get_property_reply_t *reply) {
     window->window_type = new_type;
     LOG("_NET_WM_WINDOW_TYPE changed to %i.\n", window->window_type);
 
-    run_assignments(window);
+    run_assignments(window, AF_WINDOW_TYPE);
 }
 
 /*
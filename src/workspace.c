@@ -8,6 +8,7 @@
  *              workspaces.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_WORKSPACE
 #include "all.h"
 #include "yajl_utils.h"
 
@@ -333,6 +334,27 @@ bool workspace_is_visible(Con *ws) {
     return (fs == ws);
 }
 
+/*
+ * Returns true if the given workspace has to be visited by the next
+ * tree_render(): visible workspaces are always rendered, invisible ones only if
+ * they changed (see con_mark_dirty()) or if they were visible during the
+ * previous tree_render() and therefore still need to be unmapped.
+ *
+ */
+bool workspace_needs_render(Con *ws) {
+    assert(ws->type == CT_WORKSPACE);
+    if (ws->dirty || ws->rendered_visible)
+        return true;
+
+    /* Workspaces on i3-internal outputs (like __i3_scratch) are never
+     * rendered. Of the remaining ones, render_con() only descends into the
+     * workspace with fullscreen_mode == CF_OUTPUT. */
+    Con *output = con_get_output(ws);
+    return (output != NULL &&
+            !con_is_internal(output) &&
+            ws->fullscreen_mode == CF_OUTPUT);
+}
+
 /*
  * XXX: we need to clean up all this recursive walking code.
  *
@@ -401,6 +423,10 @@ static void workspace_reassign_sticky(Con *con) {
         current->mapped = true;
         src->window = NULL;
         src->mapped = false;
+        con_index_update(src);
+        con_index_update(current);
+        con_mark_dirty(src);
+        con_mark_dirty(current);
 
         x_reparent_child(current, src);
 
@@ -447,14 +473,17 @@ void workspace_show(Con *workspace) {
     /* disable fullscreen for the other workspaces and get the workspace we are
      * currently on. */
     TAILQ_FOREACH(current, &(workspace->parent->nodes_head), nodes) {
-        if (current->fullscreen_mode == CF_OUTPUT)
+        if (current->fullscreen_mode == CF_OUTPUT) {
             old = current;
+            con_mark_dirty(current);
+        }
         current->fullscreen_mode = CF_NONE;
     }
 
     /* enable fullscreen for the target workspace. If it happens to be the
      * same one we are currently on anyways, we can stop here. */
     workspace->fullscreen_mode = CF_OUTPUT;
+    con_mark_dirty(workspace);
     current = con_get_workspace(focused);
     if (workspace == current) {
         DLOG("Not switching, already there.\n");
@@ -530,15 +559,19 @@ void workspace_show(Con *workspace) {
         /* check if this workspace is currently visible */
         if (!workspace_is_visible(old)) {
             LOG("Closing old workspace (%p / %s), it is empty\n", old, old->name);
-            yajl_gen gen = ipc_marshal_workspace_event("empty", old, NULL);
+            /* The event has to be serialized before the workspace is freed. */
+            const bool send_event = ipc_has_event_listeners(I3_IPC_EVENT_WORKSPACE);
+            yajl_gen gen = (send_event ? ipc_marshal_workspace_event("empty", old, NULL) : NULL);
             tree_close_internal(old, DONT_KILL_WINDOW, false);
 
-            const unsigned char *payload;
-            ylength length;
-            y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+            if (send_event) {
+                const unsigned char *payload;
+                ylength length;
+                y(get_buf, &payload, &length);
+                ipc_send_event(I3_IPC_EVENT_WORKSPACE, (const char *)payload);
 
-            y(free);
+                y(free);
+            }
 
             /* Avoid calling output_push_sticky_windows later with a freed container. */
             if (old == old_focus) {
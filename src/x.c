@@ -8,6 +8,7 @@
  *      render.c). Basically a big state machine.
  *
  */
+#define I3_LOG_MODULE LOG_MODULE_X
 #include "all.h"
 
 #ifndef MAX
@@ -61,6 +62,11 @@ typedef struct con_state {
 
     bool initial;
 
+    /* Position of this frame in old_state_head, counted from the bottom of the
+     * stack (-1 for frames which were not pushed yet). Only valid during
+     * x_push_stack(). */
+    int old_position;
+
     char *name;
 
     CIRCLEQ_ENTRY(con_state)
@@ -71,6 +77,9 @@ typedef struct con_state {
 
     TAILQ_ENTRY(con_state)
     initial_mapping_order;
+
+    LIST_ENTRY(con_state)
+    frame_index;
 } con_state;
 
 CIRCLEQ_HEAD(state_head, con_state)
@@ -85,6 +94,38 @@ TAILQ_HEAD(initial_mapping_head, con_state)
 initial_mapping_head =
     TAILQ_HEAD_INITIALIZER(initial_mapping_head);
 
+/* Hash index of all container states by their frame ID, so that
+ * state_for_frame() does not need to walk state_head. The number of buckets
+ * is a power of two and grows with the number of states. */
+LIST_HEAD(state_bucket, con_state);
+static struct state_bucket *state_index;
+static size_t state_index_size;
+static size_t state_count;
+
+static void state_index_insert(con_state *state) {
+    if (++state_count > state_index_size) {
+        const size_t size = (state_index_size == 0 ? 64 : state_index_size * 2);
+        struct state_bucket *index = scalloc(size, sizeof(struct state_bucket));
+        for (size_t i = 0; i < state_index_size; i++) {
+            con_state *moved;
+            while ((moved = LIST_FIRST(&(state_index[i]))) != NULL) {
+                LIST_REMOVE(moved, frame_index);
+                LIST_INSERT_HEAD(&(index[hash_bucket(moved->id, size)]), moved, frame_index);
+            }
+        }
+        free(state_index);
+        state_index = index;
+        state_index_size = size;
+    }
+
+    LIST_INSERT_HEAD(&(state_index[hash_bucket(state->id, state_index_size)]), state, frame_index);
+}
+
+static void state_index_remove(con_state *state) {
+    LIST_REMOVE(state, frame_index);
+    state_count--;
+}
+
 /*
  * Returns the container state for the given frame. This function always
  * returns a container state (otherwise, there is a bug in the code and the
@@ -94,9 +135,12 @@ initial_mapping_head =
  */
 static con_state *state_for_frame(xcb_window_t window) {
     con_state *state;
-    CIRCLEQ_FOREACH(state, &state_head, state)
-    if (state->id == window)
-        return state;
+    if (state_index_size > 0) {
+        LIST_FOREACH(state, &(state_index[hash_bucket(window, state_index_size)]), frame_index) {
+            if (state->id == window)
+                return state;
+        }
+    }
 
     /* TODO: better error handling? */
     ELOG("No state found for window 0x%08x\n", window);
@@ -174,6 +218,7 @@ void x_con_init(Con *con) {
     Rect dims = {-15, -15, 10, 10};
     xcb_window_t frame_id = create_window(conn, dims, con->depth, visual, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_POINTER, false, mask, values);
     draw_util_surface_init(conn, &(con->frame), frame_id, get_visualtype_by_id(visual), dims.width, dims.height);
+    con_index_update(con);
     xcb_change_property(conn,
                         XCB_PROP_MODE_REPLACE,
                         con->frame.id,
@@ -191,6 +236,7 @@ void x_con_init(Con *con) {
     CIRCLEQ_INSERT_HEAD(&state_head, state, state);
     CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
     TAILQ_INSERT_TAIL(&initial_mapping_head, state, initial_mapping_order);
+    state_index_insert(state);
     DLOG("adding new state for window id 0x%08x\n", state->id);
 }
 
@@ -213,6 +259,9 @@ void x_reinit(Con *con) {
     state->child_mapped = false;
     state->con = con;
     memset(&(state->window_rect), 0, sizeof(Rect));
+
+    /* The container was just assigned a (new) client window. */
+    con_index_update(con);
 }
 
 /*
@@ -229,6 +278,7 @@ void x_reparent_child(Con *con, Con *old) {
 
     state->need_reparent = true;
     state->old_frame = old->frame.id;
+    con_mark_dirty(con);
 }
 
 /*
@@ -273,6 +323,7 @@ static void _x_con_kill(Con *con) {
     CIRCLEQ_REMOVE(&state_head, state, state);
     CIRCLEQ_REMOVE(&old_state_head, state, old_state);
     TAILQ_REMOVE(&initial_mapping_head, state, initial_mapping_order);
+    state_index_remove(state);
     FREE(state->name);
     free(state);
 
@@ -459,6 +510,58 @@ static size_t x_get_border_rectangles(Con *con, xcb_rectangle_t rectangles[4]) {
     return count;
 }
 
+/*
+ * Forces the decoration of the given container to be redrawn on the next
+ * render.
+ *
+ */
+void x_invalidate_decoration(Con *con) {
+    memset(&(con->deco_render_params), 0, sizeof(struct deco_render_params));
+}
+
+/*
+ * Records that the given area of the container's frame_buffer was drawn to and
+ * needs to be copied to the frame.
+ *
+ */
+static void x_deco_damage(Con *con, Rect rect) {
+    if (con->deco_damage_count < DECO_DAMAGE_RECTS) {
+        con->deco_damage[con->deco_damage_count++] = rect;
+        return;
+    }
+
+    /* Too many separate areas, merge them all into their bounding box. */
+    uint32_t x1 = rect.x, y1 = rect.y;
+    uint32_t x2 = rect.x + rect.width, y2 = rect.y + rect.height;
+    for (int i = 0; i < con->deco_damage_count; i++) {
+        const Rect *damage = &(con->deco_damage[i]);
+        x1 = min(x1, damage->x);
+        y1 = min(y1, damage->y);
+        x2 = max(x2, damage->x + damage->width);
+        y2 = max(y2, damage->y + damage->height);
+    }
+    con->deco_damage[0] = (Rect){x1, y1, x2 - x1, y2 - y1};
+    con->deco_damage_count = 1;
+}
+
+/*
+ * Returns true if all decorations drawn onto the given container need to be
+ * redrawn, i.e. if its pixmap was recreated or the decorations were moved.
+ *
+ */
+static bool x_deco_needs_full_redraw(Con *con) {
+    if (con->pixmap_recreated)
+        return true;
+
+    Con *child;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (child->deco_render_params.color != NULL &&
+            memcmp(&(child->deco_render_params.con_deco_rect), &(child->deco_rect), sizeof(Rect)) != 0)
+            return true;
+    }
+    return false;
+}
+
 /*
  * Draws the decoration of the given container onto its parent.
  *
@@ -494,7 +597,10 @@ void x_draw_decoration(Con *con) {
         return;
 
     /* 1: build deco_params and compare with cache */
-    struct deco_render_params *p = scalloc(1, sizeof(struct deco_render_params));
+    struct deco_render_params params;
+    /* Zero the padding as well, the parameters are compared using memcmp. */
+    memset(&params, 0, sizeof(struct deco_render_params));
+    struct deco_render_params *p = &params;
 
     /* find out which colors to use */
     if (con->urgent)
@@ -517,28 +623,29 @@ void x_draw_decoration(Con *con) {
     p->con_is_leaf = con_is_leaf(con);
     p->parent_layout = con->parent->layout;
 
-    if (con->deco_render_params != NULL &&
-        (con->window == NULL || !con->window->name_x_changed) &&
-        !parent->pixmap_recreated &&
+    if ((con->window == NULL || !con->window->name_x_changed) &&
         !con->pixmap_recreated &&
         !con->mark_changed &&
-        memcmp(p, con->deco_render_params, sizeof(struct deco_render_params)) == 0) {
-        free(p);
-        goto copy_pixmaps;
+        memcmp(p, &(con->deco_render_params), sizeof(struct deco_render_params)) == 0) {
+        /* Nothing changed, the frame still shows the right contents. */
+        return;
     }
 
-    Con *next = con;
-    while ((next = TAILQ_NEXT(next, nodes))) {
-        FREE(next->deco_render_params);
+    /* Text drawn with X core fonts is not cut off at the end of the
+     * decoration, so it might have been drawn over the decorations of the
+     * next siblings. */
+    if (!font_is_pango()) {
+        Con *next = con;
+        while ((next = TAILQ_NEXT(next, nodes))) {
+            x_invalidate_decoration(next);
+        }
     }
 
-    FREE(con->deco_render_params);
-    con->deco_render_params = p;
+    con->deco_render_params = params;
 
     if (con->window != NULL && con->window->name_x_changed)
         con->window->name_x_changed = false;
 
-    parent->pixmap_recreated = false;
     con->pixmap_recreated = false;
     con->mark_changed = false;
 
@@ -601,13 +708,8 @@ void x_draw_decoration(Con *con) {
     if (parent->frame_buffer.id == XCB_NONE)
         goto copy_pixmaps;
 
-    /* For the first child, we clear the parent pixmap to ensure there's no
-     * garbage left on there. This is important to avoid tearing when using
-     * transparency. */
-    if (con == TAILQ_FIRST(&(con->parent->nodes_head))) {
-        draw_util_clear_surface(&(con->parent->frame_buffer), COLOR_TRANSPARENT);
-        FREE(con->parent->deco_render_params);
-    }
+    /* Only this area of the parent needs to be copied to its frame. */
+    x_deco_damage(parent, con->deco_rect);
 
     /* 4: paint the bar */
     draw_util_rectangle(&(parent->frame_buffer), p->color->background,
@@ -713,7 +815,10 @@ void x_draw_decoration(Con *con) {
 
     x_draw_decoration_after_title(con, p);
 copy_pixmaps:
-    draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+    /* The frame_buffer of split containers only contains the decorations of
+     * their children, see x_deco_recurse(). */
+    if (leaf)
+        draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
 }
 
 /*
@@ -724,20 +829,49 @@ copy_pixmaps:
  */
 void x_deco_recurse(Con *con) {
     Con *current;
+
+    /* Decorations of invisible workspaces will be drawn once they are
+     * shown. */
+    if (con->type == CT_WORKSPACE && !workspace_needs_render(con))
+        return;
+
     bool leaf = TAILQ_EMPTY(&(con->nodes_head)) &&
                 TAILQ_EMPTY(&(con->floating_head));
     con_state *state = state_for_frame(con->frame.id);
 
     if (!leaf) {
+        /* The children draw their decorations onto our frame_buffer. Usually,
+         * only the ones which changed are redrawn, but when our pixmap is new
+         * or the decorations moved, the whole pixmap is cleared first to
+         * ensure there's no garbage left on there. This is important to
+         * avoid tearing when using transparency. */
+        if (con->frame_buffer.id != XCB_NONE && x_deco_needs_full_redraw(con)) {
+            draw_util_clear_surface(&(con->frame_buffer), COLOR_TRANSPARENT);
+            TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
+                x_invalidate_decoration(current);
+            }
+            con->deco_damage_count = 0;
+            x_deco_damage(con, (Rect){0, 0, con->rect.width, con->rect.height});
+            con->pixmap_recreated = false;
+        }
+
         TAILQ_FOREACH(current, &(con->nodes_head), nodes)
         x_deco_recurse(current);
 
         TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
         x_deco_recurse(current);
 
+        /* Copy only the decorations which were redrawn. An unmapped frame
+         * gets the whole pixmap when it is mapped. */
         if (state->mapped) {
-            draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+            for (int i = 0; i < con->deco_damage_count; i++) {
+                const Rect *damage = &(con->deco_damage[i]);
+                draw_util_copy_surface(&(con->frame_buffer), &(con->frame),
+                                       damage->x, damage->y, damage->x, damage->y,
+                                       damage->width, damage->height);
+            }
         }
+        con->deco_damage_count = 0;
     }
 
     if ((con->type != CT_ROOT && con->type != CT_OUTPUT) &&
@@ -846,6 +980,12 @@ void x_push_node(Con *con) {
     con_state *state;
     Rect rect = con->rect;
 
+    /* Nothing changed on invisible workspaces which are not dirty, see
+     * workspace_needs_render(). */
+    if (con->type == CT_WORKSPACE && !workspace_needs_render(con))
+        return;
+
+    render_stats.last_nodes_pushed++;
     //DLOG("Pushing changes for node %p / %s\n", con, con->name);
     state = state_for_frame(con->frame.id);
 
@@ -1018,6 +1158,11 @@ void x_push_node(Con *con) {
 
     set_shape_state(con, need_reshape);
 
+    /* Button grabs are only updated for visible windows after a reload, see
+     * regrab_all_buttons(). */
+    if (con->window != NULL && con->mapped)
+        bindings_update_button_grabs(con->window);
+
     /* Map if map state changed, also ensure that the child window
      * is changed if we are mapped and there is a new, unmapped child window.
      * Unmaps are handled in x_push_node_unmaps(). */
@@ -1091,6 +1236,9 @@ static void x_push_node_unmaps(Con *con) {
     Con *current;
     con_state *state;
 
+    if (con->type == CT_WORKSPACE && !workspace_needs_render(con))
+        return;
+
     //DLOG("Pushing changes (with unmaps) for node %p / %s\n", con, con->name);
     state = state_for_frame(con->frame.id);
 
@@ -1116,6 +1264,9 @@ static void x_push_node_unmaps(Con *con) {
             DLOG("ignore_unmap for con %p (frame 0x%08x) now %d\n", con, con->frame.id, con->ignore_unmap);
         }
         state->mapped = con->mapped;
+        /* x_push_node() will not visit this container again while its
+         * workspace is invisible, so we need to reset this ourselves. */
+        state->unmap_now = false;
     }
 
     /* handle all children and floating windows of this node */
@@ -1144,6 +1295,102 @@ static bool is_con_attached(Con *con) {
     return false;
 }
 
+/*
+ * Restacks the frames so that X11 reflects the order of state_head.
+ *
+ * Frames whose old positions (in old_state_head) form the longest increasing
+ * subsequence of the new stacking order are already in the right order
+ * relative to each other, so only the remaining frames are moved. This results
+ * in the minimal number of ConfigureWindow requests, e.g. raising one floating
+ * window restacks only this window.
+ *
+ * Returns the number of restacked frames.
+ *
+ */
+static uint32_t x_push_stack(void) {
+    /* Scratch arrays, indexed by the position in the new (bottom-to-top)
+     * stack. They only grow, just like client_list_windows. */
+    static con_state **stack = NULL;
+    static int *predecessor = NULL;
+    static int *tails = NULL;
+    static bool *keep = NULL;
+    static size_t capacity = 0;
+
+    if (state_count > capacity) {
+        capacity = state_count;
+        stack = srealloc(stack, capacity * sizeof(con_state *));
+        predecessor = srealloc(predecessor, capacity * sizeof(int));
+        tails = srealloc(tails, capacity * sizeof(int));
+        keep = srealloc(keep, capacity * sizeof(bool));
+    }
+
+    con_state *state;
+    int position = 0;
+    CIRCLEQ_FOREACH_REVERSE(state, &old_state_head, old_state) {
+        state->old_position = (state->initial ? -1 : position++);
+    }
+
+    /* Find the longest increasing subsequence of old positions in O(n log n):
+     * tails[k] is the index of the smallest old position which ends an
+     * increasing subsequence of length k + 1. Frames which were never pushed
+     * need to be stacked in any case. */
+    int n = 0;
+    int length = 0;
+    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
+        const int i = n++;
+        stack[i] = state;
+        keep[i] = false;
+        predecessor[i] = -1;
+        if (state->old_position == -1)
+            continue;
+
+        int low = 0, high = length;
+        while (low < high) {
+            const int mid = low + (high - low) / 2;
+            if (stack[tails[mid]]->old_position < state->old_position)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if (low > 0)
+            predecessor[i] = tails[low - 1];
+        tails[low] = i;
+        if (low == length)
+            length++;
+    }
+
+    con_state *lowest_kept = NULL;
+    for (int i = (length > 0 ? tails[length - 1] : -1); i != -1; i = predecessor[i]) {
+        keep[i] = true;
+        lowest_kept = stack[i];
+    }
+
+    /* Going from bottom to top, all frames below the current one are in their
+     * final order already, so the current frame can simply be put directly
+     * above the one below it. */
+    uint32_t restacks = 0;
+    for (int i = 0; i < n; i++) {
+        if (keep[i])
+            continue;
+
+        const uint32_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+        if (i > 0) {
+            //DLOG("Stacking 0x%08x above 0x%08x\n", stack[i]->id, stack[i - 1]->id);
+            uint32_t values[] = {stack[i - 1]->id, XCB_STACK_MODE_ABOVE};
+            xcb_configure_window(conn, stack[i]->id, mask, values);
+        } else if (lowest_kept != NULL) {
+            uint32_t values[] = {lowest_kept->id, XCB_STACK_MODE_BELOW};
+            xcb_configure_window(conn, stack[i]->id, mask, values);
+        } else {
+            /* Nothing to stack the lowest frame relative to. */
+            continue;
+        }
+        restacks++;
+    }
+
+    return restacks;
+}
+
 /*
  * Pushes all changes (state of each node, see x_push_node() and the window
  * stack) to X11.
@@ -1156,6 +1403,7 @@ static bool is_con_attached(Con *con) {
  *
  */
 void x_push_changes(Con *con) {
+    const uint64_t start = stats_now();
     con_state *state;
     xcb_query_pointer_cookie_t pointercookie;
 
@@ -1165,17 +1413,13 @@ void x_push_changes(Con *con) {
     }
 
     DLOG("-- PUSHING WINDOW STACK --\n");
-    //DLOG("Disabling EnterNotify\n");
-    /* We need to keep SubstructureRedirect around, otherwise clients can send
-     * ConfigureWindow requests and get them applied directly instead of having
-     * them become ConfigureRequests that i3 handles. */
-    uint32_t values[1] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT};
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
-    //DLOG("Done, EnterNotify disabled\n");
-    bool order_changed = false;
+    /* Restacking, configuring and mapping windows (and warping the pointer)
+     * generates EnterNotify events which were not caused by the user and must
+     * not change the focus. Instead of disabling EnterWindow on every frame
+     * while pushing, we ignore EnterNotify events carrying the sequence
+     * numbers of our requests (see handle_enter_notify()). */
+    const unsigned int first_sequence = xcb_no_operation(conn).sequence;
+    uint32_t values[1];
     bool stacking_changed = false;
 
     /* count first, necessary to (re)allocate memory for the bottom-to-top
@@ -1201,22 +1445,17 @@ void x_push_changes(Con *con) {
     CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
         if (con_has_managed_window(state->con))
             memcpy(walk++, &(state->con->window->id), sizeof(xcb_window_t));
-
-        //DLOG("stack: 0x%08x\n", state->id);
-        con_state *prev = CIRCLEQ_PREV(state, state);
-        con_state *old_prev = CIRCLEQ_PREV(state, old_state);
-        if (prev != old_prev)
-            order_changed = true;
-        if ((state->initial || order_changed) && prev != CIRCLEQ_END(&state_head)) {
+        if (state->initial)
             stacking_changed = true;
-            //DLOG("Stacking 0x%08x above 0x%08x\n", prev->id, state->id);
-            uint32_t mask = 0;
-            mask |= XCB_CONFIG_WINDOW_SIBLING;
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            uint32_t values[] = {state->id, XCB_STACK_MODE_ABOVE};
+    }
 
-            xcb_configure_window(conn, prev->id, mask, values);
-        }
+    const uint32_t restacks = x_push_stack();
+    render_stats.last_restacks = restacks;
+    render_stats.total_restacks += restacks;
+    if (restacks > 0)
+        stacking_changed = true;
+
+    CIRCLEQ_FOREACH(state, &state_head, state) {
         state->initial = false;
     }
 
@@ -1262,13 +1501,7 @@ void x_push_changes(Con *con) {
         warp_to = NULL;
     }
 
-    //DLOG("Re-enabling EnterNotify\n");
-    values[0] = FRAME_EVENT_MASK;
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
-    //DLOG("Done, EnterNotify re-enabled\n");
+    add_ignore_event_range(first_sequence, xcb_no_operation(conn).sequence, XCB_ENTER_NOTIFY);
 
     x_deco_recurse(con);
 
@@ -1359,6 +1592,7 @@ void x_push_changes(Con *con) {
     //}
 
     xcb_flush(conn);
+    stats_record(STATS_PHASE_X_PUSH_CHANGES, start);
 }
 
 /*
@@ -127,6 +127,11 @@ is(parser_calls('[con_mark="yay"] focus'),
    "cmd_focus()",
    'quoted criteria focus ok');
 
+is(parser_calls('debuglog modules all -render -x; debuglog modules ipc bindings'),
+   "cmd_debuglog_modules(all -render -x)\n" .
+   "cmd_debuglog_modules(ipc bindings)",
+   'debuglog modules with several modules ok');
+
 # Make sure trailing whitespace is stripped off: While this is not an issue for
 # commands being parsed due to the configuration, people might send IPC
 # commands with leading or trailing newlines.
@@ -152,6 +157,7 @@ is(parser_calls('unknown_literal'),
        reload
        shmlog
        debuglog
+       debug
        border
        layout
        append_layout
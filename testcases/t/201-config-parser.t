@@ -512,6 +512,7 @@ my $expected_all_tokens = "ERROR: CONFIG: Expected one of these tokens: <end>, '
         ipc_socket
         ipc-socket
         ipc_kill_timeout
+        ipc_client_queue_limit
         restart_state
         popup_during_fullscreen
         exec_always
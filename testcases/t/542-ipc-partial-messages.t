@@ -0,0 +1,82 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Test that i3 keeps serving other clients while a client sends an incomplete
+# message, that pipelined messages are all answered and that oversized
+# messages lead to the client being disconnected.
+use i3test;
+use IO::Select;
+
+################################################################################
+# A client which stops in the middle of a message must not block i3.
+################################################################################
+
+my $sock = ipc_raw_connect;
+my $msg = ipc_raw_message(0, 'nop partial');
+print $sock substr($msg, 0, 10);
+
+eval {
+    local $SIG{ALRM} = sub { die "Timeout\n" };
+    alarm 1;
+    cmd 'nop other client';
+    alarm 0;
+};
+ok(!$@, 'i3 did not hang on a partial header');
+
+print $sock substr($msg, 10, 10);
+
+eval {
+    local $SIG{ALRM} = sub { die "Timeout\n" };
+    alarm 1;
+    cmd 'nop other client';
+    alarm 0;
+};
+ok(!$@, 'i3 did not hang on a partial payload');
+
+print $sock substr($msg, 20);
+my ($type, $payload) = ipc_raw_read($sock);
+is($type, 0, 'reply to the completed message received');
+like($payload, qr/"success":true/, 'completed command was successful');
+
+################################################################################
+# Pipelined messages are all answered, in order.
+################################################################################
+
+print $sock ipc_raw_message(0, 'nop first') . ipc_raw_message(7, '') .
+    ipc_raw_message(0, 'nop third');
+my @types = map { (ipc_raw_read($sock))[0] } 1 .. 3;
+is_deeply(\@types, [ 0, 7, 0 ], 'all pipelined messages answered in order');
+close $sock;
+
+################################################################################
+# Oversized messages lead to the client being disconnected.
+################################################################################
+
+$sock = ipc_raw_connect;
+print $sock 'i3-ipc' . pack("LL", 0xffffffff, 0);
+
+my $s = IO::Select->new($sock);
+my $reached_eof = 0;
+while ($s->can_read(1)) {
+    if (read($sock, my $buffer, 100) == 0) {
+        $reached_eof = 1;
+        last;
+    }
+}
+ok($reached_eof, 'client sending an oversized message was disconnected');
+close $sock;
+
+done_testing;
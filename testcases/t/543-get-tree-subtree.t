@@ -0,0 +1,75 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_TREE can be restricted to a subtree, a maximum depth and a
+# list of fields.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $tmp = fresh_workspace;
+open_window;
+open_window;
+
+my $ws = get_ws($tmp);
+
+################################################################################
+# The whole tree is sent without a payload.
+################################################################################
+
+my $tree = $i3->message(4, "")->recv;
+is($tree->{type}, 'root', 'root container is sent without a payload');
+ok(exists($tree->{nodes}), 'nodes are included');
+
+################################################################################
+# Subtree and fields.
+################################################################################
+
+my $sub = $i3->message(4, qq|{"con_id": $ws->{id}, "fields": ["id", "name", "nodes"]}|)->recv;
+is($sub->{id}, $ws->{id}, 'workspace is the root of the reply');
+is($sub->{name}, $tmp, 'workspace name included');
+ok(!exists($sub->{layout}), 'layout not included');
+is(scalar @{$sub->{nodes}}, 2, 'both windows included');
+is_deeply([ sort keys %{$sub->{nodes}->[0]} ], [ qw(id name nodes) ], 'only requested fields included');
+
+# Strings after the fields array are not taken as fields.
+$sub = $i3->message(4, qq|{"fields": ["id", "nodes"], "unknown": "name", "con_id": $ws->{id}}|)->recv;
+is_deeply([ sort keys %$sub ], [ qw(id nodes) ], 'strings after the fields array ignored');
+
+################################################################################
+# Maximum depth.
+################################################################################
+
+my $shallow = $i3->message(4, qq|{"con_id": $ws->{id}, "max_depth": 0}|)->recv;
+is(scalar @{$shallow->{nodes}}, 0, 'children left out at max_depth 0');
+is(scalar @{$shallow->{focus}}, 2, 'focus still lists the children');
+
+$shallow = $i3->message(4, qq|{"max_depth": 1}|)->recv;
+ok(@{$shallow->{nodes}} > 0, 'outputs included at max_depth 1');
+is(scalar @{$shallow->{nodes}->[0]->{nodes}}, 0, 'no grandchildren at max_depth 1');
+
+################################################################################
+# Errors.
+################################################################################
+
+my $error = $i3->message(4, qq|{"con_id": 1}|)->recv;
+ok(!$error->{success}, 'unknown con_id results in an error');
+
+$error = $i3->message(4, 'not json')->recv;
+ok(!$error->{success}, 'invalid payload results in an error');
+
+done_testing;
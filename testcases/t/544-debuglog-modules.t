@@ -0,0 +1,54 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that 'debuglog modules' selects the modules whose debug messages
+# are logged.
+use i3test;
+
+my $result = cmd 'debuglog modules ipc bindings';
+ok($result->[0]->{success}, 'selecting modules succeeded');
+is_deeply($result->[0]->{modules}, [ 'ipc', 'bindings' ], 'only ipc and bindings are enabled');
+
+$result = cmd 'debuglog modules +render -ipc';
+is_deeply($result->[0]->{modules}, [ 'render', 'bindings' ], 'modules can be added and removed');
+
+$result = cmd 'debuglog modules none';
+is_deeply($result->[0]->{modules}, [], 'all modules can be disabled');
+
+$result = cmd 'debuglog modules render nonexistent';
+ok(!$result->[0]->{success}, 'unknown module is rejected');
+
+$result = cmd 'debuglog modules all -render -x';
+is_deeply($result->[0]->{modules},
+    [ qw(other ipc handlers con bindings tree workspace floating manage config) ],
+    'all modules but render and x are enabled');
+
+# The list ends where the command does, so it can be chained.
+$result = cmd 'debuglog modules none, debuglog modules +ipc +x; debuglog modules +render';
+is(scalar @$result, 3, 'three commands were run');
+is_deeply($result->[1]->{modules}, [ 'x', 'ipc' ], 'list ends at a comma');
+is_deeply($result->[2]->{modules}, [ 'render', 'x', 'ipc' ], 'list ends at a semicolon');
+
+$result = cmd 'debuglog modules all';
+is_deeply($result->[0]->{modules},
+    [ qw(other render x ipc handlers con bindings tree workspace floating manage config) ],
+    'all modules are enabled again');
+
+# i3 is still alive and logging.
+cmd 'debuglog on';
+does_i3_live;
+
+done_testing;
@@ -0,0 +1,74 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_STATS reports the main loop latencies and counters and
+# that they can be reset.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+# Reset first so that the counters below only cover this test.
+$i3->get_stats(1)->recv;
+
+fresh_workspace;
+open_window;
+cmd 'split h; open; focus left';
+
+my $stats = $i3->get_stats->recv;
+
+for my $phase (qw(prepare x_event render x_push_changes ipc command)) {
+    my $summary = $stats->{phases}->{$phase};
+    ok($summary->{count} > 0, "phase $phase was recorded");
+    cmp_ok($summary->{min_ns}, '<=', $summary->{p50_ns}, "$phase: min <= p50");
+    cmp_ok($summary->{p50_ns}, '<=', $summary->{p99_ns}, "$phase: p50 <= p99");
+    cmp_ok($summary->{p99_ns}, '<=', $summary->{max_ns}, "$phase: p99 <= max");
+}
+
+is($stats->{renders}, $stats->{phases}->{render}->{count}, 'renders match the render phase');
+ok($stats->{x_requests} > 0, 'X11 requests were counted');
+ok($stats->{x_events}->{MapRequest} >= 1, 'MapRequest event was counted');
+ok($stats->{ipc_bytes_in} > 0, 'IPC input was counted');
+ok($stats->{ipc_bytes_out} > 0, 'IPC output was counted');
+# fresh_workspace, split, open and focus
+ok($stats->{commands} >= 4, 'commands were counted');
+
+################################################################################
+# The reply to a reset still contains the old values.
+################################################################################
+
+$stats = $i3->get_stats(1)->recv;
+ok($stats->{commands} >= 4, 'reset reply contains the old counters');
+
+$stats = $i3->get_stats->recv;
+is($stats->{commands}, 0, 'commands were reset');
+is($stats->{phases}->{command}->{count}, 0, 'command phase was reset');
+
+################################################################################
+# Text widths (here: of the mark in the window decoration) are measured once
+# and then answered from the cache on later redraws.
+################################################################################
+
+cmd 'layout tabbed; mark cached';
+$i3->get_stats(1)->recv;
+cmd 'focus right';
+cmd 'focus left';
+sync_with_i3;
+
+$stats = $i3->get_stats->recv;
+ok($stats->{text_width_cache}->{hits} > 0, 'text widths were answered from the cache');
+
+done_testing;
@@ -0,0 +1,48 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that all windows are managed again after a restart, which requests
+# the properties of all windows before managing the first one. Uses more
+# windows than fit into one batch.
+use i3test;
+
+my $tmp = fresh_workspace;
+
+my @windows;
+for my $i (1 .. 150) {
+    push @windows, open_window(name => "window $i");
+}
+my $floating = open_floating_window(name => 'floating window');
+my $unmapped = open_window(name => 'unmapped window', dont_map => 1);
+sync_with_i3;
+
+is(scalar @{get_ws_content($tmp)}, 150, '150 tiling windows before restart');
+
+cmd 'restart';
+does_i3_live;
+
+my $ws = get_ws($tmp);
+is(scalar @{$ws->{nodes}}, 150, '150 tiling windows after restart');
+is(scalar @{$ws->{floating_nodes}}, 1, 'floating window after restart');
+
+my %names = map { ($_->{name} => 1) } @{$ws->{nodes}};
+is(scalar(grep { $names{"window $_"} } 1 .. 150), 150, 'all window titles were read');
+ok(!$names{'unmapped window'}, 'unmapped window is not managed');
+
+my $floating_con = $ws->{floating_nodes}->[0]->{nodes}->[0];
+is($floating_con->{window}, $floating->id, 'floating window is managed');
+
+done_testing;
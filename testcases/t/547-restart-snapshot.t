@@ -0,0 +1,137 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that an inplace restart restores the same tree, both with the
+# binary restart snapshot (the default) and with the JSON layout (used when
+# restart_state_path is set or when the snapshot cannot be loaded).
+use i3test i3_autostart => 0;
+use File::Temp qw(tempdir);
+
+# Returns the parts of the tree which should survive a restart. The focus
+# order is described by the positions of the children, as the IDs change.
+sub layout_of {
+    my ($con) = @_;
+    my @children = (@{$con->{nodes}}, @{$con->{floating_nodes}});
+    my %index = map { ($children[$_]->{id} => $_) } 0 .. $#children;
+    return {
+        map({ ($_ => $con->{$_}) } qw(type layout name marks floating
+            scratchpad_state border current_border_width fullscreen_mode
+            sticky focused title_format window num)),
+        percent => sprintf('%.6f', $con->{percent} // 0),
+        rect => join('x', @{$con->{rect}}{qw(x y width height)}),
+        focus => [ map { $index{$_} } @{$con->{focus}} ],
+        nodes => [ map { layout_of($_) } @{$con->{nodes}} ],
+        floating_nodes => [ map { layout_of($_) } @{$con->{floating_nodes}} ],
+    };
+}
+
+sub current_layout {
+    return layout_of(i3(get_socket_path())->get_tree->recv);
+}
+
+sub build_layout {
+    my $first = fresh_workspace;
+    open_window(name => 'left');
+    open_window(name => 'middle');
+    cmd 'split v';
+    open_window(name => 'bottom');
+    cmd 'layout tabbed';
+    open_window(name => 'tab');
+    cmd 'mark tabmark';
+    cmd 'title_format <b>%title</b>';
+    cmd 'border pixel 3';
+    cmd 'resize grow width 10 px or 10 ppt';
+
+    open_floating_window(name => 'floating');
+    cmd 'sticky enable';
+
+    open_window(name => 'scratch');
+    cmd 'move scratchpad';
+
+    my $second = fresh_workspace;
+    open_window(name => 'other');
+    cmd 'open';
+    cmd 'mark empty';
+
+    cmd "workspace $first";
+    cmd '[title="^left$"] focus';
+    sync_with_i3;
+
+    return $second;
+}
+
+sub check_restart {
+    my ($description) = @_;
+
+    my $previous = build_layout;
+    my $before = current_layout;
+
+    cmd 'restart';
+    does_i3_live;
+    sync_with_i3;
+
+    is_deeply(current_layout, $before, "$description: tree restored");
+
+    cmd 'workspace back_and_forth';
+    is(focused_ws, $previous, "$description: previous workspace restored");
+}
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+EOT
+
+my $pid = launch_with_config($config);
+check_restart('snapshot');
+exit_gracefully($pid);
+
+my $tmpdir = tempdir(CLEANUP => 1);
+$config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+restart_state $tmpdir/restart-state
+EOT
+
+$pid = launch_with_config($config);
+check_restart('JSON');
+exit_gracefully($pid);
+
+################################################################################
+# A snapshot which is rejected (I3_RESTART_SNAPSHOT is inherited by the
+# restarted i3 here, as the configured restart_state only gets the JSON layout)
+# leads to the JSON layout being restored instead.
+################################################################################
+
+my $magic = "i3-snap\n";
+my %bad_snapshots = (
+    'unknown version' => $magic . pack('L', 9999),
+    'truncated' => $magic . pack('L', 1) . pack('L', 100) . 'short',
+    'corrupt' => $magic . pack('L', 1) . pack('L', 0xFFFFFFFF) . 'xyz',
+);
+
+for my $kind (sort keys %bad_snapshots) {
+    my $snapshot = "$tmpdir/snapshot";
+    open(my $fh, '>', $snapshot) or die "Could not write $snapshot: $!";
+    print $fh $bad_snapshots{$kind};
+    close($fh);
+
+    local $ENV{I3_RESTART_SNAPSHOT} = $snapshot;
+    $pid = launch_with_config($config);
+    check_restart("$kind snapshot");
+    exit_gracefully($pid);
+}
+
+done_testing;
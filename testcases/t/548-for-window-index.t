@@ -0,0 +1,95 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that for_window assignments still match correctly now that they
+# are only checked when a property they depend on changes, and that literal
+# patterns are matched like regular expressions.
+use i3test i3_autostart => 0;
+
+my $config = <<'EOT';
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+for_window [title="^exact$"] mark --add exact
+for_window [title="substring"] mark --add substring
+for_window [title="^Fire.*fox$"] mark --add regex
+for_window [class="^prefix"] mark --add prefix
+for_window [class="^prefix" title="both"] mark --add both
+for_window [title="floating title" floating] mark --add floating
+EOT
+
+my $pid = launch_with_config($config);
+
+sub get_marks {
+    return [ sort @{i3(get_socket_path())->get_marks->recv} ];
+}
+
+##############################################################
+# 1: exact, substring and regular expression title patterns
+##############################################################
+
+fresh_workspace;
+my $window = open_window(name => 'exact title');
+is_deeply(get_marks, [], 'exact pattern does not match a longer title');
+
+$window->name('exact');
+sync_with_i3;
+is_deeply(get_marks, [ 'exact' ], 'exact pattern matches after a title change');
+
+$window->name('a substring of the title');
+sync_with_i3;
+is_deeply(get_marks, [ 'exact', 'substring' ], 'substring pattern matches');
+
+$window->name('Firefox Nightly');
+sync_with_i3;
+is_deeply(get_marks, [ 'exact', 'substring' ], 'regular expression does not match');
+
+$window->name('Fire and fox');
+sync_with_i3;
+is_deeply(get_marks, [ 'exact', 'regex', 'substring' ], 'regular expression matches');
+
+kill_all_windows;
+
+##############################################################
+# 2: a title change checks rules depending on the class, too
+##############################################################
+
+fresh_workspace;
+$window = open_window(name => 'initial', wm_class => 'prefixed');
+is_deeply(get_marks, [ 'prefix' ], 'class prefix matches');
+
+$window->name('both');
+sync_with_i3;
+is_deeply(get_marks, [ 'both', 'prefix' ], 'class and title rule matches after a title change');
+
+kill_all_windows;
+
+##############################################################
+# 3: rules depending on the container state are checked on every
+# property change
+##############################################################
+
+fresh_workspace;
+$window = open_floating_window(name => 'initial');
+is_deeply(get_marks, [], 'floating rule does not match yet');
+
+$window->name('floating title');
+sync_with_i3;
+is_deeply(get_marks, [ 'floating' ], 'floating rule matches after a title change');
+
+exit_gracefully($pid);
+
+done_testing;
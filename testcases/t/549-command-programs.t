@@ -0,0 +1,77 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that binding and for_window commands, which are only parsed the
+# first time they run, behave the same on every run.
+use i3test i3_config => <<'EOT';
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bindsym Mod1+x [title="^target$"] floating toggle, border pixel 4
+for_window [title="^prog"] floating enable, border pixel 3
+EOT
+use i3test::XTEST;
+use ExtUtils::PkgConfig;
+
+##############################################################
+# 1: a for_window command applies to every matching window
+##############################################################
+
+my $tmp = fresh_workspace;
+open_window(name => 'prog 1');
+open_window(name => 'prog 2');
+open_window(name => 'other');
+
+my $ws = get_ws($tmp);
+is(@{$ws->{floating_nodes}}, 2, 'both matching windows are floating');
+is(@{$ws->{nodes}}, 1, 'the other window is tiling');
+for my $floating (@{$ws->{floating_nodes}}) {
+    is($floating->{nodes}->[0]->{current_border_width}, 3, 'border width set');
+}
+
+##############################################################
+# 2: a binding command runs the same way on every key press
+##############################################################
+
+SKIP: {
+    skip "libxcb-xkb too old (need >= 1.11)", 4 unless
+        ExtUtils::PkgConfig->atleast_version('xcb-xkb', '1.11');
+
+    sub press_binding {
+        xtest_key_press(64); # Alt_L
+        xtest_key_press(53); # x
+        xtest_key_release(53); # x
+        xtest_key_release(64); # Alt_L
+        xtest_sync_with_i3;
+    }
+
+    $tmp = fresh_workspace;
+    open_window(name => 'target');
+
+    press_binding;
+    is(@{get_ws($tmp)->{floating_nodes}}, 1, 'window floating after the first key press');
+
+    press_binding;
+    $ws = get_ws($tmp);
+    is(@{$ws->{floating_nodes}}, 0, 'window tiling after the second key press');
+    is($ws->{nodes}->[0]->{current_border_width}, 4, 'border width set');
+
+    press_binding;
+    is(@{get_ws($tmp)->{floating_nodes}}, 1, 'window floating after the third key press');
+
+}
+
+done_testing;
@@ -0,0 +1,84 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that a bar in hide mode, which is shown while a status block is
+# urgent, is hidden again once no block is urgent anymore.
+use i3test i3_autostart => 0;
+use File::Temp qw(tempdir);
+use POSIX qw(mkfifo);
+use Time::HiRes qw(sleep);
+use X11::XCB qw(:all);
+
+my $tmpdir = tempdir(CLEANUP => 1);
+my $fifo = "$tmpdir/status";
+mkfifo($fifo, 0600) or die "Could not create $fifo: $!";
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bar {
+    mode hide
+    status_command cat $fifo
+}
+EOT
+
+my $pid = launch_with_config($config);
+
+# Returns whether a window of i3bar is mapped.
+sub i3bar_mapped {
+    my $tree = $x->query_tree_reply($x->query_tree($x->get_root_window())->{sequence});
+    for my $window (@{$tree->{children}}) {
+        my $cookie = $x->get_property(0, $window, $x->atom(name => 'WM_CLASS')->id,
+            GET_PROPERTY_TYPE_ANY, 0, 64);
+        my $class = $x->get_property_reply($cookie->{sequence});
+        next unless ($class->{value} // '') =~ /^i3bar\0/;
+
+        my $attributes = $x->get_window_attributes_reply(
+            $x->get_window_attributes($window)->{sequence});
+        return 1 if $attributes->{map_state} == MAP_STATE_VIEWABLE;
+    }
+    return 0;
+}
+
+sub wait_for_i3bar_mapped {
+    my ($mapped) = @_;
+    for (1 .. 50) {
+        return 1 if i3bar_mapped() == $mapped;
+        sleep(0.1);
+    }
+    return 0;
+}
+
+# Opening the FIFO blocks until i3bar started the status command. The child
+# must not be stopped while the bar is hidden, as it relays our input.
+open(my $status, '>', $fifo) or die "Could not open $fifo: $!";
+$status->autoflush(1);
+print $status qq|{"version":1,"stop_signal":0}\n[\n|;
+
+print $status qq|[{"full_text":"calm"}],\n|;
+ok(wait_for_i3bar_mapped(0), 'bar is hidden');
+
+print $status qq|[{"full_text":"alarm","urgent":true}],\n|;
+ok(wait_for_i3bar_mapped(1), 'bar is shown while a block is urgent');
+
+print $status qq|[{"full_text":"calm"}],\n|;
+ok(wait_for_i3bar_mapped(0), 'bar is hidden once the block is no longer urgent');
+
+close($status);
+exit_gracefully($pid);
+
+done_testing;
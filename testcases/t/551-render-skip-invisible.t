@@ -0,0 +1,117 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that tree_render() skips invisible workspaces which did not change
+# since the last render and that it still renders them once they are changed.
+use i3test;
+use File::Temp qw(tempfile);
+use IO::Handle;
+
+sub last_render {
+    return cmd('debug render-stats')->[0]->{last_render};
+}
+
+my @workspaces;
+my %windows;
+for (1 .. 3) {
+    my $ws = fresh_workspace;
+    push @workspaces, $ws;
+    $windows{$ws} = open_window;
+}
+
+my $current = fresh_workspace;
+
+# Any command which needs a render will do.
+cmd 'border pixel 2';
+sync_with_i3;
+
+my $clean = last_render;
+cmp_ok($clean->{workspaces_skipped}, '>=', scalar @workspaces,
+       'invisible workspaces were skipped');
+
+################################################################################
+# Changing a window on an invisible workspace makes that workspace dirty.
+################################################################################
+
+my $target = $workspaces[0];
+my $window = $windows{$target};
+my ($con) = grep { $_->{window} == $window->id } @{get_ws_content($target)};
+
+cmd '[con_id=' . $con->{id} . '] border pixel 5';
+sync_with_i3;
+
+is(last_render->{workspaces_skipped}, $clean->{workspaces_skipped} - 1,
+   'the changed workspace was rendered');
+
+cmd 'border pixel 2';
+sync_with_i3;
+
+is(last_render->{workspaces_skipped}, $clean->{workspaces_skipped},
+   'the workspace is skipped again once it was rendered');
+
+################################################################################
+# The skipped workspaces are still up to date when switching to them.
+################################################################################
+
+cmd "workspace $target";
+sync_with_i3;
+
+ok($window->mapped, 'window is mapped after switching to its workspace');
+($con) = grep { $_->{window} == $window->id } @{get_ws_content($target)};
+is($con->{current_border_width}, 5, 'border width set while invisible was applied');
+
+my (undef, $geometry) = $window->rect;
+is($geometry->x, 5, 'window is placed inside the new border');
+
+################################################################################
+# A window which is swallowed by a placeholder on a clean invisible workspace
+# still gets configured to the size of the placeholder.
+################################################################################
+
+my $swallow_ws = fresh_workspace;
+
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "swallows": [
+        {
+            "class": "^swallowme$"
+        }
+    ]
+}
+EOT
+$fh->flush;
+cmd "append_layout $filename";
+
+fresh_workspace;
+cmd 'border pixel 2';
+sync_with_i3;
+
+# i3 does not map the window on the invisible workspace, so open_window would
+# time out waiting for it.
+my $swallowed = open_window(wm_class => 'swallowme', dont_map => 1);
+$swallowed->map;
+sync_with_i3;
+
+my @content = @{get_ws_content($swallow_ws)};
+is($content[0]->{window}, $swallowed->id, 'window was swallowed');
+
+my (undef, $swallowed_geometry) = $swallowed->rect;
+cmp_ok($swallowed_geometry->width, '>', 30, 'swallowed window was configured while invisible');
+
+close($fh);
+
+done_testing;
@@ -0,0 +1,132 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that renders are coalesced until the event loop is idle, that the
+# replies to commands are only sent once their effects were rendered and that
+# sync requests and other IPC messages see the rendered tree.
+use i3test;
+use JSON::XS;
+
+# 'debug render-stats' itself does not need a render.
+sub renders {
+    return cmd('debug render-stats')->[0]->{renders};
+}
+
+sub toggle_sticky {
+    my ($window) = @_;
+    my $msg = pack "CCSLLLLLL",
+        X11::XCB::CLIENT_MESSAGE, # response_type
+        32, # format
+        0, # sequence
+        $window->id, # window
+        $x->atom(name => '_NET_WM_STATE')->id, # message type
+        2, # data32[0] = _NET_WM_STATE_TOGGLE
+        $x->atom(name => '_NET_WM_STATE_STICKY')->id, # data32[1]
+        0, # data32[2]
+        0, # data32[3]
+        0; # data32[4]
+
+    $x->send_event(0, $x->get_root_window(), X11::XCB::EVENT_MASK_SUBSTRUCTURE_REDIRECT, $msg);
+}
+
+fresh_workspace;
+my $left = open_window;
+my $right = open_window;
+
+################################################################################
+# A burst of X events which each schedule a render leads to far fewer renders.
+################################################################################
+
+my $changes = 20;
+my $before = renders;
+toggle_sticky($right) for 1 .. $changes;
+$x->flush;
+sync_with_i3;
+
+my $rendered = renders - $before;
+cmp_ok($rendered, '>=', 1, 'the changes were rendered');
+cmp_ok($rendered, '<', $changes, 'renders were coalesced');
+
+################################################################################
+# A sync request is only answered after a scheduled render.
+################################################################################
+
+$before = renders;
+toggle_sticky($right);
+sync_with_i3;
+cmp_ok(renders, '>', $before, 'render happened before the sync reply');
+
+toggle_sticky($right);
+sync_with_i3;
+
+################################################################################
+# Once the reply to a command arrives, its effects are visible in X11.
+################################################################################
+
+is($x->input_focus, $right->id, 'right window focused');
+cmd 'focus left';
+is($x->input_focus, $left->id, 'input focus set before the reply was sent');
+
+################################################################################
+# Pipelined messages are answered in order, even when the reply to the first
+# command is deferred until the next render.
+################################################################################
+
+my $sock = ipc_raw_connect;
+print $sock ipc_raw_message(0, 'focus right') .
+    ipc_raw_message(0, 'invalid_command_xyz') . ipc_raw_message(7, '');
+
+my ($type, $payload) = ipc_raw_read($sock);
+is($type, 0, 'first reply is a command reply');
+like($payload, qr/^\[\{"success":true/, 'deferred command was successful');
+
+($type, $payload) = ipc_raw_read($sock);
+is($type, 0, 'second reply is a command reply');
+like($payload, qr/"parse_error":true/, 'invalid command failed to parse');
+
+($type, $payload) = ipc_raw_read($sock);
+is($type, 7, 'third reply is the version reply');
+
+is($x->input_focus, $right->id, 'deferred command was rendered');
+
+################################################################################
+# Other messages see the rendered tree: GET_TREE right after a command which
+# is still waiting for its render reports the new focus.
+################################################################################
+
+print $sock ipc_raw_message(0, 'focus left') . ipc_raw_message(4, '');
+
+($type, $payload) = ipc_raw_read($sock);
+is($type, 0, 'command reply before the tree');
+
+($type, $payload) = ipc_raw_read($sock);
+is($type, 4, 'tree reply received');
+
+sub focused_window {
+    my ($node) = @_;
+    return $node->{window} if $node->{focused};
+    for my $child (@{$node->{nodes}}, @{$node->{floating_nodes}}) {
+        my $window = focused_window($child);
+        return $window if defined($window);
+    }
+    return undef;
+}
+
+is(focused_window(decode_json($payload)), $left->id, 'tree reflects the command');
+
+close($sock);
+
+done_testing;
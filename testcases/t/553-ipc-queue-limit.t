@@ -0,0 +1,93 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that events for a client which does not read them are dropped once
+# more than ipc_client_queue_limit bytes are waiting, that replies are still
+# sent and that 'debug ipc-stats' reports the dropped bytes.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+ipc_client_queue_limit 16384
+# Make sure the slow client below is not disconnected during the test.
+ipc_kill_timeout 60000
+EOT
+
+my $I3_IPC_EVENT_TICK = 0x80000007;
+
+my $sock = ipc_raw_connect;
+print $sock ipc_raw_message(2, '["tick"]');
+
+my ($type, $payload) = ipc_raw_read($sock);
+is($type, 2, 'subscribe reply received');
+($type, $payload) = ipc_raw_read($sock);
+is($type, $I3_IPC_EVENT_TICK, 'first tick event received');
+
+################################################################################
+# Fill the socket buffer and the output queue of the subscriber, which does not
+# read anything until further notice.
+################################################################################
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $ticks = 1000;
+my $tick_payload = 'x' x 1000;
+$i3->send_tick($tick_payload)->recv for 1 .. $ticks;
+
+my @clients = @{cmd('debug ipc-stats')->[0]->{clients}};
+my @dropping = grep { $_->{bytes_dropped} > 0 } @clients;
+is(scalar @dropping, 1, 'events for one client were dropped');
+my $stats = $dropping[0];
+cmp_ok($stats->{pending_bytes}, '<=', 16384, 'pending bytes stay within the limit');
+cmp_ok($stats->{bytes_queued}, '>', 0, 'queued bytes were counted');
+
+# Replies are queued even when the limit is reached.
+print $sock ipc_raw_message(0, 'nop queue full');
+
+################################################################################
+# Once the subscriber catches up, it receives the events which were queued,
+# the reply behind them and events sent after its queue drained.
+################################################################################
+
+sub read_until {
+    my ($wanted) = @_;
+    my $events = 0;
+    eval {
+        local $SIG{ALRM} = sub { die "Timeout\n" };
+        alarm 10;
+        while (1) {
+            my ($type, $payload) = ipc_raw_read($sock);
+            die "EOF\n" unless defined($type);
+            last if $wanted->($type, $payload);
+            $events++ if $type == $I3_IPC_EVENT_TICK;
+        }
+        alarm 0;
+    };
+    return $@ ? undef : $events;
+}
+
+my $received = read_until(sub { $_[0] == 0 });
+ok(defined($received), 'reply was not dropped');
+cmp_ok($received, '<', $ticks, 'events were dropped');
+cmp_ok($received, '>', 0, 'queued events were delivered');
+
+$i3->send_tick('last')->recv;
+my $later = read_until(sub { $_[0] == $I3_IPC_EVENT_TICK && $_[1] =~ /"payload":"last"/ });
+is($later, 0, 'subscriber still receives events');
+
+close($sock);
+
+done_testing;
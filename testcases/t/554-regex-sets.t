@@ -0,0 +1,128 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that criteria which are matched via the regex sets (literal tests
+# and one pass over each window property for all criteria) behave exactly like
+# running PCRE on every pattern, also after the rules were replaced by a
+# reload.
+use i3test i3_autostart => 0;
+
+my $rules = <<'EOT';
+for_window [title="^exact$"] mark --add exact
+for_window [title="^start"] mark --add start
+for_window [title="end$"] mark --add end
+for_window [class="^literal$"] mark --add literal
+for_window [class="^l[i]teral$"] mark --add class_regex
+for_window [class="(?i)^LITERAL$"] mark --add caseless
+for_window [class="abc"] mark --add abc
+for_window [class="bcd"] mark --add bcd
+for_window [class="c"] mark --add c
+for_window [class="^abcd$"] mark --add abcd
+EOT
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+$rules
+EOT
+
+my $pid = launch_with_config($config);
+
+sub get_marks {
+    return [ sort @{i3(get_socket_path())->get_marks->recv} ];
+}
+
+# Opens a window and returns the marks set by the for_window rules.
+sub marks_for {
+    my (%args) = @_;
+    kill_all_windows;
+    fresh_workspace;
+    open_window(%args);
+    return get_marks;
+}
+
+##############################################################
+# 1: anchored literals
+##############################################################
+
+is_deeply(marks_for(name => 'exact'), [ 'exact' ], '^exact$ matches');
+is_deeply(marks_for(name => 'exactly'), [], '^exact$ does not match a longer title');
+is_deeply(marks_for(name => 'not exact'), [], '^exact$ does not match a suffix');
+is_deeply(marks_for(name => "exact\n"), [ 'exact' ],
+          '^exact$ matches before a trailing newline');
+is_deeply(marks_for(name => "exact\n\n"), [], '^exact$ matches before one newline only');
+
+is_deeply(marks_for(name => 'start and end'), [ 'end', 'start' ], 'prefix and suffix match');
+is_deeply(marks_for(name => 'end and start'), [], 'prefix and suffix only match at the edges');
+is_deeply(marks_for(name => "the end\n"), [ 'end' ], 'end$ matches before a trailing newline');
+
+##############################################################
+# 2: literal and non-literal patterns for the same criterion
+##############################################################
+
+is_deeply(marks_for(wm_class => 'literal'), [ 'caseless', 'class_regex', 'literal' ],
+          'literal and non-literal patterns match');
+is_deeply(marks_for(wm_class => 'LITERAL'), [ 'caseless' ],
+          'only the case-insensitive pattern matches');
+is_deeply(marks_for(wm_class => 'literally'), [], 'no pattern matches a longer class');
+
+##############################################################
+# 3: overlapping literals in one set
+##############################################################
+
+is_deeply(marks_for(wm_class => 'abcd'), [ 'abc', 'abcd', 'bcd', 'c' ],
+          'all overlapping literals match');
+is_deeply(marks_for(wm_class => 'xbcdx'), [ 'bcd', 'c' ], 'literals found after a mismatch');
+is_deeply(marks_for(wm_class => 'ababcd'), [ 'abc', 'bcd', 'c' ],
+          'literals found after a partial match');
+is_deeply(marks_for(wm_class => 'ab'), [], 'partial literals do not match');
+
+##############################################################
+# 4: the sets are rebuilt when the rules are replaced on reload
+##############################################################
+
+# The config file is passed with -c, see launch_with_config().
+open(my $cmdline_fh, '<', "/proc/$pid/cmdline") or die "Could not read the command line of i3: $!";
+my @argv = split(/\0/, do { local $/; <$cmdline_fh> });
+close($cmdline_fh);
+my ($config_index) = grep { $argv[$_] eq '-c' } 0 .. $#argv;
+my $config_path = $argv[$config_index + 1];
+
+open(my $config_fh, '>', $config_path) or die "Could not write $config_path: $!";
+print $config_fh <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+for_window [class="bcd"] mark --add new_bcd
+for_window [class="^abcd\$"] mark --add new_abcd
+EOT
+close($config_fh);
+
+cmd 'reload';
+
+is_deeply(marks_for(wm_class => 'abcd'), [ 'new_abcd', 'new_bcd' ],
+          'only the new rules match after a reload');
+is_deeply(marks_for(name => 'exact'), [], 'removed rules do not match anymore');
+
+# Reloading the same rules again frees and rebuilds the sets once more.
+cmd 'reload';
+
+is_deeply(marks_for(wm_class => 'xbcdx'), [ 'new_bcd' ], 'rules match after another reload');
+
+exit_gracefully($pid);
+
+done_testing;